@@ -0,0 +1,41 @@
+/*
+ * Free-running, oversampled ADC acquisition
+ *
+ * The ADC converts one channel continuously at 125 kHz ADC clock, about
+ * 9600 conversions per second, and the conversion-complete interrupt sums
+ * them in blocks of ADC_OVERSAMPLE. Each block is decimated to 13 bits
+ * (64 samples give 3 bits beyond the converter's 10, the circuit's own noise
+ * acts as dither) and stored in a ring of ADC_BLOCKS. read() averages the
+ * ring, the last ~100 ms, so a reading no longer carries the noise of a
+ * single conversion and costs no conversion time in loop().
+ *
+ * With more than one control channel the converter takes the channels in
+ * turn, a block each, and keeps a ring per channel; the first conversion
+ * after a switch still samples the previous channel and is dropped.
+ *
+ * ADC noise-reduction sleep is not used: it stops clkIO, and with it Timer0
+ * (millis()) and the Timer1 SSR tick, for every conversion.
+ */
+#ifndef ADC_H
+#define ADC_H
+
+#include "hal.h"
+
+#define ADC_OVERSAMPLE_BITS 3 // Extra bits, 4^3 = 64 samples per block
+#define ADC_OVERSAMPLE (1 << (2 * ADC_OVERSAMPLE_BITS))
+#define ADC_BLOCKS 16         // Power of two
+#define ADC_BITS (10 + ADC_OVERSAMPLE_BITS)
+#define ADC_CHANNELS CONTROL_CHANNELS
+
+namespace adc {
+
+/* Start free-running conversions of the ADC inputs against AVcc */
+void begin(const uint8_t inputs[ADC_CHANNELS]);
+
+/* Mean of the last ADC_BLOCKS blocks of a channel, 0..2^ADC_BITS-1; waits
+ * for its first block after begin() */
+uint16_t read(uint8_t channel);
+
+} // namespace adc
+
+#endif // ADC_H
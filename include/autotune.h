@@ -0,0 +1,77 @@
+/*
+ * Relay feedback PID autotune (Astrom-Hagglund)
+ *
+ * Instead of the PID, a relay drives the heater: full on below target minus
+ * AUTOTUNE_HYSTERESIS, off above target plus it. The plate settles into an
+ * oscillation around the target whose period Pu and amplitude a give the
+ * ultimate gain of the plate,
+ *
+ *   Ku = 4 d / (pi sqrt(a^2 - h^2))
+ *
+ * with d half the relay swing (half the SSR window, in the PID's output
+ * units) and h the hysteresis. The gains follow from Tyreus-Luyben, which
+ * overshoots far less than Ziegler-Nichols on a plate that lags its heater:
+ *
+ *   Kp = Ku / 2.2, Ti = 2.2 Pu, Td = Pu / 6.3
+ *
+ * One experiment runs at the soak temperature and one at the reflow
+ * temperature of the selected profile, each heating up first, discarding
+ * the first AUTOTUNE_SKIP cycles and averaging the next AUTOTUNE_CYCLES.
+ * save() turns the results into the gain schedule of the store, one point at
+ * each experiment's target, which the profile engine then interpolates in
+ * place of the default schedule.
+ *
+ * The same runs identify the plate model of model.h: the heat-up rate over
+ * AUTOTUNE_SLOPE_SPAN C of the first heat-up, the mean relay duty that held
+ * each target against the losses, and the dead time as how long the plate
+ * keeps rising after the relay switches off.
+ *
+ * All of it is integer and fixed-point; update() runs on the control tick.
+ */
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include "hal.h"
+#include "store.h"
+
+#define AUTOTUNE_EXPERIMENTS 2         // Soak, reflow
+#define AUTOTUNE_HYSTERESIS FIX16(1)   // Relay switches this far off target [C]
+#define AUTOTUNE_SKIP 1                // Cycles left to settle
+#define AUTOTUNE_CYCLES 3              // Cycles measured
+#define AUTOTUNE_TIMEOUT 1200          // Per experiment [s]
+#define AUTOTUNE_SLOPE_START FIX16(10) // Heat-up rate from this far above
+#define AUTOTUNE_SLOPE_SPAN FIX16(30)  // the first reading, over this [C]
+
+typedef enum AUTOTUNE_STATUS {
+  AUTOTUNE_RUNNING,
+  AUTOTUNE_DONE,
+  AUTOTUNE_FAILED // Timed out or did not oscillate
+} autotuneStatus_t;
+
+namespace autotune {
+
+/*
+ * Start with the experiment targets [C], soak then reflow, 0 to skip one,
+ * and the SSR window [ms] the PID output ranges over
+ */
+void begin(const int16_t targets[AUTOTUNE_EXPERIMENTS], unsigned long window,
+           unsigned long now);
+
+/* Control tick: switch the relay and measure the oscillation */
+autotuneStatus_t update(fix16_t reading, unsigned long now);
+
+autotuneStatus_t status();
+/* Relay state to drive the heater with */
+bool heater();
+/* Target of the experiment in progress [C] */
+int16_t target();
+
+/* Write the gains of the finished experiments into the gain schedule */
+void save(gainSchedule_t &schedule);
+
+/* Plate model from the finished experiments, false if it could not tell */
+bool identify(plantModel_t &model);
+
+} // namespace autotune
+
+#endif // AUTOTUNE_H
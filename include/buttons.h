@@ -0,0 +1,67 @@
+/*
+ * Button events
+ *
+ * A pin change interrupt on the button pins (hal::buttonsBegin()) time
+ * stamps every edge as it happens, so the pins are never read while they
+ * are left alone. Once BUTTON_DEBOUNCE has passed without another edge,
+ * update() reads where the pins came to rest and turns every button that
+ * changed into a press or release event stamped with the first edge of its
+ * bounce; a glitch that comes back to where it was is no event at all.
+ * loop() takes the events from a queue with next(), so each is handled
+ * exactly once, in the order they happened, however many places look at
+ * the buttons.
+ *
+ * update() also times the buttons held down: BUTTON_EVENT_LONG once after
+ * BUTTON_LONG_PRESS, and for the buttons of BUTTON_REPEATING (Up and Down)
+ * BUTTON_EVENT_REPEAT from BUTTON_REPEAT_DELAY on, every BUTTON_REPEAT_START
+ * at first and twice as often every BUTTON_REPEAT_ACCEL repeats, down to
+ * BUTTON_REPEAT_MIN: moving the setpoint 30 C is a hold of about four
+ * seconds rather than 30 presses. With no button down and no bounce to
+ * settle, update() returns at once.
+ */
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include "hal.h"
+
+#define BUTTON_DEBOUNCE 10       // Quiet after the last edge [ms]
+#define BUTTON_LONG_PRESS 1000   // [ms]
+#define BUTTON_REPEAT_DELAY 500  // First repeat after the press [ms]
+#define BUTTON_REPEAT_START 250  // [ms]
+#define BUTTON_REPEAT_MIN 40     // [ms]
+#define BUTTON_REPEAT_ACCEL 8    // Repeats per halving of the interval
+#define BUTTON_QUEUE_SIZE 8      // Power of two, at most 256
+#define BUTTON_REPEATING (1 << BUTTON_UP | 1 << BUTTON_DOWN)
+
+typedef enum BUTTON_EVENT_TYPE {
+  BUTTON_EVENT_PRESS,
+  BUTTON_EVENT_RELEASE,
+  BUTTON_EVENT_LONG,   // Still down BUTTON_LONG_PRESS after the press
+  BUTTON_EVENT_REPEAT, // Still down, BUTTON_REPEATING only
+} buttonEventType_t;
+
+typedef struct BUTTON_EVENT {
+  uint8_t button; // button_t
+  uint8_t type;   // buttonEventType_t
+  uint16_t time;  // Low bits of hal::millis() [ms]
+} buttonEvent_t;
+
+namespace buttons {
+
+/* Take edges from the button interrupt; a button already down stays silent
+ * until it is released */
+void begin();
+
+/* Settle bounces and time the buttons held, every loop() pass; returns at
+ * once with no button down and no edge since the last call */
+void update(unsigned long now);
+
+/* Oldest event not yet taken, false if none */
+bool next(buttonEvent_t *event);
+
+/* Events lost to a full queue since begin() */
+uint8_t dropped();
+
+} // namespace buttons
+
+#endif // BUTTONS_H
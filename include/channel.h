@@ -0,0 +1,139 @@
+/*
+ * Heater and sensor control channel
+ *
+ * The state of one control loop: the sensor reading, the setpoint, the PID
+ * and the SSR duty it drives the heater with. Sensor and Actuator are
+ * classes of static members, so a channel holds no pointers to them and
+ * their calls inline:
+ *
+ *   Sensor::read()       fix16_t reading [C]
+ *   Actuator::setDuty(d) heater duty, 0..SSR_DUTY_MAX
+ *   Actuator::duty()     the duty last set
+ *   Actuator::ticks(a,o) wrapping counts of output ticks, all and on
+ *   Actuator::active()   the SSR pin is on
+ *   Actuator::off()      heater off now
+ *
+ * HalSensor<n> and SsrActuator<n> are the sensor and SSR of channel n of
+ * hal.h and ssr.h. The PID input is feedback, which the caller sets before
+ * control(): the reading, or what the plate model makes of it.
+ *
+ * main.cpp runs CONTROL_CHANNELS of them: the plate, which runs the profile
+ * with the plate model, fault monitor and autotune, and with
+ * -DCONTROL_CHANNELS=2 an auxiliary heater (a bottom preheater or a second
+ * plate) that follows the profile setpoint up to AUX_TEMPERATURE_MAX. The
+ * sensor and PID tasks take the channels in turn, so their samples are
+ * spread over the period, and the SSR windows are staggered (ssr.h).
+ *
+ * The scheduled gains (profile.h) change slowly with the temperature, and a
+ * new set costs FixedPID two 64-bit divisions: rescheduled() tells the PID
+ * task when the temperature has moved CHANNEL_GAIN_STEP since the last set,
+ * so the lookup runs once a degree rather than every tick.
+ */
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "fixpid.h"
+#include "hal.h"
+#include "ssr.h"
+#include "store.h"
+
+#define CHANNEL_GAIN_STEP FIX16(1) // Plate move to look the gains up again [C]
+
+template <uint8_t N> struct HalSensor {
+  /* Only the plate sensor has a stored calibration, a fault stays FIX16_MIN */
+  static fix16_t read() {
+    fix16_t reading = hal::readTemperature(N);
+    return N || reading == FIX16_MIN ? reading : store::calibrate(reading);
+  }
+};
+
+template <uint8_t N> struct SsrActuator {
+  static void setDuty(uint16_t duty) { ssr::setDuty(N, duty); }
+  static uint16_t duty() { return ssr::duty(N); }
+  static void ticks(uint16_t *all, uint16_t *on) { ssr::ticks(N, all, on); }
+  static bool active() { return hal::readSsr(N); }
+  static void off() { ssr::off(N); }
+};
+
+template <class Sensor, class Actuator> class ControlChannel {
+public:
+  ControlChannel()
+      : reading(0), setpoint(0), feedback(0), output(0),
+        pid(&feedback, &output, &setpoint, 0, 0, 0), _window(1), _ticks(0),
+        _onTicks(0), _scheduledAt(0) {}
+
+  /*
+   * New reading; returns the duty (0..FIX16_ONE) the heater was on for since
+   * the last one
+   */
+  fix16_t read() {
+    reading = Sensor::read();
+    uint16_t ticks, onTicks;
+    Actuator::ticks(&ticks, &onTicks);
+    uint16_t all = ticks - _ticks;
+    fix16_t duty =
+        all ? (fix16_t)((uint32_t)(uint16_t)(onTicks - _onTicks) * FIX16_ONE /
+                        all)
+            : 0;
+    _ticks = ticks;
+    _onTicks = onTicks;
+    return duty;
+  }
+
+  /* PID on, from the reading, output over a window of window ms */
+  void start(unsigned long window, unsigned int sampleTime,
+             const tuning_t &gains) {
+    _window = window;
+    feedback = reading;
+    _scheduledAt = reading;
+    pid.SetTunings(gains.kp, gains.ki, gains.kd);
+    pid.SetOutputLimits(0, fix16FromInt(window));
+    pid.SetSampleTime(sampleTime);
+    pid.SetMode(AUTOMATIC);
+  }
+
+  /* PID step on feedback, plus feedForward [ms of the window], to the SSR */
+  void control(fix16_t feedForward) {
+    pid.SetFeedForward(feedForward);
+    pid.Compute();
+    Actuator::setDuty(((unsigned long)fix16ToInt(output) * SSR_DUTY_MAX +
+                       _window / 2) /
+                      _window);
+  }
+
+  /* True, once, when the gains are due for temperature */
+  bool rescheduled(fix16_t temperature) {
+    fix16_t moved = temperature - _scheduledAt;
+    if (moved < CHANNEL_GAIN_STEP && moved > -CHANNEL_GAIN_STEP)
+      return false;
+    _scheduledAt = temperature;
+    return true;
+  }
+
+  /* Drive the SSR directly, 0..SSR_DUTY_MAX */
+  void setDuty(uint16_t duty) { Actuator::setDuty(duty); }
+
+  /* Heater requested or still on */
+  bool heating() const { return Actuator::duty() || Actuator::active(); }
+
+  void off() { Actuator::off(); }
+
+  fix16_t reading;  // [C]
+  fix16_t setpoint; // [C]
+  fix16_t feedback; // PID input [C]
+  fix16_t output;   // [ms of the window]
+  FixedPID pid;
+
+private:
+  unsigned long _window; // [ms]
+  uint16_t _ticks;       // Actuator::ticks() at the last read()
+  uint16_t _onTicks;
+  fix16_t _scheduledAt; // Temperature of the gains in use [C]
+};
+
+typedef ControlChannel<HalSensor<0>, SsrActuator<0> > PlateChannel;
+#if CONTROL_CHANNELS > 1
+typedef ControlChannel<HalSensor<1>, SsrActuator<1> > AuxChannel;
+#endif
+
+#endif // CHANNEL_H
@@ -0,0 +1,28 @@
+/*
+ * Consistent Overhead Byte Stuffing
+ *
+ * Removes every zero from a frame of up to COBS_MAX_LENGTH bytes at the cost
+ * of one extra byte, so a zero can mark the end of each frame on a byte
+ * stream and a receiver that joins mid-stream resynchronises on the next
+ * one.
+ */
+#ifndef COBS_H
+#define COBS_H
+
+#include <stdint.h>
+
+#define COBS_MAX_LENGTH 254
+#define COBS_ENCODED_LENGTH(n) ((n) + 1)
+#define COBS_DELIMITER 0
+
+namespace cobs {
+
+/* Encode length bytes into out, returns the encoded length, no delimiter */
+uint8_t encode(const uint8_t *in, uint8_t length, uint8_t *out);
+
+/* Decode a frame without its delimiter, returns its length or -1 */
+int decode(const uint8_t *in, int length, uint8_t *out);
+
+} // namespace cobs
+
+#endif // COBS_H
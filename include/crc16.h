@@ -0,0 +1,19 @@
+/*
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value CRC16_INIT), shared
+ * by the EEPROM store and the telemetry frames
+ */
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+#define CRC16_INIT 0xffff
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t data) {
+  crc ^= (uint16_t)data << 8;
+  for (uint8_t i = 0; i < 8; i++)
+    crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+  return crc;
+}
+
+#endif // CRC16_H
@@ -0,0 +1,64 @@
+/*
+ * Fixed-point arithmetic
+ *
+ * Temperatures, setpoints and controller output are carried as Q16.16 in a
+ * 32-bit integer (fix16_t), which covers +/-32767 with a resolution of
+ * 1/65536. Errors and temperature deltas fed to the controller gains are
+ * narrowed to Q8.8 in 16 bits, so gain products need only 16x16-bit hardware
+ * multiplies on the AVR instead of soft-float or 64-bit arithmetic.
+ */
+#ifndef FIX16_H
+#define FIX16_H
+
+#include <stdint.h>
+
+typedef int32_t fix16_t; // Q16.16
+typedef int16_t q8_t;    // Q8.8
+
+#define FIX16_ONE 65536L
+#define FIX16_MAX 0x7fffffffL
+#define FIX16_MIN (-FIX16_MAX - 1)
+/* Limit of products, leaves headroom to add a few of them without overflow */
+#define FIX16_PRODUCT_MAX 0x1fffffffL
+
+/* Constant conversion, folded at compile time: FIX16(0.025) */
+#define FIX16(x) ((fix16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+inline fix16_t fix16FromInt(int32_t x) { return x * FIX16_ONE; }
+inline int16_t fix16ToInt(fix16_t x) { return x >> 16; }
+inline fix16_t fix16FromFloat(double x) { return FIX16(x); }
+inline double fix16ToFloat(fix16_t x) { return x / 65536.0; }
+
+/* Q16.16 -> Q8.8, saturating at +/-127.99 */
+inline q8_t fix16ToQ8(fix16_t x) {
+  x >>= 8;
+  if (x > 32767)
+    return 32767;
+  if (x < -32767)
+    return -32767;
+  return x;
+}
+
+inline fix16_t q8ToFix16(q8_t x) { return (fix16_t)x * 256; }
+
+/*
+ * a * b for a Q16.16 coefficient and a Q8.8 value, result in Q16.16 and
+ * saturated at +/-FIX16_PRODUCT_MAX. Built from two 16x16 -> 32-bit products.
+ */
+inline fix16_t fix16MulQ8(fix16_t a, q8_t b) {
+  int32_t hi = (int32_t)(int16_t)(a >> 16) * b; // weight 2^16
+  int32_t lo = (int32_t)(uint16_t)a * b;        // weight 1
+  if (hi >= (FIX16_PRODUCT_MAX >> 8))
+    return FIX16_PRODUCT_MAX;
+  if (hi <= -(FIX16_PRODUCT_MAX >> 8))
+    return -FIX16_PRODUCT_MAX;
+  return hi * 256 + (lo >> 8);
+}
+
+/* Full Q16.16 product and quotient in 64 bits, for work outside the PID */
+inline fix16_t fix16Mul(fix16_t a, fix16_t b) { return (int64_t)a * b >> 16; }
+inline fix16_t fix16Div(fix16_t a, fix16_t b) {
+  return ((int64_t)a << 16) / b;
+}
+
+#endif // FIX16_H
@@ -0,0 +1,82 @@
+/*
+ * Fixed-point PID controller
+ *
+ * Drop-in replacement for br3ttb's PID_v1 on the reflow loop, computed in
+ * Q16.16 (see fix16.h) instead of soft-float double:
+ *
+ *   - derivative on measurement, so setpoint steps do not kick the output
+ *   - first-order low-pass on the derivative, time constant in ms
+ *   - integrator clamped to the output limits and frozen while the output
+ *     is saturated in the direction the error pushes it (anti-windup)
+ *   - bumpless SetTunings(): the integrator absorbs the change of the P and D
+ *     terms so a gain switch at a stage boundary does not step the output
+ *   - optional feedforward added to the output; the integrator then only
+ *     makes up what the feedforward gets wrong, and may go negative for it
+ *
+ * Gains are given per second like PID_v1. Unlike PID_v1, Compute() does not
+ * look at the clock: the caller runs it every SetSampleTime() ms.
+ */
+#ifndef FIXPID_H
+#define FIXPID_H
+
+#include "fix16.h"
+
+#ifndef AUTOMATIC
+#define AUTOMATIC 1
+#define MANUAL 0
+#endif
+
+class FixedPID {
+public:
+  FixedPID(fix16_t *input, fix16_t *output, fix16_t *setpoint, fix16_t kp,
+           fix16_t ki, fix16_t kd);
+
+  /* One controller step, returns false in MANUAL mode */
+  bool Compute();
+
+  void SetMode(int mode);
+  void SetOutputLimits(fix16_t min, fix16_t max);
+  void SetTunings(fix16_t kp, fix16_t ki, fix16_t kd);
+  void SetSampleTime(unsigned int sampleTime);
+  /* Derivative low-pass time constant, 0 turns the filter off */
+  void SetDerivativeFilter(unsigned int timeConstant);
+  /* Added to the output from the next Compute(), 0 for none */
+  void SetFeedForward(fix16_t feedForward) { _feedForward = feedForward; }
+
+  fix16_t GetKp() const { return _dispKp; }
+  fix16_t GetKi() const { return _dispKi; }
+  fix16_t GetKd() const { return _dispKd; }
+  int GetMode() const { return _inAuto ? AUTOMATIC : MANUAL; }
+
+private:
+  void scaleTunings();
+  void initialize();
+  fix16_t clamp(fix16_t x) const;
+  fix16_t clampIntegral(fix16_t x) const;
+
+  fix16_t *_input;
+  fix16_t *_output;
+  fix16_t *_setpoint;
+
+  fix16_t _dispKp; // Gains as given, per second
+  fix16_t _dispKi;
+  fix16_t _dispKd;
+  fix16_t _kp; // Gains per sample
+  fix16_t _ki;
+  fix16_t _kd;
+
+  unsigned int _sampleTime;    // [ms]
+  unsigned int _filterTime;    // [ms]
+  uint16_t _dAlpha;            // Derivative filter coefficient, Q0.15
+  fix16_t _outMin;
+  fix16_t _outMax;
+  fix16_t _feedForward;
+
+  fix16_t _iTerm;
+  fix16_t _lastInput;
+  q8_t _lastError;
+  q8_t _dInput; // Filtered input change per sample
+  bool _inAuto;
+};
+
+#endif // FIXPID_H
@@ -0,0 +1,101 @@
+/*
+ * Hardware abstraction layer
+ *
+ * The control code in main.cpp reaches the board only through the calls
+ * below. src/avr/hal_avr.cpp implements them on the ATmega328P with the
+ * Arduino core, src/native/hal_native.cpp implements them on the host on top
+ * of the thermal plant simulator and a virtual clock ([env:native]).
+ */
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "native/arduino_compat.h"
+#endif
+#include "fix16.h"
+
+#ifndef CONTROL_CHANNELS
+#define CONTROL_CHANNELS 1 // Heater and sensor pairs, channel.h
+#endif
+
+#ifdef LCD16X2
+#ifdef ARDUINO
+#include "lcd_pcf8574.h"
+typedef LcdPcf8574 Lcd;
+#else
+#include "native/sim_lcd.h"
+typedef SimLcd Lcd;
+#endif
+#endif
+
+typedef enum BUTTON {
+  BUTTON_START,   // Start/stop
+  BUTTON_PROFILE, // Lead-Free or Leaded profile selection
+  BUTTON_UP,      // Setpoint up, autotune held while idle
+  BUTTON_DOWN,    // Setpoint down
+  BUTTON_COUNT
+} button_t;
+
+namespace hal {
+
+/* Pin directions */
+void begin();
+
+/* Time base */
+unsigned long millis();
+unsigned long micros(); // Section timing only (timing.h)
+void delay(unsigned long ms);
+
+/* Periodic timer interrupt calling callback every periodMs (max 262) */
+void timerBegin(unsigned int periodMs, void (*callback)());
+
+/* Mains zero-cross detector interrupt calling callback at every crossing */
+void zeroCrossBegin(void (*callback)());
+
+/* Outputs, the SSR of each control channel */
+void writeSsr(uint8_t channel, bool on);
+bool readSsr(uint8_t channel);
+void writeFan(bool on);
+void writeLed(bool on);
+void writeBuzzer(bool on);
+void tone(unsigned int frequency, unsigned long duration);
+
+/*
+ * Temperature sensors (sensor.h), converting in the background: sensorPoll()
+ * collects finished conversions and starts the next ones, the reads return
+ * the last collected. sensorBegin() returns false if one does not respond.
+ */
+bool sensorBegin();
+void sensorPoll();
+fix16_t readTemperature(uint8_t channel); // [C], FIX16_MIN on a fault
+uint8_t sensorFaults(uint8_t channel);    // SENSOR_FAULT_ bits
+fix16_t coldJunction(uint8_t channel);    // [C], SENSOR_NO_COLD_JUNCTION
+void sensorMains(uint8_t hertz); // Noise rejection for the mains, 50 or 60
+unsigned int sensorInterval();   // Shortest time between new samples [ms]
+
+/* Non-volatile storage */
+uint8_t eepromRead(int address);
+void eepromWrite(int address, uint8_t value);
+
+/* Serial port, never waits: write at most serialRoom() bytes */
+void serialBegin(unsigned long baud);
+uint8_t serialRoom();
+void serialWrite(const uint8_t *data, uint8_t length);
+int serialRead(); // Next received byte, or -1
+
+/*
+ * Buttons (buttons.h): raw levels, bit per button_t, 1 = held down, and
+ * callback from the interrupt on any edge of their pins
+ */
+uint8_t buttonLevels();
+void buttonsBegin(void (*callback)());
+
+/* Around data shared with an interrupt callback */
+void interruptsOff();
+void interruptsOn();
+
+} // namespace hal
+
+#endif // HAL_H
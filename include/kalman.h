@@ -0,0 +1,54 @@
+/*
+ * Plate temperature estimator
+ *
+ * The sensor is taped to the plate and shows its temperature seconds late
+ * and with noise. A Kalman filter over two states, the plate and the sensor
+ * temperature, gives the plate as it is now:
+ *
+ *   plate  += dt * (heating * duty - loss * (plate - ambient))
+ *   sensor += dt / lag * (plate - sensor)
+ *
+ * The first line is the plate model of model.h driven by the SSR duty the
+ * heater was actually on for, the second a first-order sensor lag with the
+ * model's dead time as its time constant. Every reading corrects both states
+ * by how far it is from the predicted sensor, weighed by the covariance of
+ * the two: the plate model's error (KALMAN_PLATE_NOISE) against the reading
+ * noise (KALMAN_READING_NOISE). A model that is off only shifts how far the
+ * estimate leans on the readings, which still pull it back.
+ *
+ * All in fix16, the 2x2 covariance kept as its three distinct entries. The
+ * estimate feeds the PID and the over-temperature check of the fault monitor;
+ * its rate of change, from one estimate to the next and smoothed over
+ * KALMAN_RATE_TIME, goes to the display and the telemetry. Readings can come
+ * at any interval.
+ */
+#ifndef KALMAN_H
+#define KALMAN_H
+
+#include "model.h"
+
+#define KALMAN_PLATE_NOISE FIX16(0.5)    // Plate model error [C^2/s]
+#define KALMAN_SENSOR_NOISE FIX16(0.002) // Sensor lag model error [C^2/s]
+#define KALMAN_READING_NOISE FIX16(0.09) // Reading variance [C^2]
+#define KALMAN_LAG_MIN 1                 // Sensor time constant at least [s]
+#define KALMAN_RATE_TIME 3000            // Rate smoothing time constant [ms]
+
+namespace kalman {
+
+/* Plate and sensor at the reading, settled, with the model of model.h */
+void begin(fix16_t reading);
+
+/*
+ * Reading taken dt ms after the last one with the duty (0..FIX16_ONE) the
+ * heater was on for in between; returns the plate estimate. A faulted
+ * reading (FIX16_MIN) only advances the model.
+ */
+fix16_t update(fix16_t reading, fix16_t duty, unsigned long dt);
+
+fix16_t plate();  // [C]
+fix16_t sensor(); // [C]
+fix16_t rate();   // Of the plate estimate, smoothed [C/s]
+
+} // namespace kalman
+
+#endif // KALMAN_H
@@ -0,0 +1,77 @@
+/*
+ * Shadow frame buffer for the 16x2 character LCD
+ *
+ * updateDisplay() renders into a RAM copy of the screen and flush() sends
+ * only the character cells that differ from what the LCD already shows. Each
+ * run of changed cells on a row costs one setCursor plus one write per cell;
+ * a single unchanged cell between two changes is rewritten instead of paying
+ * for a second setCursor, and no setCursor is sent when the LCD's own address
+ * counter already points at the run. An unchanged screen costs no bus traffic
+ * and there is no clear(), so no flicker.
+ *
+ * The runs of a frame go to the LCD driver as one queued I2C transaction:
+ * four port bytes per HD44780 transfer (two nibbles, each strobed on E) plus
+ * the address byte, which is what the byte counters below are charged with.
+ * A run that does not fit in the driver's queue is left for the next flush
+ * along with everything after it, so a busy bus delays cells, never loses
+ * them.
+ */
+#ifndef LCD_FRAME_H
+#define LCD_FRAME_H
+
+#include "hal.h"
+
+#ifdef LCD16X2
+
+#define LCD_FRAME_COLUMNS 16
+#define LCD_FRAME_ROWS 2
+#define LCD_FRAME_MAX_GAP 1 // Unchanged cells bridged inside a run
+#define LCD_I2C_BYTES_PER_TRANSFER 4
+/* A full repaint: one setCursor per row, every cell and the address */
+#define LCD_FRAME_FULL_BYTES                                                   \
+  ((LCD_FRAME_ROWS * (LCD_FRAME_COLUMNS + 1)) * LCD_I2C_BYTES_PER_TRANSFER + 1)
+
+class LcdFrame {
+public:
+  LcdFrame(Lcd &lcd);
+
+  /* Blank the RAM frame, nothing is sent */
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+  /* Text past the end of the row is dropped */
+  void print(const char *s);
+
+  /* Send the cells that changed since the last flush, as far as they fit */
+  void flush();
+  /* Forget what the LCD shows, the next flush repaints everything */
+  void invalidate();
+
+  uint16_t frames() const { return _frames; }
+  uint32_t bytes() const { return _bytes; }        // Since start-up
+  uint16_t lastBytes() const { return _lastBytes; } // Of the last flush
+  uint16_t maxBytes() const { return _maxBytes; }
+
+private:
+  bool changed(uint8_t row, uint8_t col) const {
+    return _text[row][col] != _shown[row][col];
+  }
+
+  Lcd &_lcd;
+  char _text[LCD_FRAME_ROWS][LCD_FRAME_COLUMNS];  // Rendered
+  char _shown[LCD_FRAME_ROWS][LCD_FRAME_COLUMNS]; // On the LCD
+  uint8_t _col;
+  uint8_t _row;
+  uint8_t _lcdCol; // LCD address counter, _lcdRow 0xff when unknown
+  uint8_t _lcdRow;
+
+  uint16_t _frames;
+  uint32_t _bytes;
+  uint16_t _lastBytes;
+  uint16_t _maxBytes;
+};
+
+extern LcdFrame lcdFrame;
+
+#endif // LCD16X2
+
+#endif // LCD_FRAME_H
@@ -0,0 +1,50 @@
+/*
+ * HD44780 character LCD on a PCF8574 I2C backpack, through the TWI queue
+ *
+ * Replaces the blocking LCD_I2C library. In 4-bit mode every HD44780 transfer
+ * is four port writes (each nibble strobed high then low on E), which all go
+ * into one queued I2C transaction together with the following transfers
+ * until flush(). At 100 kHz a port write takes longer than the 37 us an
+ * HD44780 instruction needs, so no delays are queued between transfers.
+ *
+ * begin() and clear() wait for the bus and the display, everything else
+ * returns as soon as the bytes are queued. canWrite() tells the caller
+ * whether a number of transfers still fit in the queue.
+ */
+#ifndef LCD_PCF8574_H
+#define LCD_PCF8574_H
+
+#include <Arduino.h>
+
+#define LCD_I2C_CLOCK 100000L // [Hz]
+
+class LcdPcf8574 {
+public:
+  LcdPcf8574(uint8_t address, uint8_t columns, uint8_t rows);
+
+  /* Start the TWI and initialise the display in 4-bit mode */
+  void begin();
+  void backlight();
+  void clear();
+  void setCursor(uint8_t col, uint8_t row);
+  size_t write(uint8_t c);
+  void print(const char *s);
+
+  /* Room in the queue for this many more transfers */
+  bool canWrite(uint8_t transfers) const;
+  /* Queue what was written since the last flush */
+  void flush();
+
+private:
+  void transfer(uint8_t value, uint8_t mode);
+  void command(uint8_t value) { transfer(value, 0); }
+  void nibble(uint8_t value);
+
+  uint8_t _address;
+  uint8_t _columns;
+  uint8_t _rows;
+  uint8_t _backlight; // Backlight bit of every port write
+  bool _open;         // A transaction is being built
+};
+
+#endif // LCD_PCF8574_H
@@ -0,0 +1,56 @@
+/*
+ * First-order-plus-dead-time plate model
+ *
+ * The plate heats at heating C/s with the SSR fully on and loses heat in
+ * proportion to how far it is above ambient; the reading shows all of it
+ * deadTime seconds late (sensor lag and the time heat takes to get through
+ * the plate):
+ *
+ *   dT/dt = heating * duty - loss * (T - ambient)
+ *
+ * It serves the control loop twice:
+ *
+ *   - feedforward: the duty that holds a setpoint moving at the profile's
+ *     ramp rate, (rate + loss * (setpoint - ambient)) / heating, goes
+ *     straight to the output and leaves the PID only the model error
+ *   - estimator: kalman.h predicts the plate with it, and the sensor lag
+ *     with the dead time as its time constant, and feeds the PID the plate
+ *     as it is rather than as the sensor shows it
+ *
+ * The MODEL_* defaults fit the stock plate; autotune.h identifies the model
+ * of the unit at hand and keeps it in the store.
+ */
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "hal.h"
+#include "store.h"
+
+#define MODEL_HEATING FIX16(1.33)   // [C/s]
+#define MODEL_LOSS FIX16(1.0 / 280) // [1/s]
+#define MODEL_DEAD_TIME 5           // [s]
+#define MODEL_DELAY_MAX 16          // Longest dead time kept [s]
+#define MODEL_AMBIENT FIX16(25)     // Taken for a plate warmer than [C]
+#define MODEL_AMBIENT_MAX FIX16(50)
+
+namespace model {
+
+/*
+ * Start of a run: the reading is taken as the ambient unless the plate is
+ * still warm from a run a reset cut short; the identified parameters if
+ * there are any
+ */
+void begin(const plantModel_t &params, fix16_t reading);
+
+/* Duty (0..FIX16_ONE) to follow setpoint moving at rate [C/s] */
+fix16_t feedForward(fix16_t setpoint, fix16_t rate);
+
+/* The two terms of the model on their own, for the estimator and the fault
+ * monitor [C/s] */
+fix16_t heatRate(fix16_t duty);
+fix16_t lossRate(fix16_t temperature);
+uint8_t deadTime(); // [s]
+
+} // namespace model
+
+#endif // MODEL_H
@@ -0,0 +1,59 @@
+/*
+ * Plate and sensor fault monitor
+ *
+ * Takes every sensor reading with the SSR duty it was read under, whether a
+ * run is on or not, and tells the faults apart by what the plate model of
+ * model.h expects of them:
+ *
+ *   - sensor: the reading is out of range (an open thermistor reads the bottom
+ *     of the table, a thermocouple fault reads below it) or jumps further
+ *     between two samples than a plate can move
+ *   - over-temperature: the reading, or the plate estimate of kalman.h if it
+ *     is higher, is above MONITOR_TEMPERATURE_MAX; the estimate does not lag
+ *     the plate like the sensor does
+ *   - heater not responding: over the last MONITOR_WINDOW samples the heat
+ *     the plate took up, its rise plus the model's loss, is under a quarter
+ *     of what the duty should have put in a dead time earlier
+ *   - heater stuck on: the SSR has been off for the whole history and the
+ *     plate still takes up half the heat of a full-on heater
+ *
+ * The heat the plate takes up is measured against the heater alone, not
+ * against the model's full prediction, so a plate that is slower or faster
+ * than the model only scales it; on a plate far off the defaults the model
+ * still needs identifying (autotune.h) before a dead heater is seen at reflow
+ * temperatures, where the losses are a large share of it.
+ *
+ * Each check trips after MONITOR_CONFIRM samples past its threshold and only
+ * forgets them once the reading is back well inside it, so noise around a
+ * threshold neither trips it nor keeps resetting the count.
+ *
+ * A detached sensor that still reads plausible values looks like a heater
+ * that does not respond, and is reported as one.
+ */
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include "model.h"
+#include "reflow.h"
+
+#define MONITOR_WINDOW 20 // Samples the heat is compared over [s]
+#define MONITOR_HISTORY (MONITOR_WINDOW + MODEL_DELAY_MAX)
+#define MONITOR_CONFIRM 3 // Samples a check must fail in a row
+#define MONITOR_SENSOR_MIN FIX16(1)          // [C]
+#define MONITOR_SENSOR_MAX FIX16(350)        // [C]
+#define MONITOR_SENSOR_STEP FIX16(20)        // Between two samples [C]
+#define MONITOR_TEMPERATURE_MAX FIX16(270)   // [C]
+#define MONITOR_HYSTERESIS FIX16(5)          // Back inside a limit by [C]
+
+namespace monitor {
+
+/*
+ * One reading per SENSOR_SAMPLING_TIME with the SSR duty (0..FIX16_ONE) that
+ * drove the heater since the last one and the plate estimate after it,
+ * returns the fault found or REFLOW_FAULT_NONE
+ */
+reflowFault_t update(fix16_t reading, fix16_t duty, fix16_t estimate);
+
+} // namespace monitor
+
+#endif // MONITOR_H
@@ -0,0 +1,12 @@
+/*
+ * Pre-1.0 Arduino header name, picked up by libraries that test
+ * ARDUINO >= 100 and fall back to WProgram.h on the host build.
+ */
+#ifndef WPROGRAM_H
+#define WPROGRAM_H
+
+#include "hal.h"
+
+using hal::millis;
+
+#endif // WPROGRAM_H
@@ -0,0 +1,23 @@
+/*
+ * The few AVR/Arduino definitions the control code relies on, for the host
+ * build ([env:native]). Flash-resident data lives in ordinary memory here.
+ */
+#ifndef ARDUINO_COMPAT_H
+#define ARDUINO_COMPAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(addr))
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+#define F(s) (s)
+
+void setup();
+void loop();
+
+#endif // ARDUINO_COMPAT_H
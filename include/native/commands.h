@@ -0,0 +1,39 @@
+/*
+ * Host tool sub-commands, selected by the first argument of the native
+ * program: .pio/build/native/program <command> [options]
+ */
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+/* FixedPID against PID_v1 on the simulated plate */
+int pidCheck(int argc, char **argv);
+
+/* Thermistor table against the Beta equation, oversampling noise */
+int ntcCheck(int argc, char **argv);
+
+/* Telemetry capture to CSV */
+int decodeTelemetry(int argc, char **argv);
+
+/* Calibration or user profile upload for the serial port */
+int encodeUpload(int argc, char **argv);
+
+/* EEPROM store against resets in the middle of commits, wear per byte */
+int storeCheck(int argc, char **argv);
+
+/* Fault monitor against injected sensor and heater faults, false trips */
+int faultCheck(int argc, char **argv);
+
+/* Sensor decodes against the datasheets, driver conversion schedule */
+int sensorCheck(int argc, char **argv);
+
+/* Button events against contact bounce, long press and repeat timing */
+int buttonCheck(int argc, char **argv);
+
+/* SSR engines compared: duty resolution, plate ripple, mains detection */
+int ssrCheck(int argc, char **argv);
+
+/* LF and PB profiles on a matrix of plates: solder-quality metrics, controller
+   time, limits and a baseline report */
+int bench(int argc, char **argv);
+
+#endif // COMMANDS_H
@@ -0,0 +1,56 @@
+/*
+ * Thermal plant simulator
+ *
+ * The hot plate is a single lumped thermal mass heated through the SSR and
+ * losing heat to ambient by convection and radiation. The temperature sensor
+ * sees the plate through a first-order lag and adds gaussian noise.
+ */
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <stdint.h>
+
+namespace sim {
+
+struct PlantParams {
+  double ambient;         // Ambient temperature [C]
+  double heatCapacity;    // Plate thermal mass [J/K]
+  double heaterPower;     // Heater power with the SSR on [W]
+  double lossCoefficient; // Convection/conduction loss to ambient [W/K]
+  double radiativeLoss;   // Emissivity * area * Stefan-Boltzmann [W/K^4]
+  double sensorLag;       // Sensor time constant [s]
+  double sensorNoise;     // Reading noise standard deviation [C]
+};
+
+/* A UYUE 946-style 400 W preheater with the thermistor taped to the plate */
+PlantParams defaultPlant();
+
+class Plant {
+public:
+  explicit Plant(const PlantParams &params, uint32_t seed = 1);
+
+  /* Plate and sensor at t, as if a run had just been cut short */
+  void setTemperature(double t) { _plate = _sensor = t; }
+
+  /* Advance the model by dt seconds with the heater driven at 0..1 */
+  void step(double dt, double heater);
+
+  double plate() const { return _plate; }
+  double sensor() const { return _sensor; }
+  /* Sensor temperature as the controller reads it, noise included */
+  double read();
+
+  const PlantParams &params() const { return _params; }
+
+private:
+  double gaussian();
+
+  PlantParams _params;
+  double _plate;
+  double _sensor;
+  uint32_t _rng;
+};
+
+} // namespace sim
+
+#endif // PLANT_H
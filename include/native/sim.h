@@ -0,0 +1,64 @@
+/*
+ * Host simulation harness
+ *
+ * Drives the native HAL: owns the virtual clock, the simulated plate and the
+ * simulated button, output and EEPROM state that the control code sees
+ * through hal.h.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#include "hal.h"
+#include "native/plant.h"
+#include <vector>
+
+namespace sim {
+
+/* Faults the simulation can be given, see inject() */
+enum Fault {
+  FAULT_NONE,
+  FAULT_SENSOR_OPEN,  // Reads the bottom of the thermistor table
+  FAULT_SENSOR_SHORT, // Reads the top of it
+  FAULT_HEATER_DEAD,  // SSR or heater open, no heat whatever the SSR pin
+  FAULT_HEATER_STUCK  // SSR shorted, full heat whatever the SSR pin
+};
+
+/* Start a new run: clock at zero, plate at ambient, EEPROM erased */
+void reset(const PlantParams &params, uint32_t seed = 1);
+
+/* Move the virtual clock forward, integrating the plant every millisecond */
+void advance(unsigned long ms);
+
+/* From now on until the next reset, FAULT_NONE to clear it */
+void inject(Fault fault);
+
+/* Mains frequency behind the SSRs, crossings reported through
+   hal::zeroCrossBegin(); 0 is no detector and SSRs that follow their pin at
+   once. A reset goes back to 50 Hz */
+void setMains(unsigned int hertz);
+
+/* Hold a button down (true) or release it (false) */
+void setButton(button_t button, bool pressed);
+
+/* Plate and SSR of a control channel (hal.h), the SSR conducting or not */
+Plant &plant(uint8_t channel = 0);
+bool ssr(uint8_t channel = 0);
+bool fan();
+bool buzzer();
+/* Energy delivered by the heater since reset [J] */
+double heaterEnergy();
+uint8_t *eeprom();
+/* Let count more EEPROM writes through, then drop them as a reset would;
+   negative for no limit */
+void eepromCutAfter(long count);
+/* Writes to one EEPROM byte and reads of all of them since reset */
+unsigned long eepromWrites(int address);
+unsigned long eepromReads();
+/* Everything written to the serial port since reset */
+const std::vector<uint8_t> &serial();
+/* A byte arriving on the serial port */
+void serialSend(uint8_t data);
+
+} // namespace sim
+
+#endif // SIM_H
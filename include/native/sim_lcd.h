@@ -0,0 +1,69 @@
+/*
+ * Character LCD stand-in for the host build. Keeps the screen contents in a
+ * buffer so the simulator can show what the controller displayed.
+ */
+#ifndef SIM_LCD_H
+#define SIM_LCD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class SimLcd {
+public:
+  static const uint8_t MAX_COLUMNS = 20;
+  static const uint8_t MAX_ROWS = 4;
+
+  SimLcd(uint8_t address, uint8_t columns, uint8_t rows)
+      : _columns(columns), _rows(rows), _col(0), _row(0) {
+    (void)address;
+    clear();
+  }
+
+  void begin() { clear(); }
+  void backlight() {}
+
+  void clear() {
+    for (uint8_t r = 0; r < MAX_ROWS; r++) {
+      memset(_text[r], ' ', MAX_COLUMNS);
+      _text[r][_columns] = '\0';
+    }
+    _col = 0;
+    _row = 0;
+  }
+
+  void setCursor(uint8_t col, uint8_t row) {
+    _col = col;
+    _row = row;
+  }
+
+  void print(const char *s) {
+    while (*s)
+      write(*s++);
+  }
+
+  size_t write(uint8_t c) {
+    if (_row < _rows && _col < _columns)
+      _text[_row][_col] = c;
+    _col++;
+    return 1;
+  }
+
+  /* No bus on the host: everything fits and is shown at once */
+  bool canWrite(uint8_t transfers) const {
+    (void)transfers;
+    return true;
+  }
+  void flush() {}
+
+  const char *row(uint8_t r) const { return _text[r]; }
+
+private:
+  uint8_t _columns;
+  uint8_t _rows;
+  uint8_t _col;
+  uint8_t _row;
+  char _text[MAX_ROWS][MAX_COLUMNS + 1];
+};
+
+#endif // SIM_LCD_H
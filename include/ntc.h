@@ -0,0 +1,78 @@
+/*
+ * NTC thermistor conversion
+ *
+ * The thermistor sits between the ADC input and ground with NTC_PULLUP to
+ * AVcc, so an ADC code a out of NTC_ADC_MAX gives R = Rp * a / (max - a)
+ * and, by the Beta equation, 1/T = 1/T0 + ln(R / R0) / B.
+ *
+ * That curve is evaluated by the compiler into a PROGMEM table of
+ * NTC_TABLE_SIZE points evenly spaced over the 13-bit range of the
+ * oversampled ADC (see adc.h); at run time a reading is one table lookup and
+ * a linear interpolation in integer arithmetic instead of a log() in
+ * soft-float. Between 20 and 300 C the interpolation stays within 0.25 C of
+ * the equation.
+ *
+ * Defaults are the 100k EPCOS B57560G104F with a 4.7k pull-up, thermistor
+ * type 1 of the ThermistorLibrary used before.
+ */
+#ifndef NTC_H
+#define NTC_H
+
+#include "fix16.h"
+
+#define NTC_BETA 4092.0      // [K]
+#define NTC_R0 100000.0      // Resistance at NTC_T0 [Ohm]
+#define NTC_T0 25.0          // [C]
+#define NTC_PULLUP 4700.0    // [Ohm]
+#define NTC_ADC_BITS 13      // Resolution of the oversampled reading
+#define NTC_ADC_MAX (1 << NTC_ADC_BITS)
+#define NTC_TABLE_SHIFT 5    // ADC codes per table step, log2
+#define NTC_TABLE_SIZE ((NTC_ADC_MAX >> NTC_TABLE_SHIFT) + 1)
+#define NTC_TEMPERATURE_MIN 0.0   // Table entries are clamped to [C]
+#define NTC_TEMPERATURE_MAX 400.0
+#define NTC_TABLE_SCALE 64   // Table units per C
+#define NTC_OPEN 2000000.0   // More is an open thermistor, about -45 C [Ohm]
+#define NTC_SHORT 20.0       // Less is a short to ground, 350 C is 78 [Ohm]
+
+namespace ntc {
+
+/* Temperature of a 13-bit ADC reading */
+fix16_t temperature(uint16_t adc);
+
+/* ADC code of a thermistor resistance */
+constexpr uint16_t adcCode(double ohms) {
+  return NTC_ADC_MAX * ohms / (ohms + NTC_PULLUP);
+}
+
+/* The Beta equation itself, evaluated at compile time for the table */
+constexpr double lnSeries(double y, double y2, double term, int k) {
+  return k > 25 ? 0 : term / k + lnSeries(y, y2, term * y2, k + 2);
+}
+/* ln(x) = k ln 2 + ln(m), m in [1, 2), ln(m) = 2 atanh((m - 1) / (m + 1)) */
+constexpr double ln(double x) {
+  return x >= 2   ? 0.6931471805599453 + ln(x / 2)
+         : x < 1  ? -0.6931471805599453 + ln(x * 2)
+                  : 2 * lnSeries((x - 1) / (x + 1),
+                                 ((x - 1) / (x + 1)) * ((x - 1) / (x + 1)),
+                                 (x - 1) / (x + 1), 1);
+}
+constexpr double clampAdc(double a) {
+  return a < 1 ? 1 : a > NTC_ADC_MAX - 1 ? NTC_ADC_MAX - 1 : a;
+}
+constexpr double clampTemperature(double t) {
+  return t < NTC_TEMPERATURE_MIN   ? NTC_TEMPERATURE_MIN
+         : t > NTC_TEMPERATURE_MAX ? NTC_TEMPERATURE_MAX
+                                   : t;
+}
+constexpr double betaTemperature(double adc) {
+  return clampTemperature(
+      1 / (1 / (NTC_T0 + 273.15) +
+           ln(NTC_PULLUP * clampAdc(adc) / (NTC_ADC_MAX - clampAdc(adc)) /
+              NTC_R0) /
+               NTC_BETA) -
+      273.15);
+}
+
+} // namespace ntc
+
+#endif // NTC_H
@@ -0,0 +1,47 @@
+/*
+ * Temperature chart on the 128x64 OLED
+ *
+ * The chart sits in display pages 2..7 right of a temperature axis at column
+ * CHART_AXIS_X, above a time axis on the bottom row. The controller keeps one
+ * sample (a pixel row) per chart column in temperature[]; that is all the
+ * chart state there is, a RAM copy of the 1 KB display would not fit beside
+ * the rest of the firmware. Every column's page bytes follow from its sample
+ * and the axis, so a new sample is drawn by writing the one byte it changes
+ * and a refresh costs the same however many samples are on the chart.
+ *
+ * Runs of bytes on a page (the axes, blanking the chart for a new run) are
+ * one cursor move and one queued I2C transaction of RAM bytes each, see
+ * ssd1306_twi.h. Every call queues what it drew before returning.
+ */
+#ifndef OLED_CHART_H
+#define OLED_CHART_H
+
+#ifdef SSD1306
+
+#include "ssd1306_twi.h"
+
+#define CHART_AXIS_X 18   // Column of the temperature axis
+#define CHART_AXIS_TOP 18 // First pixel row of the temperature axis
+#define CHART_BOTTOM 63   // Pixel row of the time axis
+#define CHART_FIRST_PAGE (CHART_AXIS_TOP >> 3)
+#define CHART_LAST_PAGE (CHART_BOTTOM >> 3)
+#define CHART_WIDTH (128 - CHART_AXIS_X - 1) // Sample columns
+
+namespace chart {
+
+void begin(SSD1306AsciiTwi &oled);
+
+/* Both axes, once after the display is cleared */
+void drawAxes();
+
+/* Blank every sample column, leaving the axes */
+void clear();
+
+/* Draw sample 0..CHART_WIDTH-1 at pixel row y into its blank column */
+void plot(uint8_t sample, uint8_t y);
+
+} // namespace chart
+
+#endif // SSD1306
+
+#endif // OLED_CHART_H
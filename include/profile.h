@@ -0,0 +1,115 @@
+/*
+ * Reflow profile engine
+ *
+ * A profile is a PROGMEM table of segments run in order by one interpreter.
+ * Each segment moves the setpoint toward its target in its own way and
+ * reports the reflow state to show while it runs:
+ *
+ *   SEGMENT_RAMP  setpoint rises at rate toward target (rate 0 steps to it);
+ *                 done once it is there and the reading is within band
+ *   SEGMENT_HOLD  setpoint stays at target for time seconds
+ *   SEGMENT_COOL  setpoint falls at rate toward target (rate 0 steps to it);
+ *                 done once it is there and the reading is within band
+ *
+ * update() runs on every control tick and interpolates the setpoint from the
+ * time since the last tick, so ramps are smooth lines instead of stairs. The
+ * first segment starts from the plate temperature, each further one from
+ * where the previous one left the setpoint.
+ *
+ * The built-in profiles are in src/profiles.cpp; reflowProfile_t indexes
+ * them, and the user profiles kept in the store (store.h) follow as further
+ * indexes.
+ *
+ * The PID gains follow the plate temperature rather than the segments: each
+ * profile has a gain schedule, a short table of gains at rising
+ * temperatures, and gains() interpolates it on the reading (and holds the
+ * end points beyond it). The PID task looks the gains up again each time the
+ * plate has moved a degree, CHANNEL_GAIN_STEP in channel.h, not at every
+ * control tick. The plate needs more gain as it gets hotter and its radiative
+ * losses grow, and a schedule changes the gains in degree steps instead of
+ * stepping them at stage changes. A schedule in the store
+ * (autotune.h writes one) replaces the one of the profile; user profiles run
+ * with defaultSchedule[].
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "hal.h"
+#include "reflow.h"
+#include "store.h"
+
+typedef enum SEGMENT_TYPE {
+  SEGMENT_RAMP,
+  SEGMENT_HOLD,
+  SEGMENT_COOL
+} segmentType_t;
+
+typedef struct PROFILE_SEGMENT {
+  uint8_t type;   // segmentType_t
+  uint8_t state;  // reflowState_t shown while the segment runs
+  int16_t target; // [C]
+  fix16_t rate;   // Ramp and cool [C/s]
+  uint16_t time;  // Hold [s]
+  uint8_t band;   // Ramp and cool end this close to target [C]
+} profileSegment_t;
+
+typedef struct PROFILE {
+  char name[3];     // Two letters for the display
+  int16_t liquidus; // Of the solder, for the run log [C]
+  uint8_t count;
+  const profileSegment_t *segments;
+  uint8_t points;
+  const schedulePoint_t *schedule; // Rising temperature
+} profile_t;
+
+extern const profile_t builtinProfiles[] PROGMEM;
+extern const uint8_t builtinProfileCount;
+extern const schedulePoint_t defaultSchedule[] PROGMEM;
+extern const uint8_t defaultSchedulePoints;
+
+namespace profile {
+
+/*
+ * Load profile number index and start segment from reading, the first one
+ * unless a run cut short by a reset goes on
+ */
+void begin(uint8_t index, fix16_t reading, unsigned long now,
+           uint8_t segment = 0);
+
+/* Control tick: advance the setpoint, returns true when the segment changed */
+bool update(fix16_t reading, unsigned long now);
+
+/* All segments done */
+bool done();
+
+fix16_t setpoint();
+/* Rate the setpoint ramps at [C/s], 0 on holds and once at the target */
+fix16_t rate();
+reflowState_t state();
+/* Segment in progress, valid until done() */
+const profileSegment_t &segment();
+/* Its number in the profile */
+uint8_t position();
+
+/* PID gains at the plate temperature reading */
+void gains(fix16_t reading, tuning_t *gains);
+
+/* Built-in and user profiles */
+uint8_t count();
+
+/* Name, highest target and solder liquidus of a profile */
+void name(uint8_t index, char *buffer); // 3 bytes
+int16_t peak(uint8_t index);
+/* Highest target of the segments shown as state, 0 if there are none */
+int16_t target(uint8_t index, reflowState_t state);
+int16_t liquidus(uint8_t index);
+
+/*
+ * A user profile that can run: known segment types, each shown as one of the
+ * run's states, ramps and cools that move; count 0 is an empty slot
+ */
+bool valid(const userProfile_t &user);
+
+} // namespace profile
+
+#endif // PROFILE_H
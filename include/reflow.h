@@ -0,0 +1,57 @@
+/*
+ * Reflow controller state shared between the control code in main.cpp and
+ * anything that observes it (the host simulator, diagnostics).
+ */
+#ifndef REFLOW_H
+#define REFLOW_H
+
+#include "channel.h"
+#include "fix16.h"
+
+// ***** TYPE DEFINITIONS *****
+typedef enum REFLOW_STATE {
+  REFLOW_STATE_IDLE,
+  REFLOW_STATE_PREHEAT,
+  REFLOW_STATE_SOAK,
+  REFLOW_STATE_REFLOW,
+  REFLOW_STATE_COOL,
+  REFLOW_STATE_COMPLETE,
+  REFLOW_STATE_TOO_HOT,
+  REFLOW_STATE_ERROR,
+  REFLOW_STATE_AUTOTUNE // Relay experiment instead of a profile, autotune.h
+} reflowState_t;
+
+typedef enum REFLOW_STATUS {
+  REFLOW_STATUS_OFF,
+  REFLOW_STATUS_ON
+} reflowStatus_t;
+
+/* Why the last run ended early */
+typedef enum REFLOW_FAULT {
+  REFLOW_FAULT_NONE,
+  REFLOW_FAULT_ABORTED, // Start/Stop pressed during the run
+  REFLOW_FAULT_SENSOR,   // Sensor did not respond, is open, shorted or jumps
+  REFLOW_FAULT_HEATER,   // Heater on, plate not heating, see monitor.h
+  REFLOW_FAULT_AUTOTUNE, // Autotune timed out or found no oscillation
+  REFLOW_FAULT_STUCK_ON, // Heater off, plate heating anyway
+  REFLOW_FAULT_OVERTEMP, // Plate above MONITOR_TEMPERATURE_MAX
+  REFLOW_FAULT_RESET     // Reset during the run, the plate cooled too far
+} reflowFault_t;
+
+typedef enum REFLOW_PROFILE {
+  REFLOW_PROFILE_LEADFREE,
+  REFLOW_PROFILE_LEADED
+} reflowProfile_t;
+
+extern reflowState_t reflowState;
+extern reflowStatus_t reflowStatus;
+extern reflowProfile_t reflowProfile;
+extern reflowFault_t reflowFault;
+
+extern PlateChannel plate;
+#if CONTROL_CHANNELS > 1
+extern AuxChannel aux;
+#endif
+extern unsigned long firstRead; // hal::millis() of the first reading at boot
+
+#endif // REFLOW_H
@@ -0,0 +1,134 @@
+/*
+ * Run history log
+ *
+ * The EEPROM after the store (RUNLOG_BASE..RUNLOG_BASE + RUNLOG_SIZE - 1)
+ * keeps what happened in the last runs, so a board can be audited without a
+ * PC attached during the run:
+ *
+ *   - a ring of RUNLOG_SUMMARIES run summaries, one written as each run
+ *     ends: peak, time above the solder liquidus, steepest ramp, time in
+ *     each stage and the fault that ended it, if any
+ *   - the trace of the last run: the reading every RUNLOG_TRACE_INTERVAL
+ *     seconds in 1/RUNLOG_TRACE_SCALE C, each as the zigzag varint of its
+ *     difference to the one before. A ramp under 4 C/s costs one byte per
+ *     sample, so RUNLOG_TRACE_BYTES hold over 20 minutes; a longer run
+ *     keeps its first part and is marked truncated.
+ *
+ * An EEPROM byte takes 3.3 ms to write and the next one waits for it, so
+ * nothing is written where it is logged: trace bytes are queued as the run
+ * goes, and the summary and the trace header, each with a CRC16 in its last
+ * bytes, when it ends. runlog::flush() writes one queued byte per call and
+ * the controller calls it every RUNLOG_WRITE_INTERVAL ms, after the last
+ * write is done, so the log never holds up the control tasks. A reset before
+ * a record is through leaves it failing its CRC. Reading the log between
+ * runs, or starting one, first writes out whatever is still queued; during a
+ * run reads see what has been written so far.
+ *
+ * A checkpoint of the run in progress (its number, profile, segment and the
+ * reading the segment started from) is queued when it starts and at every
+ * segment change, ahead of the trace, with its CRC last. A run cut short by a reset
+ * leaves the previous summaries, no trace and a checkpoint newer than the
+ * last summary, from which the next boot resumes it or logs it as ended by
+ * the reset.
+ *
+ * The log is sent over the serial port on request, see telemetry.h.
+ */
+#ifndef RUNLOG_H
+#define RUNLOG_H
+
+#include "hal.h"
+#include "reflow.h"
+#include "store.h"
+
+#define RUNLOG_BASE STORE_SIZE
+#define RUNLOG_SIZE 512
+#define RUNLOG_SUMMARIES 8
+#define RUNLOG_STAGES 4          // Preheat, soak, reflow, cool
+#define RUNLOG_RAMP_SPAN 4       // Ramp rates over readings this far apart [s]
+#define RUNLOG_TRACE_INTERVAL 4  // [s]
+#define RUNLOG_TRACE_SCALE 4     // Trace units per C
+#define RUNLOG_SUMMARY_SCALE 16  // Summary units per C
+#define RUNLOG_TRACE_QUEUE 16    // Trace bytes waiting for flush()
+#define RUNLOG_WRITE_INTERVAL 4  // flush() calls apart, over a write [ms]
+
+typedef struct RUN_SUMMARY {
+  uint16_t run;                    // Run number, counts up
+  uint8_t profile;                 // reflowProfile_t
+  uint8_t fault;                   // reflowFault_t
+  int16_t peak;                    // [1/RUNLOG_SUMMARY_SCALE C]
+  uint16_t aboveLiquidus;          // [s]
+  int16_t maxRamp;                 // [1/RUNLOG_SUMMARY_SCALE C/s]
+  uint16_t stage[RUNLOG_STAGES];   // Time in each stage [s]
+  uint16_t duration;               // [s]
+  uint16_t crc;
+} runSummary_t;
+
+typedef struct RUN_TRACE {
+  uint16_t run;
+  uint8_t interval;  // [s]
+  uint8_t truncated; // Ran out of room before the run ended
+  int16_t first;     // First reading [1/RUNLOG_TRACE_SCALE C]
+  uint16_t length;   // Bytes of deltas
+  uint16_t crc;      // Over the fields before and the deltas
+} runTrace_t;
+
+typedef struct RUN_CHECKPOINT {
+  uint16_t run;
+  uint8_t profile;
+  uint8_t segment; // Profile segment in progress
+  uint8_t state;   // reflowState_t
+  int16_t reading; // At the segment start [1/RUNLOG_SUMMARY_SCALE C]
+  uint16_t crc;
+} runCheckpoint_t;
+
+#define RUNLOG_CHECKPOINT_BASE                                                 \
+  (RUNLOG_BASE + RUNLOG_SUMMARIES * sizeof(runSummary_t))
+#define RUNLOG_TRACE_BASE (RUNLOG_CHECKPOINT_BASE + sizeof(runCheckpoint_t))
+#define RUNLOG_TRACE_DATA (RUNLOG_TRACE_BASE + sizeof(runTrace_t))
+#define RUNLOG_TRACE_BYTES (RUNLOG_BASE + RUNLOG_SIZE - RUNLOG_TRACE_DATA)
+
+namespace runlog {
+
+/* Find the newest run in the log */
+void begin();
+
+/* A run starts: profile and its liquidus [C], the first reading */
+void start(uint8_t profile, int16_t liquidus, fix16_t reading,
+           unsigned long now);
+
+/* The run in progress started a segment */
+void checkpoint(uint8_t segment, reflowState_t state, fix16_t reading);
+
+/* Checkpoint of a run a reset cut short, false if the last run ended */
+bool interrupted(runCheckpoint_t *checkpoint);
+
+/* Go on with the interrupted run, as start() with a new trace */
+void resume(const runCheckpoint_t &checkpoint, int16_t liquidus,
+            fix16_t reading, unsigned long now);
+
+/* Log the interrupted run as ended by REFLOW_FAULT_RESET */
+void abandon(const runCheckpoint_t &checkpoint);
+
+/* Sensor tick while the run is on */
+void sample(fix16_t reading, reflowState_t state, unsigned long now);
+
+/* The run ended, write its summary and trace header */
+void end(reflowFault_t fault, unsigned long now);
+
+/* Between start() and end() */
+bool active();
+
+/* Write one queued byte, if any */
+void flush();
+
+/* Valid summaries in the log, and the i-th one, oldest first */
+uint8_t count();
+bool summary(uint8_t i, runSummary_t *summary);
+
+/* Trace of the last run and its bytes, false if there is none */
+bool trace(runTrace_t *trace);
+uint8_t traceByte(uint16_t i);
+
+} // namespace runlog
+
+#endif // RUNLOG_H
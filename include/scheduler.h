@@ -0,0 +1,78 @@
+/*
+ * Cooperative deadline scheduler
+ *
+ * A fixed table of tasks registered once in setup(). Each task is either
+ * periodic or one-shot and is started, re-armed or stopped by its id. run()
+ * is called from loop() and dispatches every task whose deadline has passed,
+ * highest priority first, each at most once per call. Deadlines are compared
+ * as signed differences so they survive the millis() wrap after ~49 days.
+ *
+ * Every dispatch records how late the task started against its deadline and
+ * how long it ran, so a slow display refresh shows up as lateness on the
+ * control tasks instead of silently delaying them.
+ */
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "hal.h"
+
+#define SCHEDULER_MAX_TASKS 7
+
+typedef void (*taskFunction_t)();
+
+typedef enum TASK_PRIORITY {
+  TASK_PRIORITY_CONTROL, // Sensor, PID and SSR work
+  TASK_PRIORITY_NORMAL,  // Timers of the reflow state machine
+  TASK_PRIORITY_DISPLAY  // Display refresh
+} taskPriority_t;
+
+typedef struct TASK_STATS {
+  uint16_t runs;         // Number of dispatches
+  uint16_t late;         // Dispatches that started after their deadline
+  uint16_t overruns;     // Periodic releases skipped because we fell behind
+  uint16_t minLateness;  // [ms]
+  uint16_t maxLateness;  // [ms]
+  uint32_t sumLateness;  // [ms], mean = sumLateness / runs
+  uint16_t maxRunTime;   // [ms]
+} taskStats_t;
+
+class Scheduler {
+public:
+  Scheduler();
+
+  /* Register a task, returns its id or -1 when the table is full */
+  int8_t add(taskFunction_t function, taskPriority_t priority, PGM_P name);
+
+  /* Arm a task to run in delay ms, then every period ms (0 = one-shot) */
+  void start(uint8_t id, unsigned long delay, unsigned long period = 0);
+  void stop(uint8_t id);
+  bool active(uint8_t id) const;
+
+  /* Dispatch all due tasks, highest priority first */
+  void run();
+
+  uint8_t count() const { return _count; }
+  PGM_P name(uint8_t id) const { return _tasks[id].name; }
+  const taskStats_t &stats(uint8_t id) const { return _tasks[id].stats; }
+  void resetStats();
+
+private:
+  struct task_t {
+    taskFunction_t function;
+    PGM_P name;
+    unsigned long deadline;
+    unsigned long period;
+    uint8_t priority;
+    bool active;
+    taskStats_t stats;
+  };
+
+  void dispatch(uint8_t id, unsigned long now);
+
+  task_t _tasks[SCHEDULER_MAX_TASKS];
+  uint8_t _count;
+};
+
+extern Scheduler scheduler;
+
+#endif // SCHEDULER_H
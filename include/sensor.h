@@ -0,0 +1,102 @@
+/*
+ * Temperature sensor drivers
+ *
+ * A driver derives from SensorDriver<Driver> (CRTP) and supplies
+ *
+ *   bool init(uint8_t pin)     set the device up on its chip select or ADC
+ *                              input, false if it does not answer
+ *   void convert()             start a conversion
+ *   sensorSample_t collect()   read the finished one, without waiting
+ *   CONVERSION_TIME            from convert() to collect() [ms]
+ *   FREE_RUNNING               true if the device converts on its own from
+ *                              power-up, so a result is ready at begin()
+ *
+ * A one-shot device has no result at begin(): its sample is
+ * SENSOR_FAULT_NOT_READY until poll() collects the first conversion, a
+ * CONVERSION_TIME later.
+ *
+ * The base class runs them: poll() collects a conversion once its time is
+ * up and starts the next one, so a read never waits on the device, and the
+ * calls resolve at compile time with no virtual dispatch. Which driver a
+ * build uses is a build flag (hal_avr.cpp): THERMLIB, MAX31855, MAX31856 or
+ * MAX6675.
+ *
+ * Every sample carries the device's fault bits and, for the thermocouple
+ * converters that measure it, the cold-junction temperature. The decode
+ * functions turn the raw device words into samples and are shared with the
+ * host checks (program sensor-check).
+ */
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include "hal.h"
+
+#define SENSOR_FAULT_OPEN 0x01      // Thermocouple or thermistor open
+#define SENSOR_FAULT_SHORT_GND 0x02 // Input shorted to ground
+#define SENSOR_FAULT_SHORT_VCC 0x04 // Input shorted to the supply
+#define SENSOR_FAULT_RANGE 0x08     // Outside what the device converts
+#define SENSOR_FAULT_NO_DEVICE 0x10 // Nothing answered on the bus
+#define SENSOR_FAULT_NOT_READY 0x20 // First conversion not collected yet
+#define SENSOR_NO_COLD_JUNCTION FIX16_MIN // Not measured by the device
+
+typedef struct SENSOR_SAMPLE {
+  fix16_t temperature;  // [C], only valid without faults
+  fix16_t coldJunction; // [C], or SENSOR_NO_COLD_JUNCTION
+  uint8_t faults;       // SENSOR_FAULT_ bits
+} sensorSample_t;
+
+template <class Driver> class SensorDriver {
+public:
+  /* Set the device up and start converting, returns false on no answer */
+  bool begin(uint8_t pin, unsigned long now) {
+    bool found = self().init(pin);
+    if (Driver::FREE_RUNNING) {
+      _sample = self().collect();
+    } else {
+      sensorSample_t none = {0, SENSOR_NO_COLD_JUNCTION,
+                             SENSOR_FAULT_NOT_READY};
+      _sample = none;
+    }
+    start(now);
+    return found && !(_sample.faults & SENSOR_FAULT_NO_DEVICE);
+  }
+
+  /* Collect a finished conversion and start the next, never waits */
+  void poll(unsigned long now) {
+    if ((long)(now - _due) < 0)
+      return;
+    _sample = self().collect();
+    start(now);
+  }
+
+  /* Last collected */
+  const sensorSample_t &sample() const { return _sample; }
+
+private:
+  void start(unsigned long now) {
+    self().convert();
+    _due = now + Driver::CONVERSION_TIME;
+  }
+  Driver &self() { return *static_cast<Driver *>(this); }
+
+  sensorSample_t _sample;
+  unsigned long _due; // [ms]
+};
+
+namespace sensor {
+
+/* 13-bit oversampled thermistor ADC code (ntc.h) */
+sensorSample_t decodeThermistor(uint16_t adc);
+
+/* MAX31855 32-bit word */
+sensorSample_t decodeMax31855(uint32_t word);
+
+/* MAX6675 16-bit word */
+sensorSample_t decodeMax6675(uint16_t word);
+
+/* MAX31856 registers CJTH, CJTL, LTCBH, LTCBM, LTCBL and SR in that order */
+sensorSample_t decodeMax31856(const uint8_t registers[6]);
+
+} // namespace sensor
+
+#endif // SENSOR_H
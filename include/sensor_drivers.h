@@ -0,0 +1,81 @@
+/*
+ * Temperature sensor drivers - ATmega328P
+ *
+ *   Thermistor  NTC divider on an ADC input (ntc.h), read from the
+ *               free-running ADC ring (adc.h), so there is nothing to start
+ *   Max31855    K thermocouple, converts continuously while its chip select
+ *               is high, a result every 100 ms
+ *   Max6675     K thermocouple, 12 bits, the same way every 220 ms; no cold
+ *               junction reading and only open-circuit detection
+ *   Max31856    Any thermocouple type, set up for K here, in one-shot mode:
+ *               convert() asks for a conversion, ready 200 ms later with the
+ *               60 Hz filter and open-circuit detection on; mains() moves
+ *               the notch to 50 Hz. Its fault status also covers the range
+ *               and the cold junction.
+ *
+ * The pin of begin() is the ADC channel for the thermistor and the chip
+ * select for the converters, all on the soft SPI bus (soft_spi.h).
+ */
+#ifndef SENSOR_DRIVERS_H
+#define SENSOR_DRIVERS_H
+
+#include "sensor.h"
+
+class Thermistor : public SensorDriver<Thermistor> {
+public:
+  static const unsigned int CONVERSION_TIME = 100; // The ADC ring's span
+  static const bool FREE_RUNNING = true;
+
+  bool init(uint8_t channel);
+  void convert() {}
+  sensorSample_t collect();
+
+private:
+  uint8_t _channel;
+};
+
+class Max31855 : public SensorDriver<Max31855> {
+public:
+  static const unsigned int CONVERSION_TIME = 100;
+  static const bool FREE_RUNNING = true;
+
+  bool init(uint8_t cs);
+  void convert() {} // Deselecting after a read starts the next one
+  sensorSample_t collect();
+
+private:
+  uint8_t _cs;
+};
+
+class Max6675 : public SensorDriver<Max6675> {
+public:
+  static const unsigned int CONVERSION_TIME = 220;
+  static const bool FREE_RUNNING = true;
+
+  bool init(uint8_t cs);
+  void convert() {}
+  sensorSample_t collect();
+
+private:
+  uint8_t _cs;
+};
+
+class Max31856 : public SensorDriver<Max31856> {
+public:
+  static const unsigned int CONVERSION_TIME = 200;
+  static const bool FREE_RUNNING = false;
+
+  bool init(uint8_t cs);
+  void convert();
+  sensorSample_t collect();
+
+  /* Mains rejection filter for 50 or 60 Hz, from the next conversion */
+  void mains(uint8_t hertz);
+
+private:
+  void write(uint8_t address, uint8_t value);
+  uint8_t _cs;
+  uint8_t _cr0; // Without the one-shot bit
+};
+
+#endif // SENSOR_DRIVERS_H
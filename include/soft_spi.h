@@ -0,0 +1,39 @@
+/*
+ * Bit-banged SPI master for the thermocouple converters
+ *
+ * The ATmega328P's SPI pins (D10 to D13) carry three of the buttons on this
+ * board, so the converters share three other pins and are clocked in
+ * software with direct port access, about 1 us a bit: a MAX31855 word takes
+ * some 40 us of loop(), the conversions themselves run while it does other
+ * work (sensor.h). Chip selects are per device, high when idle.
+ *
+ * read() is SPI mode 0 for the read-only MAX31855 and MAX6675: the device
+ * shifts on the falling clock edge and the bit is taken before the rising
+ * one. transfer() is mode 1 for the MAX31856: both sides shift on the rising
+ * edge and sample on the falling one.
+ */
+#ifndef SOFT_SPI_H
+#define SOFT_SPI_H
+
+#include <Arduino.h>
+
+namespace softspi {
+
+/* Clock and data pins, mosi is not driven if 0xff */
+void begin(uint8_t sck, uint8_t miso, uint8_t mosi);
+
+/* Chip select of a device as an idle output */
+void attach(uint8_t cs);
+
+void select(uint8_t cs);
+void deselect(uint8_t cs);
+
+/* Mode 0 byte in, MSB first */
+uint8_t read();
+
+/* Mode 1 byte out and in, MSB first */
+uint8_t transfer(uint8_t out);
+
+} // namespace softspi
+
+#endif // SOFT_SPI_H
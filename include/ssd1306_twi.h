@@ -0,0 +1,39 @@
+/*
+ * SSD1306Ascii over the TWI queue
+ *
+ * Takes the place of SSD1306AsciiWire: bytes the library writes are appended
+ * to one queued I2C transaction for as long as they are of the same kind
+ * (commands or display RAM), so a cursor move is one transaction and a run
+ * of glyph or chart bytes another, instead of one per byte. flush() queues
+ * the transaction being built; call it at the end of every update.
+ *
+ * When the queue is full the library has to wait for room, since it cannot
+ * drop half a glyph. updateDisplay() avoids that by skipping a refresh while
+ * the previous one is still going out.
+ */
+#ifndef SSD1306_TWI_H
+#define SSD1306_TWI_H
+
+#include <SSD1306Ascii.h>
+
+#define SSD1306_I2C_CLOCK 400000L // [Hz]
+
+class SSD1306AsciiTwi : public SSD1306Ascii {
+public:
+  SSD1306AsciiTwi() : _address(0), _control(NO_TRANSACTION) {}
+
+  /* Start the TWI and initialise the display, waits for the bus */
+  void begin(const DevType *dev, uint8_t address);
+  void flush();
+
+protected:
+  void writeDisplay(uint8_t b, uint8_t mode);
+
+private:
+  static const uint8_t NO_TRANSACTION = 0xff;
+
+  uint8_t _address;
+  uint8_t _control; // Control byte of the open transaction
+};
+
+#endif // SSD1306_TWI_H
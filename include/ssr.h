@@ -0,0 +1,89 @@
+/*
+ * SSR output engines
+ *
+ * SSR_MODE_WINDOW, time proportioning: the heater is switched in windows of
+ * SSR_WINDOW_SIZE ms split into SSR_RESOLUTION steps. A hardware timer calls
+ * ssr::tick() once per step and the tick sets the SSR pin, so the on-time is
+ * exact to one step no matter how long loop() takes. The duty is latched at
+ * the start of each window. With a zero-cross SSR that is 1% resolution and
+ * the plate sees the heater on for up to two seconds at a time.
+ *
+ * SSR_MODE_BURST and SSR_MODE_HALF_CYCLE follow the mains instead: a
+ * zero-cross detector (hal::zeroCrossBegin()) calls ssr::halfCycle() at every
+ * crossing and a Bresenham accumulator decides whether the next half-cycle
+ * conducts, spreading the duty evenly over the mains to SSR_DUTY_MAX
+ * resolution. Burst switches whole cycles, the first half-cycle deciding for
+ * both, so the load never draws a DC component. Half-cycle keeps one
+ * accumulator per polarity, half a cycle apart: a low duty comes as single
+ * half-cycles twice as often, and the polarities still balance to within one
+ * half-cycle.
+ *
+ * The mains frequency is measured over the first SSR_DETECT half-cycles, in
+ * any mode; the half-cycle engines start once it has come out as 50 or 60 Hz.
+ * Until then, with no detector, or if the crossings stop for
+ * SSR_ZERO_CROSS_LOST ticks, the output runs (or falls back to) windows.
+ *
+ * Each control channel (hal.h) has its own SSR and duty. Their windows, and
+ * the starting points of their accumulators, are staggered by a fraction
+ * CONTROL_CHANNELS of the window, so heaters that share a supply overlap
+ * only as much as their duties add up past one. ssr::off() cuts a heater
+ * immediately.
+ */
+#ifndef SSR_H
+#define SSR_H
+
+#include "hal.h"
+
+#define SSR_WINDOW_SIZE 2000                          // [ms]
+#define SSR_RESOLUTION 100                            // Steps per window
+#define SSR_TICK (SSR_WINDOW_SIZE / SSR_RESOLUTION)   // [ms]
+#define SSR_DUTY_MAX 1000   // Full duty, the half-cycle engines' resolution
+#define SSR_DETECT 50       // Half-cycles timed for the mains frequency
+#define SSR_ZERO_CROSS_LOST 3 // Ticks without a crossing to fall back
+
+typedef enum SSR_MODE {
+  SSR_MODE_WINDOW,     // Time-proportioning windows on the timer
+  SSR_MODE_BURST,      // Whole mains cycles, zero-cross detector
+  SSR_MODE_HALF_CYCLE, // Half-cycles, polarity balanced, zero-cross detector
+  SSR_MODES
+} ssrMode_t;
+
+#ifndef SSR_MODE
+#define SSR_MODE SSR_MODE_WINDOW // Needs no zero-cross detector
+#endif
+
+namespace ssr {
+
+/* Start the window timer and the zero-cross detection, heaters off */
+void begin(ssrMode_t mode);
+
+/* Engine in use: mode of begin(), or SSR_MODE_WINDOW until the mains
+ * frequency is known and whenever the crossings stop */
+ssrMode_t mode();
+
+/* Mains frequency [Hz], 0 until measured or if it is neither 50 nor 60 */
+uint8_t mainsFrequency();
+
+/* Heater duty for the coming windows or half-cycles, 0..SSR_DUTY_MAX */
+void setDuty(uint8_t channel, uint16_t duty);
+uint16_t duty(uint8_t channel);
+
+/*
+ * Ticks of the engine in use (window steps or half-cycles), all and those
+ * the heater was on for, counting up and wrapping at 65536: the ratio of
+ * the differences between two calls is the duty over that time
+ */
+void ticks(uint8_t channel, uint16_t *all, uint16_t *on);
+
+/* Heater off now, without waiting for the end of the window */
+void off(uint8_t channel);
+
+/* Timer interrupt, once every SSR_TICK ms */
+void tick();
+
+/* Zero-cross interrupt, once every mains half-cycle */
+void halfCycle();
+
+} // namespace ssr
+
+#endif // SSR_H
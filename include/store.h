@@ -0,0 +1,131 @@
+/*
+ * Persistent settings store
+ *
+ * The first STORE_SIZE bytes of EEPROM hold four records: settings
+ * (selected profile and sensor calibration), the PID gain schedule, the
+ * user profiles and the plate model (model.h). Each record owns a fixed
+ * partition of slots, and every commit writes the whole record into the
+ * slot after the newest one:
+ *
+ *   [sequence lo, hi][STORE_VERSION][record ...][CRC16 lo, hi]
+ *
+ * The CRC (CCITT, over sequence, version and record) is written last. The
+ * newest valid copy is never overwritten, so a reset in the middle of a
+ * commit leaves a bad CRC in the new slot and the previous copy in force.
+ * Rotating through the slots spreads the wear: settings change with every
+ * Profile press and get STORE_SETTINGS_SLOTS of them.
+ *
+ * Changes are made to the RAM copies and marked with change(); main.cpp
+ * commits them from a one-shot task that every change re-arms, so a burst of
+ * presses ends in one write, and a record that ends up as it was is not
+ * written at all. Bytes that already hold the value are skipped.
+ *
+ * begin() reads every slot once, 478 bytes on the AVR, and takes the valid
+ * copy with the highest sequence number for each record. Old firmware kept
+ * only the profile in the byte at address 0; without a valid settings
+ * record, and if the two bytes after it are still erased as that firmware
+ * left them, that byte is taken over once. Looking for it reads up to three
+ * bytes more, 479 in all on an erased EEPROM.
+ */
+#ifndef STORE_H
+#define STORE_H
+
+#include "hal.h"
+
+#define STORE_SIZE 512     // EEPROM 0..511, the run log (runlog.h) follows
+#define STORE_VERSION 3    // Bump when a record layout changes
+#define STORE_COMMIT_DELAY 5000 // Quiet time before a change is written [ms]
+
+#define STORE_SETTINGS_SLOTS 8
+#define STORE_SCHEDULE_SLOTS 2
+#define STORE_PROFILES_SLOTS 2
+#define STORE_MODEL_SLOTS 2
+
+// Records have the byte layout of the AVR on the host too
+#define STORE_PACKED __attribute__((packed))
+
+#define STORE_SCHEDULE_POINTS 4
+#define STORE_USER_PROFILES 2
+#define STORE_USER_SEGMENTS 5
+
+typedef enum STORE_RECORD {
+  STORE_SETTINGS,
+  STORE_SCHEDULE,
+  STORE_PROFILES,
+  STORE_MODEL,
+  STORE_RECORDS
+} storeRecord_t;
+
+typedef struct STORE_PACKED SETTINGS {
+  uint8_t profile;      // reflowProfile_t
+  fix16_t sensorOffset; // Added to the reading [C]
+  fix16_t sensorGain;   // Reading scale, FIX16_ONE for none
+} settings_t;
+
+typedef struct STORE_PACKED TUNING {
+  fix16_t kp;
+  fix16_t ki;
+  fix16_t kd;
+} tuning_t;
+
+/* Gains at one plate temperature, see profile.h */
+typedef struct STORE_PACKED SCHEDULE_POINT {
+  int16_t temperature; // [C]
+  tuning_t gains;
+} schedulePoint_t;
+
+typedef struct STORE_PACKED GAIN_SCHEDULE {
+  uint8_t count; // 0 for none, the profile schedule applies
+  schedulePoint_t point[STORE_SCHEDULE_POINTS]; // Rising temperature
+} gainSchedule_t;
+
+/* profileSegment_t as kept in the store */
+typedef struct STORE_PACKED USER_SEGMENT {
+  uint8_t type;   // segmentType_t
+  uint8_t state;  // reflowState_t
+  int16_t target; // [C]
+  uint16_t rate;  // [C/s / 256]
+  uint16_t time;  // [s]
+  uint8_t band;   // [C]
+} userSegment_t;
+
+typedef struct STORE_PACKED USER_PROFILE {
+  char name[3];
+  int16_t liquidus; // [C]
+  uint8_t count;    // 0 for an unused profile
+  userSegment_t segments[STORE_USER_SEGMENTS];
+} userProfile_t;
+
+typedef struct STORE_PACKED USER_PROFILES {
+  userProfile_t profile[STORE_USER_PROFILES];
+} userProfiles_t;
+
+typedef struct STORE_PACKED PLANT_MODEL {
+  fix16_t heating;  // Rise with the SSR fully on [C/s], 0 for none
+  fix16_t loss;     // Heat loss per C above ambient [1/s]
+  uint8_t deadTime; // [s]
+} plantModel_t;
+
+namespace store {
+
+/* Load the newest valid copy of every record, defaults where there is none */
+void begin();
+
+settings_t &settings();
+gainSchedule_t &schedule();
+userProfiles_t &profiles();
+plantModel_t &model();
+
+/* Mark a RAM record as changed, written by the next commit() */
+void change(storeRecord_t record);
+bool pending();
+
+/* Write the changed records, each into its next slot */
+void commit();
+
+/* Reading after the calibration in settings */
+fix16_t calibrate(fix16_t reading);
+
+} // namespace store
+
+#endif // STORE_H
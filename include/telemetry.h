@@ -0,0 +1,105 @@
+/*
+ * Binary telemetry
+ *
+ * Replaces the CSV lines of SERIAL_PRINTOUT. Every frame is
+ *
+ *   [type][sequence, 2][time, 4][payload][CRC16, 2]
+ *
+ * little-endian, COBS encoded (cobs.h) and followed by a zero byte. The
+ * sequence number counts every frame queued or dropped, so the receiver sees
+ * what it missed; the CRC (crc16.h) covers everything before it.
+ *
+ *   TELEMETRY_START   profile, SSR window [ms, 2]; sent at Start
+ *   TELEMETRY_SAMPLE  setpoint [2], reading [2] in 1/TELEMETRY_SCALE C,
+ *                     output [ms of the SSR window, 2], reflowState_t,
+ *                     plate estimate [2] and its rate of change [2] in
+ *                     1/TELEMETRY_SCALE C and C/s (kalman.h)
+ *   TELEMETRY_SUMMARY runSummary_t fields in order, without the CRC
+ *   TELEMETRY_TRACE   runTrace_t fields without the CRC, offset [2] and up
+ *                     to TELEMETRY_TRACE_CHUNK trace bytes from there
+ *   TELEMETRY_TIMING  timingSection_t, count [2], min, max, mean [us, 2 each],
+ *                     TIMING_BUCKETS histogram counts [2 each]
+ *
+ * A sample takes 22 bytes on the line against about 30 for a CSV line, and
+ * nothing waits for the line: a frame that does not fit the transmit buffer
+ * (uart.h) is dropped and counted. Samples go out every TELEMETRY_DIVIDER
+ * control ticks.
+ *
+ * The port also takes single-byte commands: TELEMETRY_COMMAND_LOG sends the
+ * run log (runlog.h), every summary oldest first and then the last trace,
+ * a frame at a time as the buffer has room; it is ignored while a run is on.
+ * With LOOP_TIMING, TELEMETRY_COMMAND_TIMING sends the loop() section timing
+ * (timing.h) the same way.
+ *
+ * TELEMETRY_COMMAND_UPLOAD writes the store (store.h): it is followed by one
+ * COBS encoded frame and its zero byte, [type][payload][CRC16, 2], where
+ *
+ *   TELEMETRY_CALIBRATION  sensorOffset [4], sensorGain [4], Q16.16
+ *   TELEMETRY_PROFILE      user profile slot, userProfile_t as in the store
+ *
+ * and the controller answers TELEMETRY_ACK, the frame type and 1 if it took
+ * it or 0 if not: a bad CRC or length, a gain that is not positive, a
+ * profile that cannot run (profile::valid()) or a run on. The change is
+ * committed like a Profile press. Make an upload on the host with
+ *
+ *   .pio/build/native/program upload calibration 1.5 1.02 > cal.bin
+ *
+ * Decode a capture on the host with
+ *
+ *   .pio/build/native/program decode capture.bin > run.csv
+ *   .pio/build/native/program decode --log capture.bin
+ *   .pio/build/native/program decode --timing capture.bin
+ */
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "hal.h"
+#include "store.h"
+
+#define TELEMETRY_BAUD 115200
+#ifndef TELEMETRY_DIVIDER
+#define TELEMETRY_DIVIDER 1 // Sample every n-th control tick
+#endif
+#define TELEMETRY_SCALE_BITS 6 // Temperature units per C, log2
+#define TELEMETRY_SCALE (1 << TELEMETRY_SCALE_BITS)
+#define TELEMETRY_HEADER 7  // Type, sequence and time
+#define TELEMETRY_TRACE_CHUNK 32
+#define TELEMETRY_MAX_PAYLOAD (10 + TELEMETRY_TRACE_CHUNK)
+#define TELEMETRY_POLL 10   // Command and download interval [ms]
+#define TELEMETRY_COMMAND_LOG 'L'
+#define TELEMETRY_COMMAND_TIMING 'T'
+#define TELEMETRY_COMMAND_UPLOAD 'U'
+#define TELEMETRY_UPLOAD_MAX (2 + sizeof(userProfile_t) + 2) // Decoded
+
+typedef enum TELEMETRY_FRAME {
+  TELEMETRY_START = 1,
+  TELEMETRY_SAMPLE = 2,
+  TELEMETRY_SUMMARY = 3,
+  TELEMETRY_TRACE = 4,
+  TELEMETRY_TIMING = 5,
+  TELEMETRY_ACK = 6,
+  TELEMETRY_CALIBRATION = 7, // Uploads
+  TELEMETRY_PROFILE = 8
+} telemetryFrame_t;
+
+namespace telemetry {
+
+/* Open the serial port at TELEMETRY_BAUD and send a delimiter */
+void begin();
+
+/* A run starts */
+void start(unsigned long now, uint8_t profile, uint16_t window);
+
+/* Control tick, sends a sample every TELEMETRY_DIVIDER calls */
+void sample(unsigned long now, fix16_t setpoint, fix16_t reading,
+            fix16_t output, uint8_t state, fix16_t estimate, fix16_t rate);
+
+/* Serial task: take commands and uploads, send the next log frame */
+void poll(unsigned long now);
+
+/* Frames that did not fit the transmit buffer */
+uint16_t dropped();
+
+} // namespace telemetry
+
+#endif // TELEMETRY_H
@@ -0,0 +1,82 @@
+/*
+ * loop() section timing
+ *
+ * TIMING_BEGIN(section) and TIMING_END(section) bracket a stretch of code in
+ * the same scope, TIMING_SCOPE(section) times the rest of the enclosing block
+ * however it is left. Every pass adds the time it took to the section's
+ * count, min/max/mean and a log2 histogram: bucket b counts passes that took
+ * 2^b to 2^(b+1) - 1 us (bucket 0 also takes 0 us, the last one everything
+ * longer). The worst case a change is meant to shrink is in the
+ * top buckets, with how often it happens.
+ *
+ * Times come from hal::micros(), Timer0 on the ATmega328P (4 us, 64 cycles
+ * resolution; Timer1 drives the SSR window), the host clock in the native
+ * build. The two reads and record() add about 10 us to each section.
+ *
+ * Only built with -DLOOP_TIMING ([env:loop_timing], [env:native]); without
+ * it the macros are empty and nothing is linked in. TELEMETRY_COMMAND_TIMING
+ * on the serial port sends a TELEMETRY_TIMING frame per section and starts
+ * the section over; decode them on the host with
+ *
+ *   .pio/build/native/program decode --timing capture.bin
+ */
+#ifndef TIMING_H
+#define TIMING_H
+
+#include "hal.h"
+
+#define TIMING_BUCKETS 16 // 1 us to 32 ms and over
+
+typedef enum TIMING_SECTION {
+  TIMING_LOOP,    // All of loop()
+  TIMING_BUTTONS, // Button debounce and handling
+  TIMING_SENSOR,  // Sensor read and fault monitor
+  TIMING_PID,     // PID step and profile
+  TIMING_STATE,   // Reflow state machine
+  TIMING_DISPLAY, // Display refresh
+  TIMING_SECTIONS
+} timingSection_t;
+
+typedef struct TIMING_STATS {
+  uint16_t count;   // Passes, halved with the histogram when full
+  uint16_t min;     // [us], saturates like max
+  uint16_t max;     // [us]
+  uint32_t sum;     // [us], mean = sum / count
+  uint16_t bucket[TIMING_BUCKETS];
+} timingStats_t;
+
+#ifdef LOOP_TIMING
+#define TIMING_BEGIN(section)                                                  \
+  unsigned long timingStart_##section = hal::micros()
+#define TIMING_END(section)                                                    \
+  timing::record(section, hal::micros() - timingStart_##section)
+#define TIMING_SCOPE(section) timing::Scope timingScope_##section(section)
+#else
+#define TIMING_BEGIN(section)
+#define TIMING_END(section)
+#define TIMING_SCOPE(section)
+#endif
+
+namespace timing {
+
+/* Add a pass of a section that took us */
+void record(timingSection_t section, unsigned long us);
+
+/* Since the last clear(), or since boot */
+const timingStats_t &stats(timingSection_t section);
+void clear(timingSection_t section);
+
+/* TIMING_SCOPE(): records from construction to destruction */
+class Scope {
+public:
+  Scope(timingSection_t section) : _section(section), _start(hal::micros()) {}
+  ~Scope() { record(_section, hal::micros() - _start); }
+
+private:
+  timingSection_t _section;
+  unsigned long _start;
+};
+
+} // namespace timing
+
+#endif // TIMING_H
@@ -0,0 +1,58 @@
+/*
+ * Interrupt-driven I2C (TWI) master transmitter
+ *
+ * Display drivers queue write transactions and return; the TWI interrupt
+ * sends them back to back, chaining queued transactions with repeated
+ * STARTs, so loop() never waits on the bus. A transaction is built with
+ * open(), put() and send(); only sent transactions are seen by the
+ * interrupt. Each takes two bytes of queue for the address and length.
+ *
+ * Nothing here blocks except wait(). Callers check room() before building a
+ * transaction and decide what to do when the queue is full; the display
+ * drivers skip or trim a frame and draw the current one later, so a slow bus
+ * merges stale frames instead of stalling the control tasks.
+ *
+ * A transaction NACKed by the device is dropped and counted in errors().
+ */
+#ifndef TWI_H
+#define TWI_H
+
+#include <Arduino.h>
+
+/* Power of two, at most 256 */
+#ifdef SSD1306
+#define TWI_QUEUE_SIZE 256
+#else
+#define TWI_QUEUE_SIZE 128
+#endif
+#define TWI_HEADER_SIZE 2 // Address and length of a queued transaction
+
+namespace twi {
+
+/* Enable the TWI at clock [Hz] with the internal pull-ups */
+void begin(uint32_t clock);
+
+/* Bytes that can still be queued, headers included */
+uint8_t room();
+
+/* Start building a write to address, needs room() > TWI_HEADER_SIZE */
+void open(uint8_t address);
+
+/* Append to the open transaction, one byte of room() each */
+void put(uint8_t data);
+
+/* Queue the open transaction and start the bus if it is idle */
+void send();
+
+/* Nothing queued and the bus stopped */
+bool idle();
+
+/* Busy-wait until idle(), for start-up code only */
+void wait();
+
+/* Transactions dropped on a NACK or bus error since begin() */
+uint16_t errors();
+
+} // namespace twi
+
+#endif // TWI_H
@@ -0,0 +1,37 @@
+/*
+ * Interrupt-driven UART
+ *
+ * write() copies bytes into a ring buffer and returns; the data register
+ * empty interrupt sends them, so loop() never waits for the line the way
+ * Serial.print does once its buffer fills. Callers check room() first and
+ * decide what to do when the buffer is full; telemetry drops the frame and
+ * counts it. Received bytes wait in a small ring for read().
+ *
+ * Replaces HardwareSerial: nothing in the firmware may use Serial, whose
+ * interrupt handlers would clash with these.
+ */
+#ifndef UART_H
+#define UART_H
+
+#include <Arduino.h>
+
+#define UART_TX_SIZE 128 // Power of two, at most 256
+#define UART_RX_SIZE 16  // Power of two, commands are single bytes
+
+namespace uart {
+
+/* USART0 at baud, 8N1 */
+void begin(unsigned long baud);
+
+/* Bytes that can still be queued */
+uint8_t room();
+
+/* Queue length bytes, needs room() >= length */
+void write(const uint8_t *data, uint8_t length);
+
+/* Next received byte, or -1 */
+int read();
+
+} // namespace uart
+
+#endif // UART_H
@@ -0,0 +1,238 @@
+/*
+ * Relay feedback PID autotune
+ */
+#include "autotune.h"
+
+// Tyreus-Luyben in tenths: Kp = Ku * 10 / 22, Ti = Pu * 22 / 10,
+// Td = Pu * 10 / 63
+#define KP_RATIO 22
+#define TI_RATIO 22
+#define TD_RATIO 63
+#define FOUR_OVER_PI FIX16(4 / 3.14159265358979)
+
+static int16_t targets_[AUTOTUNE_EXPERIMENTS];
+static tuning_t results[AUTOTUNE_EXPERIMENTS];
+static uint8_t measured; // Bit per experiment
+static uint8_t experiment;
+static autotuneStatus_t status_;
+static unsigned long window_;   // [ms]
+static unsigned long started;   // Experiment start [ms]
+static bool on;                 // Relay
+static uint8_t switches;        // Relay off switches so far
+static unsigned long lastOff;   // [ms]
+static fix16_t highest, lowest; // Since the last off switch
+static unsigned long periodSum; // [ms]
+static fix16_t amplitudeSum;
+static unsigned long lastTick;  // [ms]
+static unsigned long onTime;    // Relay on in the measured cycles [ms]
+static unsigned long highestAt; // [ms]
+static unsigned long delaySum;  // Off switch to highest [ms]
+static uint8_t delayCount;
+static fix16_t duty[AUTOTUNE_EXPERIMENTS]; // Mean of the measured cycles
+
+// Plate model, see identify()
+static bool first;              // No reading yet
+static fix16_t ambient;         // First reading
+static fix16_t slopeStart;      // Reading the slope is taken from
+static unsigned long slopeFrom; // [ms]
+static fix16_t slope;           // Full power heat-up [C/s], 0 until known
+static fix16_t slopeMiddle;     // Reading it was taken at
+
+static uint32_t isqrt(uint32_t x) {
+  uint32_t root = 0, bit = 1UL << 30;
+  while (bit > x)
+    bit >>= 2;
+  while (bit) {
+    if (x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return root;
+}
+
+/* Move on to the next experiment with a target, or finish */
+static void next(unsigned long now) {
+  while (experiment < AUTOTUNE_EXPERIMENTS && !targets_[experiment])
+    experiment++;
+  if (experiment == AUTOTUNE_EXPERIMENTS) {
+    status_ = measured ? AUTOTUNE_DONE : AUTOTUNE_FAILED;
+    on = false;
+    return;
+  }
+  started = now;
+  on = true; // Heat up to the target first
+  switches = 0;
+  periodSum = 0;
+  amplitudeSum = 0;
+  onTime = 0;
+}
+
+/* Gains from the averaged oscillation, false if there was none to speak of */
+static bool tune(tuning_t &tuning) {
+  fix16_t a = amplitudeSum / AUTOTUNE_CYCLES;
+  unsigned long period = periodSum / AUTOTUNE_CYCLES;
+  if (a <= AUTOTUNE_HYSTERESIS || !period)
+    return false;
+
+  // sqrt(a^2 - h^2) in fix16: the root of a Q16 number has 8 fraction bits
+  fix16_t h = AUTOTUNE_HYSTERESIS;
+  uint32_t squares = ((int64_t)a * a - (int64_t)h * h) >> 16;
+  fix16_t root = isqrt(squares) << 8;
+  if (!root)
+    return false;
+
+  // Ku = (4 / pi) d / root with d = window / 2
+  int64_t ku = ((int64_t)(window_ / 2) * FOUR_OVER_PI << 16) / root;
+  int64_t kp = ku * 10 / KP_RATIO;
+  tuning.kp = kp;
+  tuning.ki = kp * 10000 / ((int64_t)TI_RATIO * period);
+  tuning.kd = kp * period / (TD_RATIO * 100);
+  return true;
+}
+
+namespace autotune {
+
+void begin(const int16_t targets[AUTOTUNE_EXPERIMENTS], unsigned long window,
+           unsigned long now) {
+  memcpy(targets_, targets, sizeof(targets_));
+  window_ = window;
+  measured = 0;
+  lastTick = now;
+  delaySum = 0;
+  delayCount = 0;
+  first = true;
+  slope = 0;
+  slopeFrom = 0;
+  experiment = 0;
+  status_ = AUTOTUNE_RUNNING;
+  next(now);
+}
+
+autotuneStatus_t update(fix16_t reading, unsigned long now) {
+  if (status_ != AUTOTUNE_RUNNING)
+    return status_;
+  if (now - started > AUTOTUNE_TIMEOUT * 1000UL) {
+    status_ = AUTOTUNE_FAILED;
+    on = false;
+    return status_;
+  }
+
+  if (first) {
+    ambient = reading;
+    first = false;
+  }
+  // Full power heat-up rate, over AUTOTUNE_SLOPE_SPAN C of the first one
+  if (!slope && on) {
+    if (!slopeFrom && reading >= ambient + AUTOTUNE_SLOPE_START) {
+      slopeFrom = now;
+      slopeStart = reading;
+    } else if (slopeFrom && reading >= slopeStart + AUTOTUNE_SLOPE_SPAN) {
+      slope = (int64_t)(reading - slopeStart) * 1000 / (now - slopeFrom);
+      slopeMiddle = slopeStart + (reading - slopeStart) / 2;
+    }
+  }
+  if (on && switches > AUTOTUNE_SKIP)
+    onTime += now - lastTick;
+  lastTick = now;
+
+  fix16_t target = fix16FromInt(targets_[experiment]);
+  if (reading > highest) {
+    highest = reading;
+    highestAt = now;
+  }
+  if (reading < lowest)
+    lowest = reading;
+
+  if (!on && reading <= target - AUTOTUNE_HYSTERESIS) {
+    on = true;
+  } else if (on && reading >= target + AUTOTUNE_HYSTERESIS) {
+    on = false;
+    // A cycle runs from one off switch to the next; the first one follows
+    // the heat-up
+    if (switches > AUTOTUNE_SKIP) {
+      periodSum += now - lastOff;
+      amplitudeSum += (highest - lowest) / 2;
+      // The plate kept rising after the last off switch for the dead time
+      delaySum += highestAt - lastOff;
+      delayCount++;
+    }
+    switches++;
+    lastOff = now;
+    highest = lowest = reading;
+    highestAt = now;
+
+    if (switches > AUTOTUNE_SKIP + AUTOTUNE_CYCLES) {
+      if (tune(results[experiment])) {
+        measured |= 1 << experiment;
+        duty[experiment] = fix16Div(onTime, periodSum);
+      }
+      else
+        status_ = AUTOTUNE_FAILED;
+      experiment++;
+      if (status_ == AUTOTUNE_RUNNING)
+        next(now);
+    }
+  }
+  return status_;
+}
+
+autotuneStatus_t status() { return status_; }
+
+bool heater() { return on; }
+
+int16_t target() {
+  return experiment < AUTOTUNE_EXPERIMENTS ? targets_[experiment] : 0;
+}
+
+void save(gainSchedule_t &schedule) {
+  // One point per experiment, in rising order of temperature
+  schedule.count = 0;
+  for (uint8_t e = 0; e < AUTOTUNE_EXPERIMENTS; e++) {
+    if (!(measured & (1 << e)))
+      continue;
+    uint8_t i = schedule.count++;
+    while (i && schedule.point[i - 1].temperature > targets_[e]) {
+      schedule.point[i] = schedule.point[i - 1];
+      i--;
+    }
+    schedule.point[i].temperature = targets_[e];
+    schedule.point[i].gains = results[e];
+  }
+}
+
+bool identify(plantModel_t &model) {
+  if (!slope || !measured || !delayCount)
+    return false;
+
+  // Holding each target takes duty = loss / heating * (target - ambient),
+  // and the heat-up slope is heating - loss * (slopeMiddle - ambient)
+  fix16_t lossShare = 0; // loss * (slopeMiddle - ambient) / heating
+  uint8_t n = 0;
+  for (uint8_t e = 0; e < AUTOTUNE_EXPERIMENTS; e++) {
+    if (!(measured & (1 << e)))
+      continue;
+    fix16_t above = fix16FromInt(targets_[e]) - ambient;
+    lossShare += fix16Mul(duty[e], fix16Div(slopeMiddle - ambient, above));
+    n++;
+  }
+  lossShare /= n;
+  if (lossShare >= FIX16_ONE)
+    return false;
+  fix16_t heating = fix16Div(slope, FIX16_ONE - lossShare);
+
+  fix16_t loss = 0;
+  for (uint8_t e = 0; e < AUTOTUNE_EXPERIMENTS; e++)
+    if (measured & (1 << e))
+      loss += fix16Div(fix16Mul(heating, duty[e]),
+                       fix16FromInt(targets_[e]) - ambient);
+  model.heating = heating;
+  model.loss = loss / n;
+  model.deadTime = (delaySum / delayCount + 500) / 1000;
+  return true;
+}
+
+} // namespace autotune
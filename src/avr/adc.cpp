@@ -0,0 +1,72 @@
+/*
+ * Free-running, oversampled ADC acquisition - ATmega328P
+ */
+#include "adc.h"
+
+// Decimated, ADC_BITS each
+static volatile uint16_t blocks[ADC_CHANNELS][ADC_BLOCKS];
+static volatile uint8_t blockHead[ADC_CHANNELS];  // Next block to write
+static volatile uint8_t blockCount[ADC_CHANNELS]; // Filled, up to ADC_BLOCKS
+static uint8_t inputs_[ADC_CHANNELS];
+static uint8_t converting;   // Channel
+static uint16_t accumulator; // 64 x 1023 fits
+static uint8_t samples;
+static bool settling; // Conversion in progress still on the last input
+
+ISR(ADC_vect) {
+  if (settling) {
+    settling = false;
+    return;
+  }
+  accumulator += ADC;
+  if (++samples < ADC_OVERSAMPLE)
+    return;
+  uint8_t head = blockHead[converting];
+  blocks[converting][head] = accumulator >> ADC_OVERSAMPLE_BITS;
+  blockHead[converting] = (head + 1) & (ADC_BLOCKS - 1);
+  if (blockCount[converting] < ADC_BLOCKS)
+    blockCount[converting]++;
+  accumulator = 0;
+  samples = 0;
+  if (ADC_CHANNELS > 1) {
+    if (++converting >= ADC_CHANNELS)
+      converting = 0;
+    ADMUX = _BV(REFS0) | (inputs_[converting] & 0x0f);
+    settling = true;
+  }
+}
+
+namespace adc {
+
+void begin(const uint8_t inputs[ADC_CHANNELS]) {
+  noInterrupts();
+  for (uint8_t i = 0; i < ADC_CHANNELS; i++) {
+    inputs_[i] = inputs[i];
+    blockHead[i] = 0;
+    blockCount[i] = 0;
+  }
+  converting = 0;
+  accumulator = 0;
+  samples = 0;
+  settling = false;
+  ADMUX = _BV(REFS0) | (inputs_[0] & 0x0f);
+  ADCSRB = 0; // Free running
+  // Enable, start, auto trigger, interrupt, clk/128 = 125 kHz
+  ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) |
+           _BV(ADPS1) | _BV(ADPS0);
+  interrupts();
+}
+
+uint16_t read(uint8_t channel) {
+  while (blockCount[channel] == 0)
+    ;
+  uint32_t sum = 0;
+  noInterrupts();
+  uint8_t count = blockCount[channel];
+  for (uint8_t i = 0; i < count; i++)
+    sum += blocks[channel][i];
+  interrupts();
+  return (sum + count / 2) / count;
+}
+
+} // namespace adc
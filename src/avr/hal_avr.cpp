@@ -0,0 +1,233 @@
+/*
+ * Hardware abstraction layer - ATmega328P / Arduino core
+ */
+#include "hal.h"
+#include "adc.h"
+#include "sensor_drivers.h"
+#include "soft_spi.h"
+#include "uart.h"
+#include <EEPROM.h>
+
+// ***** PIN ASSIGNMENT *****
+
+uint8_t thermPin = A6;
+uint8_t ssrPin = 5;
+// Second control channel, a bottom preheater or a second plate (channel.h)
+uint8_t therm2Pin = A7;
+uint8_t ssr2Pin = 4;
+
+// Thermocouple converters on the soft SPI bus (soft_spi.h); D10 to D13 are
+// the buttons', and A6 and A7 are analog inputs only
+uint8_t sckPin = 13;
+uint8_t soPin = 2;
+uint8_t sdiPin = 7; // MAX31856 only
+uint8_t csPin = A0;
+uint8_t cs2Pin = A1;
+// Mains zero-cross detector, low around each crossing (an H11AA1 or similar
+// optocoupler with a pull-up), for the burst and half-cycle SSR modes
+uint8_t zeroCrossPin = A2;
+
+uint8_t fanPin = 8;
+uint8_t buzzerPin = 3;
+uint8_t ledPin = 6;
+uint8_t btn1Pin = 12;
+uint8_t btn2Pin = 11;
+uint8_t btn3Pin = 10;
+uint8_t btn4Pin = 9;
+
+#if CONTROL_CHANNELS > 2
+#error "Pins are assigned for two control channels"
+#endif
+
+#if defined(MAX31855)
+typedef Max31855 SensorDevice;
+#elif defined(MAX31856)
+typedef Max31856 SensorDevice;
+#elif defined(MAX6675)
+typedef Max6675 SensorDevice;
+#else
+typedef Thermistor SensorDevice; // THERMLIB
+#endif
+
+static SensorDevice sensors[CONTROL_CHANNELS];
+
+// The buttons are all on port B (D8 to D13), pin change interrupt PCINT0
+static uint8_t buttonMasks[BUTTON_COUNT]; // PINB bits, button_t order
+
+// The zero-cross input is on port C, pin change interrupt PCINT1
+static uint8_t zeroCrossMask; // PINC bit
+
+static void (*timerCallback)();
+static void (*buttonCallback)();
+static void (*zeroCrossCallback)();
+
+/* Timer1 compare match, drives the SSR window */
+ISR(TIMER1_COMPA_vect) { timerCallback(); }
+
+/* Pin change on port B, the buttons */
+ISR(PCINT0_vect) { buttonCallback(); }
+
+/* Pin change on port C, the falling edge of the zero-cross pulse */
+ISR(PCINT1_vect) {
+  if (!(PINC & zeroCrossMask))
+    zeroCrossCallback();
+}
+
+namespace hal {
+
+void begin() {
+  // pin initializations
+  pinMode(ssrPin, OUTPUT);
+  digitalWrite(ssrPin, LOW);
+#if CONTROL_CHANNELS > 1
+  pinMode(ssr2Pin, OUTPUT);
+  digitalWrite(ssr2Pin, LOW);
+#endif
+  pinMode(buzzerPin, OUTPUT);
+  digitalWrite(buzzerPin, LOW);
+  pinMode(ledPin, OUTPUT);
+
+  const uint8_t buttonPins[BUTTON_COUNT] = {btn1Pin, btn2Pin, btn4Pin,
+                                            btn3Pin};
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++) {
+    pinMode(buttonPins[b], INPUT_PULLUP);
+    buttonMasks[b] = digitalPinToBitMask(buttonPins[b]);
+  }
+}
+
+unsigned long millis() { return ::millis(); }
+
+unsigned long micros() { return ::micros(); }
+
+void delay(unsigned long ms) { ::delay(ms); }
+
+void timerBegin(unsigned int periodMs, void (*callback)()) {
+  timerCallback = callback;
+  noInterrupts();
+  // Timer1 in CTC mode, clk/64 = 250 kHz
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+  OCR1A = (F_CPU / 64 / 1000) * periodMs - 1;
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+void zeroCrossBegin(void (*callback)()) {
+  pinMode(zeroCrossPin, INPUT_PULLUP);
+  noInterrupts();
+  zeroCrossCallback = callback;
+  zeroCrossMask = digitalPinToBitMask(zeroCrossPin);
+  PCMSK1 |= zeroCrossMask;
+  PCIFR = _BV(PCIF1);
+  PCICR |= _BV(PCIE1);
+  interrupts();
+}
+
+void writeSsr(uint8_t channel, bool on) {
+  digitalWrite(channel ? ssr2Pin : ssrPin, on ? HIGH : LOW);
+}
+
+bool readSsr(uint8_t channel) {
+  return digitalRead(channel ? ssr2Pin : ssrPin) != LOW;
+}
+
+void writeFan(bool on) { digitalWrite(fanPin, on ? HIGH : LOW); }
+
+void writeLed(bool on) { digitalWrite(ledPin, on ? HIGH : LOW); }
+
+void writeBuzzer(bool on) { digitalWrite(buzzerPin, on ? HIGH : LOW); }
+
+void tone(unsigned int frequency, unsigned long duration) {
+  ::tone(buzzerPin, frequency, duration);
+}
+
+bool sensorBegin() {
+#if defined(MAX31855) || defined(MAX31856) || defined(MAX6675)
+  softspi::begin(sckPin, soPin, sdiPin);
+  const uint8_t pins[] = {csPin, cs2Pin};
+#else
+  const uint8_t inputs[ADC_CHANNELS] = {
+      (uint8_t)(thermPin - A0),
+#if CONTROL_CHANNELS > 1
+      (uint8_t)(therm2Pin - A0),
+#endif
+  };
+  adc::begin(inputs);
+  const uint8_t pins[] = {0, 1}; // ADC channels
+#endif
+  bool found = true;
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+    found &= sensors[c].begin(pins[c], ::millis());
+  return found;
+}
+
+void sensorPoll() {
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+    sensors[c].poll(::millis());
+}
+
+unsigned int sensorInterval() { return SensorDevice::CONVERSION_TIME; }
+
+fix16_t readTemperature(uint8_t channel) {
+  const sensorSample_t &sample = sensors[channel].sample();
+  return sample.faults ? FIX16_MIN : sample.temperature;
+}
+
+void sensorMains(uint8_t hertz) {
+#ifdef MAX31856
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+    sensors[c].mains(hertz);
+#else
+  // The others have no choice of filter; the thermistor's 100 ms of ADC
+  // blocks span whole cycles of either
+  (void)hertz;
+#endif
+}
+
+uint8_t sensorFaults(uint8_t channel) {
+  return sensors[channel].sample().faults;
+}
+
+fix16_t coldJunction(uint8_t channel) {
+  return sensors[channel].sample().coldJunction;
+}
+
+uint8_t eepromRead(int address) { return EEPROM.read(address); }
+
+void eepromWrite(int address, uint8_t value) { EEPROM.write(address, value); }
+
+void serialBegin(unsigned long baud) { uart::begin(baud); }
+
+uint8_t serialRoom() { return uart::room(); }
+
+void serialWrite(const uint8_t *data, uint8_t length) {
+  uart::write(data, length);
+}
+
+int serialRead() { return uart::read(); }
+
+uint8_t buttonLevels() {
+  uint8_t pins = PINB, levels = 0;
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+    if (!(pins & buttonMasks[b])) // Pulled up, pressed is low
+      levels |= 1 << b;
+  return levels;
+}
+
+void buttonsBegin(void (*callback)()) {
+  noInterrupts();
+  buttonCallback = callback;
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+    PCMSK0 |= buttonMasks[b];
+  PCIFR = _BV(PCIF0);
+  PCICR |= _BV(PCIE0);
+  interrupts();
+}
+
+void interruptsOff() { noInterrupts(); }
+
+void interruptsOn() { interrupts(); }
+
+} // namespace hal
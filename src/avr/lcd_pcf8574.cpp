@@ -0,0 +1,115 @@
+/*
+ * HD44780 character LCD on a PCF8574 I2C backpack, through the TWI queue
+ */
+#include "lcd_pcf8574.h"
+#include "twi.h"
+
+// PCF8574 port bits
+#define LCD_RS 0x01
+#define LCD_EN 0x04
+#define LCD_BACKLIGHT 0x08
+#define LCD_PORT_WRITES 4 // Per HD44780 transfer
+
+// HD44780 instructions
+#define LCD_CLEAR 0x01
+#define LCD_ENTRY_MODE 0x06   // Increment, no shift
+#define LCD_DISPLAY_ON 0x0c   // Cursor and blink off
+#define LCD_FUNCTION_SET 0x28 // 4-bit, two lines, 5x8 dots
+#define LCD_SET_DDRAM 0x80
+#define LCD_CLEAR_TIME 2 // [ms]
+
+static const uint8_t rowOffsets[] = {0x00, 0x40, 0x14, 0x54};
+
+LcdPcf8574::LcdPcf8574(uint8_t address, uint8_t columns, uint8_t rows)
+    : _address(address), _columns(columns), _rows(rows), _backlight(0),
+      _open(false) {}
+
+void LcdPcf8574::begin() {
+  twi::begin(LCD_I2C_CLOCK);
+  delay(50); // Power-on time of the HD44780
+
+  // Into 4-bit mode from any state, with the datasheet's waits
+  nibble(0x30);
+  delay(5);
+  nibble(0x30);
+  delayMicroseconds(150);
+  nibble(0x30);
+  nibble(0x20);
+
+  command(LCD_FUNCTION_SET);
+  command(LCD_DISPLAY_ON);
+  command(LCD_ENTRY_MODE);
+  clear();
+}
+
+void LcdPcf8574::backlight() {
+  _backlight = LCD_BACKLIGHT;
+  flush();
+  twi::open(_address);
+  twi::put(_backlight);
+  twi::send();
+}
+
+void LcdPcf8574::clear() {
+  command(LCD_CLEAR);
+  flush();
+  twi::wait();
+  delay(LCD_CLEAR_TIME);
+}
+
+void LcdPcf8574::setCursor(uint8_t col, uint8_t row) {
+  if (row >= _rows)
+    row = _rows - 1;
+  command(LCD_SET_DDRAM | (col + rowOffsets[row]));
+}
+
+size_t LcdPcf8574::write(uint8_t c) {
+  transfer(c, LCD_RS);
+  return 1;
+}
+
+void LcdPcf8574::print(const char *s) {
+  while (*s)
+    write(*s++);
+}
+
+bool LcdPcf8574::canWrite(uint8_t transfers) const {
+  uint16_t needed = (uint16_t)transfers * LCD_PORT_WRITES;
+  if (!_open)
+    needed += TWI_HEADER_SIZE;
+  return twi::room() >= needed;
+}
+
+void LcdPcf8574::flush() {
+  if (_open) {
+    twi::send();
+    _open = false;
+  }
+}
+
+void LcdPcf8574::transfer(uint8_t value, uint8_t mode) {
+  // Callers check canWrite(), this only waits when they did not
+  if (_open && twi::room() < LCD_PORT_WRITES)
+    flush();
+  if (!_open) {
+    while (twi::room() < TWI_HEADER_SIZE + LCD_PORT_WRITES)
+      ;
+    twi::open(_address);
+    _open = true;
+  }
+  uint8_t high = (value & 0xf0) | mode | _backlight;
+  uint8_t low = (value << 4) | mode | _backlight;
+  twi::put(high | LCD_EN);
+  twi::put(high);
+  twi::put(low | LCD_EN);
+  twi::put(low);
+}
+
+/* Upper half of value on its own, for the 8-bit to 4-bit switch */
+void LcdPcf8574::nibble(uint8_t value) {
+  twi::open(_address);
+  twi::put((value & 0xf0) | _backlight | LCD_EN);
+  twi::put((value & 0xf0) | _backlight);
+  twi::send();
+  twi::wait();
+}
@@ -0,0 +1,93 @@
+/*
+ * Temperature sensor drivers - ATmega328P
+ */
+#include "sensor_drivers.h"
+#include "adc.h"
+#include "soft_spi.h"
+
+// MAX31856 registers, writes have bit 7 set
+#define MAX31856_CR0 0x00
+#define MAX31856_CR1 0x01
+#define MAX31856_CJTH 0x0a // First of CJTH, CJTL, LTCBH, LTCBM, LTCBL, SR
+#define MAX31856_WRITE 0x80
+#define MAX31856_CR0_OCFAULT 0x10 // Open-circuit detection, under 5 kOhm
+#define MAX31856_CR0_1SHOT 0x40   // Start one conversion
+#define MAX31856_CR0_50HZ 0x01    // Filter notch at 50 Hz, 60 Hz without
+#define MAX31856_CR1_TYPE_K 0x03  // No averaging
+
+bool Thermistor::init(uint8_t channel) {
+  // adc::begin() of all the channels is the HAL's
+  _channel = channel;
+  return true;
+}
+
+sensorSample_t Thermistor::collect() {
+  return sensor::decodeThermistor(adc::read(_channel));
+}
+
+bool Max31855::init(uint8_t cs) {
+  _cs = cs;
+  softspi::attach(cs);
+  return true; // A missing device shows in the first sample
+}
+
+sensorSample_t Max31855::collect() {
+  uint32_t word = 0;
+  softspi::select(_cs);
+  for (uint8_t i = 0; i < 4; i++)
+    word = word << 8 | softspi::read();
+  softspi::deselect(_cs);
+  return sensor::decodeMax31855(word);
+}
+
+bool Max6675::init(uint8_t cs) {
+  _cs = cs;
+  softspi::attach(cs);
+  return true;
+}
+
+sensorSample_t Max6675::collect() {
+  softspi::select(_cs);
+  uint16_t word = softspi::read() << 8;
+  word |= softspi::read();
+  softspi::deselect(_cs);
+  return sensor::decodeMax6675(word);
+}
+
+bool Max31856::init(uint8_t cs) {
+  _cs = cs;
+  softspi::attach(cs);
+  _cr0 = MAX31856_CR0_OCFAULT;
+  write(MAX31856_CR1, MAX31856_CR1_TYPE_K);
+  write(MAX31856_CR0, _cr0);
+  // Nothing on the bus reads back all ones
+  softspi::select(_cs);
+  softspi::transfer(MAX31856_CR1);
+  uint8_t cr1 = softspi::transfer(0);
+  softspi::deselect(_cs);
+  return cr1 == MAX31856_CR1_TYPE_K;
+}
+
+void Max31856::convert() { write(MAX31856_CR0, _cr0 | MAX31856_CR0_1SHOT); }
+
+void Max31856::mains(uint8_t hertz) {
+  // Only written between conversions, which the datasheet asks for
+  _cr0 = MAX31856_CR0_OCFAULT | (hertz == 50 ? MAX31856_CR0_50HZ : 0);
+}
+
+sensorSample_t Max31856::collect() {
+  uint8_t registers[6];
+  softspi::select(_cs);
+  softspi::transfer(MAX31856_CJTH);
+  for (uint8_t i = 0; i < 6; i++)
+    registers[i] = softspi::transfer(0);
+  softspi::deselect(_cs);
+  return sensor::decodeMax31856(registers);
+}
+
+void Max31856::write(uint8_t address, uint8_t value) {
+  softspi::select(_cs);
+  softspi::transfer(address | MAX31856_WRITE);
+  softspi::transfer(value);
+  softspi::deselect(_cs);
+}
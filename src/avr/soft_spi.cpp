@@ -0,0 +1,78 @@
+/*
+ * Bit-banged SPI master - ATmega328P
+ */
+#include "soft_spi.h"
+
+// Port registers and masks, looked up once
+static volatile uint8_t *sckPort;
+static volatile uint8_t *mosiPort;
+static volatile uint8_t *misoPin;
+static uint8_t sckMask, mosiMask, misoMask;
+
+namespace softspi {
+
+void begin(uint8_t sck, uint8_t miso, uint8_t mosi) {
+  pinMode(sck, OUTPUT);
+  digitalWrite(sck, LOW);
+  // Pulled up, a missing device reads all ones, which no device sends
+  pinMode(miso, INPUT_PULLUP);
+  sckPort = portOutputRegister(digitalPinToPort(sck));
+  sckMask = digitalPinToBitMask(sck);
+  misoPin = portInputRegister(digitalPinToPort(miso));
+  misoMask = digitalPinToBitMask(miso);
+  if (mosi != 0xff) {
+    pinMode(mosi, OUTPUT);
+    mosiPort = portOutputRegister(digitalPinToPort(mosi));
+    mosiMask = digitalPinToBitMask(mosi);
+  } else {
+    // Writes go to the clock port with no bit set
+    mosiPort = sckPort;
+    mosiMask = 0;
+  }
+}
+
+void attach(uint8_t cs) {
+  pinMode(cs, OUTPUT);
+  digitalWrite(cs, HIGH);
+}
+
+void select(uint8_t cs) { digitalWrite(cs, LOW); }
+
+void deselect(uint8_t cs) { digitalWrite(cs, HIGH); }
+
+uint8_t read() {
+  uint8_t in = 0;
+  // Port writes are read-modify-write, the interrupts may use the same port
+  uint8_t sreg = SREG;
+  noInterrupts();
+  for (uint8_t bit = 0x80; bit; bit >>= 1) {
+    if (*misoPin & misoMask)
+      in |= bit;
+    *sckPort |= sckMask;
+    *sckPort &= ~sckMask;
+  }
+  SREG = sreg;
+  return in;
+}
+
+uint8_t transfer(uint8_t out) {
+  uint8_t in = 0;
+  uint8_t sreg = SREG;
+  noInterrupts();
+  for (uint8_t bit = 0x80; bit; bit >>= 1) {
+    // Rising edge: the device shifts its bit out, the host shifts ours
+    *sckPort |= sckMask;
+    if (out & bit)
+      *mosiPort |= mosiMask;
+    else
+      *mosiPort &= ~mosiMask;
+    // Falling edge: both bits have settled for half a clock, sample
+    *sckPort &= ~sckMask;
+    if (*misoPin & misoMask)
+      in |= bit;
+  }
+  SREG = sreg;
+  return in;
+}
+
+} // namespace softspi
@@ -0,0 +1,39 @@
+/*
+ * SSD1306Ascii over the TWI queue
+ */
+#include "ssd1306_twi.h"
+#include "twi.h"
+
+// SSD1306 control bytes, Co = 0: everything after is of one kind
+#define SSD1306_CONTROL_CMD 0x00
+#define SSD1306_CONTROL_RAM 0x40
+
+void SSD1306AsciiTwi::begin(const DevType *dev, uint8_t address) {
+  _address = address;
+  twi::begin(SSD1306_I2C_CLOCK);
+  init(dev);
+  flush();
+  twi::wait();
+}
+
+void SSD1306AsciiTwi::flush() {
+  if (_control != NO_TRANSACTION) {
+    twi::send();
+    _control = NO_TRANSACTION;
+  }
+}
+
+void SSD1306AsciiTwi::writeDisplay(uint8_t b, uint8_t mode) {
+  uint8_t control =
+      mode == SSD1306_MODE_CMD ? SSD1306_CONTROL_CMD : SSD1306_CONTROL_RAM;
+  if (_control != control || twi::room() == 0)
+    flush();
+  if (_control == NO_TRANSACTION) {
+    while (twi::room() < TWI_HEADER_SIZE + 2)
+      ;
+    twi::open(_address);
+    twi::put(control);
+    _control = control;
+  }
+  twi::put(b);
+}
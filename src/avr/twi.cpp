@@ -0,0 +1,126 @@
+/*
+ * Interrupt-driven I2C (TWI) master transmitter - ATmega328P
+ */
+#include "twi.h"
+#include <util/twi.h>
+
+#define TWI_MASK (TWI_QUEUE_SIZE - 1)
+#define TWCR_NEXT (_BV(TWINT) | _BV(TWEN) | _BV(TWIE))
+#define TWCR_START (TWCR_NEXT | _BV(TWSTA))
+#define TWCR_STOP (_BV(TWINT) | _BV(TWEN) | _BV(TWSTO))
+
+static volatile uint8_t queue[TWI_QUEUE_SIZE];
+static volatile uint8_t head;      // Next byte the interrupt sends
+static volatile uint8_t tail;      // End of the sent transactions
+static volatile uint8_t remaining; // Data bytes left in the current one
+static volatile bool busy;         // Between START and STOP
+static volatile uint16_t errorCount;
+static uint8_t openAt;  // Header of the transaction being built
+static uint8_t writeAt; // Next free byte
+
+/* START, waiting out a STOP still on the bus */
+static void start() {
+  while (TWCR & _BV(TWSTO))
+    ;
+  busy = true;
+  TWCR = TWCR_START;
+}
+
+/* Chain the next transaction with a repeated START, or release the bus */
+static void next() {
+  if (head != tail) {
+    TWCR = TWCR_START;
+  } else {
+    TWCR = TWCR_STOP;
+    busy = false;
+  }
+}
+
+ISR(TWI_vect) {
+  switch (TW_STATUS) {
+  case TW_START:
+  case TW_REP_START:
+    TWDR = (queue[head] << 1) | TW_WRITE;
+    remaining = queue[(head + 1) & TWI_MASK];
+    head = (head + TWI_HEADER_SIZE) & TWI_MASK;
+    TWCR = TWCR_NEXT;
+    break;
+  case TW_MT_SLA_ACK:
+  case TW_MT_DATA_ACK:
+    if (remaining) {
+      TWDR = queue[head];
+      head = (head + 1) & TWI_MASK;
+      remaining--;
+      TWCR = TWCR_NEXT;
+    } else {
+      next();
+    }
+    break;
+  default: // NACK, lost arbitration or bus error: drop the transaction
+    head = (head + remaining) & TWI_MASK;
+    remaining = 0;
+    errorCount++;
+    TWCR = TWCR_STOP;
+    busy = false;
+    if (head != tail)
+      start();
+    break;
+  }
+}
+
+namespace twi {
+
+void begin(uint32_t clock) {
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  TWSR = 0; // Prescaler 1
+  TWBR = ((F_CPU / clock) - 16) / 2;
+  TWCR = _BV(TWEN);
+  head = tail = openAt = writeAt = 0;
+  busy = false;
+}
+
+uint8_t room() {
+  return TWI_QUEUE_SIZE - 1 - (uint8_t)((writeAt - head) & TWI_MASK);
+}
+
+void open(uint8_t address) {
+  openAt = writeAt;
+  queue[openAt] = address;
+  writeAt = (writeAt + TWI_HEADER_SIZE) & TWI_MASK;
+}
+
+void put(uint8_t data) {
+  queue[writeAt] = data;
+  writeAt = (writeAt + 1) & TWI_MASK;
+}
+
+void send() {
+  uint8_t length = (writeAt - openAt - TWI_HEADER_SIZE) & TWI_MASK;
+  if (length == 0) {
+    writeAt = openAt;
+    return;
+  }
+  queue[(openAt + 1) & TWI_MASK] = length;
+  noInterrupts();
+  tail = writeAt;
+  if (!busy)
+    start();
+  interrupts();
+}
+
+bool idle() { return !busy && head == tail; }
+
+void wait() {
+  while (!idle())
+    ;
+}
+
+uint16_t errors() {
+  noInterrupts();
+  uint16_t count = errorCount;
+  interrupts();
+  return count;
+}
+
+} // namespace twi
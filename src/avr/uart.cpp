@@ -0,0 +1,66 @@
+/*
+ * Interrupt-driven UART - ATmega328P
+ */
+#include "uart.h"
+
+#define UART_TX_MASK (UART_TX_SIZE - 1)
+#define UART_RX_MASK (UART_RX_SIZE - 1)
+
+static volatile uint8_t buffer[UART_TX_SIZE];
+static volatile uint8_t head; // Next byte the interrupt sends
+static volatile uint8_t tail; // Next free byte
+static volatile uint8_t received[UART_RX_SIZE];
+static volatile uint8_t rxHead; // Next byte read() returns
+static volatile uint8_t rxTail; // Next byte the interrupt stores
+
+ISR(USART_UDRE_vect) {
+  if (head == tail) {
+    UCSR0B &= ~_BV(UDRIE0);
+    return;
+  }
+  UDR0 = buffer[head];
+  head = (head + 1) & UART_TX_MASK;
+}
+
+ISR(USART_RX_vect) {
+  uint8_t data = UDR0;
+  uint8_t next = (rxTail + 1) & UART_RX_MASK;
+  if (next != rxHead) { // Full: drop
+    received[rxTail] = data;
+    rxTail = next;
+  }
+}
+
+namespace uart {
+
+void begin(unsigned long baud) {
+  UCSR0A = _BV(U2X0);
+  UBRR0 = (F_CPU / 4 / baud - 1) / 2;
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+  head = tail = rxHead = rxTail = 0;
+  UCSR0B = _BV(TXEN0) | _BV(RXEN0) | _BV(RXCIE0);
+}
+
+uint8_t room() { return UART_TX_SIZE - 1 - ((tail - head) & UART_TX_MASK); }
+
+void write(const uint8_t *data, uint8_t length) {
+  uint8_t at = tail;
+  while (length--) {
+    buffer[at] = *data++;
+    at = (at + 1) & UART_TX_MASK;
+  }
+  noInterrupts();
+  tail = at;
+  UCSR0B |= _BV(UDRIE0);
+  interrupts();
+}
+
+int read() {
+  if (rxHead == rxTail)
+    return -1;
+  uint8_t data = received[rxHead];
+  rxHead = (rxHead + 1) & UART_RX_MASK;
+  return data;
+}
+
+} // namespace uart
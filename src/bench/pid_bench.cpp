@@ -0,0 +1,97 @@
+/*
+ * PID benchmark ([env:pid_bench])
+ *
+ * Times Compute() of br3ttb's PID_v1 over double against FixedPID on the
+ * target. Timer1 runs at clk/1, so TCNT1 differences are CPU cycles; the cost
+ * of reading the timer is measured first and subtracted. Both run at the
+ * firmware's shortest PID interval, so the per-sample gains are the ones the
+ * controller computes with; FixedPID is called directly, PID_v1 once its
+ * sample time has passed. Results are printed once at 115200 baud.
+ */
+#include "fixpid.h"
+#include <Arduino.h>
+#include <PID_v1.h>
+
+#define BENCH_RUNS 256
+#define BENCH_SAMPLE_TIME 200 // Preheat and reflow PID interval, main.cpp [ms]
+
+double dInput, dOutput, dSetpoint = 200;
+fix16_t fInput, fOutput, fSetpoint = FIX16(200);
+
+PID floatPid(&dInput, &dOutput, &dSetpoint, 300, 0.05, 350, DIRECT);
+FixedPID fixedPid(&fInput, &fOutput, &fSetpoint, FIX16(300), FIX16(0.05),
+                  FIX16(350));
+
+typedef struct BENCH_RESULT {
+  uint32_t sum;
+  uint16_t min;
+  uint16_t max;
+} benchResult_t;
+
+static void record(benchResult_t &result, uint16_t cycles) {
+  result.sum += cycles;
+  if (cycles < result.min)
+    result.min = cycles;
+  if (cycles > result.max)
+    result.max = cycles;
+}
+
+static void report(const __FlashStringHelper *name,
+                   const benchResult_t &result) {
+  Serial.print(name);
+  Serial.print(F(" cycles/Compute() min "));
+  Serial.print(result.min);
+  Serial.print(F(" mean "));
+  Serial.print(result.sum / BENCH_RUNS);
+  Serial.print(F(" max "));
+  Serial.println(result.max);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  floatPid.SetOutputLimits(0, 2000);
+  floatPid.SetSampleTime(BENCH_SAMPLE_TIME);
+  floatPid.SetMode(AUTOMATIC);
+  fixedPid.SetOutputLimits(0, FIX16(2000));
+  fixedPid.SetSampleTime(BENCH_SAMPLE_TIME);
+  fixedPid.SetMode(AUTOMATIC);
+
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10); // clk/1
+
+  noInterrupts();
+  uint16_t start = TCNT1;
+  uint16_t overhead = TCNT1 - start;
+  interrupts();
+
+  benchResult_t floatResult = {0, 0xffff, 0};
+  benchResult_t fixedResult = {0, 0xffff, 0};
+
+  for (uint16_t i = 0; i < BENCH_RUNS; i++) {
+    // A noisy reading around the setpoint keeps the output off its limits
+    int16_t centi = 19500 + (int16_t)((i * 37) % 1000);
+    dInput = centi / 100.0;
+    fInput = ((int32_t)centi << 16) / 100;
+
+    // PID_v1 only computes once its sample time has passed
+    delay(BENCH_SAMPLE_TIME);
+
+    noInterrupts();
+    start = TCNT1;
+    floatPid.Compute();
+    uint16_t floatCycles = TCNT1 - start - overhead;
+    start = TCNT1;
+    fixedPid.Compute();
+    uint16_t fixedCycles = TCNT1 - start - overhead;
+    interrupts();
+
+    record(floatResult, floatCycles);
+    record(fixedResult, fixedCycles);
+  }
+
+  report(F("PID_v1 (double)   "), floatResult);
+  report(F("FixedPID (Q16.16) "), fixedResult);
+}
+
+void loop() {}
@@ -0,0 +1,128 @@
+/*
+ * Button events
+ */
+#include "buttons.h"
+
+// Written by the interrupt, and by update() with it held off
+static volatile bool pending;            // Edges since the last settle
+static volatile unsigned long firstEdge; // Of those [ms]
+static volatile unsigned long lastEdge;  // [ms]
+
+// loop() only
+static uint8_t state; // Settled levels, bit per button_t, 1 = down
+static unsigned long changedAt[BUTTON_COUNT]; // Of state [ms]
+static buttonEvent_t queue[BUTTON_QUEUE_SIZE];
+static uint8_t head; // Next to write
+static uint8_t tail; // Next to read
+static uint8_t lost;
+static uint8_t longSent;                       // Bit per button
+static uint8_t repeats[BUTTON_COUNT];          // Since the press
+static unsigned long nextRepeat[BUTTON_COUNT]; // After the press [ms]
+
+static void push(uint8_t button, uint8_t type, unsigned long now) {
+  uint8_t next = (head + 1) & (BUTTON_QUEUE_SIZE - 1);
+  if (next == tail) {
+    if (lost < 0xff)
+      lost++;
+    return;
+  }
+  queue[head].button = button;
+  queue[head].type = type;
+  queue[head].time = now;
+  head = next;
+}
+
+/* A button changed level for good */
+static void accept(uint8_t button, bool down, unsigned long now) {
+  uint8_t bit = 1 << button;
+  state ^= bit;
+  changedAt[button] = now;
+  if (down) {
+    longSent &= ~bit;
+    repeats[button] = 0;
+    nextRepeat[button] = BUTTON_REPEAT_DELAY;
+  }
+  push(button, down ? BUTTON_EVENT_PRESS : BUTTON_EVENT_RELEASE, now);
+}
+
+/* Pin change interrupt, only time stamps the edge */
+static void edge() {
+  unsigned long now = hal::millis();
+  if (!pending)
+    firstEdge = now;
+  lastEdge = now;
+  pending = true;
+}
+
+/* Repeat interval after count repeats */
+static unsigned int interval(uint8_t count) {
+  uint8_t halvings = count / BUTTON_REPEAT_ACCEL;
+  unsigned int t = halvings < 8 ? BUTTON_REPEAT_START >> halvings : 0;
+  return t > BUTTON_REPEAT_MIN ? t : BUTTON_REPEAT_MIN;
+}
+
+namespace buttons {
+
+void begin() {
+  head = tail = lost = 0;
+  pending = false;
+  // A button held through the reset is down without a press, its long
+  // press and repeats are spent
+  state = hal::buttonLevels();
+  longSent = state;
+  unsigned long now = hal::millis();
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++) {
+    changedAt[b] = now;
+    repeats[b] = 0xff;
+    nextRepeat[b] = 0xffffffffUL;
+  }
+  hal::buttonsBegin(edge);
+}
+
+void update(unsigned long now) {
+  if (!pending && !state)
+    return;
+  if (pending) {
+    hal::interruptsOff();
+    unsigned long first = firstEdge, last = lastEdge;
+    bool settled = now - last >= BUTTON_DEBOUNCE;
+    if (settled)
+      pending = false;
+    hal::interruptsOn();
+    if (settled) {
+      // The levels after the bounce; a glitch that came back is no change
+      uint8_t changed = hal::buttonLevels() ^ state;
+      for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+        if (changed & (1 << b))
+          accept(b, !(state & (1 << b)), first);
+    }
+  }
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++) {
+    uint8_t bit = 1 << b;
+    if (!(state & bit))
+      continue;
+    unsigned long held = now - changedAt[b];
+    if (!(longSent & bit) && held >= BUTTON_LONG_PRESS) {
+      longSent |= bit;
+      push(b, BUTTON_EVENT_LONG, now);
+    }
+    if ((BUTTON_REPEATING & bit) && held >= nextRepeat[b]) {
+      nextRepeat[b] += interval(repeats[b]);
+      if (repeats[b] < 0xff)
+        repeats[b]++;
+      push(b, BUTTON_EVENT_REPEAT, now);
+    }
+  }
+}
+
+bool next(buttonEvent_t *event) {
+  if (tail == head)
+    return false;
+  *event = queue[tail];
+  tail = (tail + 1) & (BUTTON_QUEUE_SIZE - 1);
+  return true;
+}
+
+uint8_t dropped() { return lost; }
+
+} // namespace buttons
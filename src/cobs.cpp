@@ -0,0 +1,41 @@
+/*
+ * Consistent Overhead Byte Stuffing
+ */
+#include "cobs.h"
+
+namespace cobs {
+
+uint8_t encode(const uint8_t *in, uint8_t length, uint8_t *out) {
+  uint8_t code = 0; // Where the length of the current run goes
+  uint8_t at = 1;
+  for (uint8_t i = 0; i < length; i++) {
+    if (in[i]) {
+      out[at++] = in[i];
+    } else {
+      out[code] = at - code;
+      code = at++;
+    }
+  }
+  out[code] = at - code;
+  return at;
+}
+
+int decode(const uint8_t *in, int length, uint8_t *out) {
+  int at = 0, n = 0;
+  while (at < length) {
+    uint8_t code = in[at++];
+    if (code == 0 || at + code - 1 > length)
+      return -1;
+    for (uint8_t i = 1; i < code; i++) {
+      if (!in[at])
+        return -1;
+      out[n++] = in[at++];
+    }
+    // Every run but the last and full ones stands for a zero
+    if (at < length && code != 0xff)
+      out[n++] = 0;
+  }
+  return n;
+}
+
+} // namespace cobs
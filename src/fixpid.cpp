@@ -0,0 +1,141 @@
+/*
+ * Fixed-point PID controller
+ */
+#include "fixpid.h"
+
+FixedPID::FixedPID(fix16_t *input, fix16_t *output, fix16_t *setpoint,
+                   fix16_t kp, fix16_t ki, fix16_t kd)
+    : _input(input), _output(output), _setpoint(setpoint), _dispKp(kp),
+      _dispKi(ki), _dispKd(kd), _sampleTime(100), _filterTime(0), _dAlpha(0),
+      _outMin(0), _outMax(FIX16(255)), _feedForward(0), _iTerm(0),
+      _lastInput(0), _lastError(0), _dInput(0), _inAuto(false) {
+  scaleTunings();
+}
+
+bool FixedPID::Compute() {
+  if (!_inAuto)
+    return false;
+
+  fix16_t input = *_input;
+  q8_t error = fix16ToQ8(*_setpoint - input);
+  q8_t dInput = fix16ToQ8(input - _lastInput);
+
+  if (_dAlpha)
+    _dInput += ((int32_t)(dInput - _dInput) * _dAlpha) >> 15;
+  else
+    _dInput = dInput;
+
+  fix16_t iTerm = clampIntegral(_iTerm + fix16MulQ8(_ki, error));
+  fix16_t output = fix16MulQ8(_kp, error) + iTerm - fix16MulQ8(_kd, _dInput) +
+                   _feedForward;
+
+  // Hold the integrator while the output is pinned in the error's direction
+  if (!((output > _outMax && error > 0) || (output < _outMin && error < 0)))
+    _iTerm = iTerm;
+
+  *_output = clamp(output);
+  _lastInput = input;
+  _lastError = error;
+  return true;
+}
+
+void FixedPID::SetMode(int mode) {
+  bool newAuto = (mode == AUTOMATIC);
+  if (newAuto && !_inAuto)
+    initialize();
+  _inAuto = newAuto;
+}
+
+void FixedPID::SetOutputLimits(fix16_t min, fix16_t max) {
+  if (min >= max)
+    return;
+  _outMin = min;
+  _outMax = max;
+  if (_inAuto) {
+    *_output = clamp(*_output);
+    _iTerm = clampIntegral(_iTerm);
+  }
+}
+
+void FixedPID::SetTunings(fix16_t kp, fix16_t ki, fix16_t kd) {
+  if (kp < 0 || ki < 0 || kd < 0)
+    return;
+  if (kp == _dispKp && ki == _dispKi && kd == _dispKd)
+    return; // Nothing to rescale or move into the integrator
+
+  // P and D contributions of the last step with the old gains
+  fix16_t before = fix16MulQ8(_kp, _lastError) - fix16MulQ8(_kd, _dInput);
+
+  _dispKp = kp;
+  _dispKi = ki;
+  _dispKd = kd;
+  scaleTunings();
+
+  if (_inAuto) {
+    // Move the difference into the integrator so the output does not jump
+    fix16_t after = fix16MulQ8(_kp, _lastError) - fix16MulQ8(_kd, _dInput);
+    _iTerm = clampIntegral(_iTerm + before - after);
+  }
+}
+
+void FixedPID::SetSampleTime(unsigned int sampleTime) {
+  if (sampleTime == 0)
+    return;
+  // The filtered input change is per sample, so a new period rescales it
+  // and the derivative goes on from the same slope, saturating like Q8.8
+  int32_t dInput =
+      (int32_t)_dInput * (int32_t)sampleTime / (int32_t)_sampleTime;
+  _dInput = dInput > INT16_MAX ? INT16_MAX
+            : dInput < INT16_MIN ? INT16_MIN
+                                 : (q8_t)dInput;
+  _sampleTime = sampleTime;
+  scaleTunings();
+  SetDerivativeFilter(_filterTime);
+}
+
+void FixedPID::SetDerivativeFilter(unsigned int timeConstant) {
+  _filterTime = timeConstant;
+  // alpha = Ts / (Tf + Ts) in Q0.15, 0 leaves the derivative unfiltered
+  _dAlpha = timeConstant ? ((uint32_t)_sampleTime << 15) /
+                               ((uint32_t)timeConstant + _sampleTime)
+                         : 0;
+}
+
+/* Saturated to fix16_t: a long Kd over a short sample time does not fit */
+static fix16_t saturate(int64_t x) {
+  if (x > FIX16_MAX)
+    return FIX16_MAX;
+  if (x < FIX16_MIN)
+    return FIX16_MIN;
+  return (fix16_t)x;
+}
+
+void FixedPID::scaleTunings() {
+  _kp = _dispKp;
+  _ki = saturate(((int64_t)_dispKi * _sampleTime) / 1000);
+  _kd = saturate(((int64_t)_dispKd * 1000) / _sampleTime);
+}
+
+void FixedPID::initialize() {
+  _iTerm = clampIntegral(*_output - _feedForward);
+  _lastInput = *_input;
+  _lastError = 0;
+  _dInput = 0;
+}
+
+fix16_t FixedPID::clamp(fix16_t x) const {
+  if (x > _outMax)
+    return _outMax;
+  if (x < _outMin)
+    return _outMin;
+  return x;
+}
+
+/* With feedforward, the integrator keeps the sum within the output limits */
+fix16_t FixedPID::clampIntegral(fix16_t x) const {
+  if (x > _outMax - _feedForward)
+    return _outMax - _feedForward;
+  if (x < _outMin - _feedForward)
+    return _outMin - _feedForward;
+  return x;
+}
@@ -0,0 +1,75 @@
+/*
+ * Plate temperature estimator
+ */
+#include "kalman.h"
+
+static fix16_t plate_, sensor_; // Estimates [C]
+static fix16_t rate_;           // [C/s]
+// Covariance of plate and sensor, symmetric [C^2]
+static fix16_t p00, p01, p11;
+
+namespace kalman {
+
+void begin(fix16_t reading) {
+  plate_ = sensor_ = reading;
+  rate_ = 0;
+  // At rest the plate is about where the sensor is
+  p00 = p11 = KALMAN_READING_NOISE;
+  p01 = 0;
+}
+
+fix16_t update(fix16_t reading, fix16_t duty, unsigned long dt) {
+  fix16_t seconds = (fix16_t)((int64_t)dt * FIX16_ONE / 1000);
+  uint8_t lag = model::deadTime();
+  fix16_t tau = fix16FromInt(lag > KALMAN_LAG_MIN ? lag : KALMAN_LAG_MIN);
+  // Share of the way the sensor goes to the plate in dt, 1 - exp(-dt / tau)
+  // to second order
+  fix16_t a = fix16Div(seconds, tau + seconds / 2);
+  // The loss is linear in the temperature, per C of it
+  fix16_t f = FIX16_ONE - fix16Mul(model::lossRate(FIX16_ONE) -
+                                       model::lossRate(0),
+                                   seconds);
+
+  // Predict, the sensor from the plate before the step
+  fix16_t last = plate_;
+  fix16_t rise = model::heatRate(duty) - model::lossRate(plate_);
+  sensor_ += fix16Mul(a, plate_ - sensor_);
+  plate_ += fix16Mul(rise, seconds);
+  //   P = F P F' + Q with F = [f 0; a 1-a]
+  fix16_t b = FIX16_ONE - a;
+  fix16_t n00 = fix16Mul(fix16Mul(f, f), p00) +
+                fix16Mul(KALMAN_PLATE_NOISE, seconds);
+  fix16_t n01 = fix16Mul(f, fix16Mul(a, p00) + fix16Mul(b, p01));
+  fix16_t n11 = fix16Mul(fix16Mul(a, a), p00) +
+                2 * fix16Mul(fix16Mul(a, b), p01) +
+                fix16Mul(fix16Mul(b, b), p11) +
+                fix16Mul(KALMAN_SENSOR_NOISE, seconds);
+  p00 = n00;
+  p01 = n01;
+  p11 = n11;
+
+  if (reading != FIX16_MIN) {
+    // Correct by the reading, which sees the sensor state only
+    fix16_t s = p11 + KALMAN_READING_NOISE;
+    fix16_t k0 = fix16Div(p01, s), k1 = fix16Div(p11, s);
+    fix16_t innovation = reading - sensor_;
+    plate_ += fix16Mul(k0, innovation);
+    sensor_ += fix16Mul(k1, innovation);
+    p00 -= fix16Mul(k0, p01);
+    p01 -= fix16Mul(k0, p11);
+    p11 -= fix16Mul(k1, p11);
+  }
+
+  if (seconds)
+    rate_ += (int64_t)(fix16Div(plate_ - last, seconds) - rate_) * dt /
+             (KALMAN_RATE_TIME + dt);
+  return plate_;
+}
+
+fix16_t plate() { return plate_; }
+
+fix16_t sensor() { return sensor_; }
+
+fix16_t rate() { return rate_; }
+
+} // namespace kalman
@@ -0,0 +1,86 @@
+/*
+ * Shadow frame buffer for the 16x2 character LCD
+ */
+#include "lcd_frame.h"
+#include <string.h>
+
+#ifdef LCD16X2
+
+LcdFrame::LcdFrame(Lcd &lcd)
+    : _lcd(lcd), _col(0), _row(0), _lcdCol(0), _lcdRow(0xff), _frames(0),
+      _bytes(0), _lastBytes(0), _maxBytes(0) {
+  clear();
+  invalidate();
+}
+
+void LcdFrame::clear() {
+  memset(_text, ' ', sizeof(_text));
+  _col = 0;
+  _row = 0;
+}
+
+void LcdFrame::setCursor(uint8_t col, uint8_t row) {
+  _col = col;
+  _row = row;
+}
+
+void LcdFrame::print(const char *s) {
+  if (_row >= LCD_FRAME_ROWS)
+    return;
+  while (*s && _col < LCD_FRAME_COLUMNS)
+    _text[_row][_col++] = *s++;
+}
+
+void LcdFrame::invalidate() {
+  // No printable character is 0, so every cell differs
+  memset(_shown, 0, sizeof(_shown));
+  _lcdRow = 0xff;
+}
+
+void LcdFrame::flush() {
+  uint16_t transfers = 0;
+  bool room = true;
+
+  for (uint8_t row = 0; row < LCD_FRAME_ROWS && room; row++) {
+    uint8_t col = 0;
+    while (col < LCD_FRAME_COLUMNS) {
+      if (!changed(row, col)) {
+        col++;
+        continue;
+      }
+
+      // Extend the run over changes no more than LCD_FRAME_MAX_GAP apart
+      uint8_t end = col;
+      for (uint8_t i = col + 1;
+           i < LCD_FRAME_COLUMNS && i <= end + LCD_FRAME_MAX_GAP + 1; i++) {
+        if (changed(row, i))
+          end = i;
+      }
+
+      bool move = row != _lcdRow || col != _lcdCol;
+      uint8_t run = end - col + 1 + move;
+      if (!_lcd.canWrite(run)) {
+        room = false; // The rest waits for the next flush
+        break;
+      }
+      if (move)
+        _lcd.setCursor(col, row);
+      for (; col <= end; col++) {
+        _lcd.write((uint8_t)_text[row][col]);
+        _shown[row][col] = _text[row][col];
+      }
+      transfers += run;
+      _lcdRow = row;
+      _lcdCol = col;
+    }
+  }
+  _lcd.flush();
+
+  _lastBytes = transfers ? transfers * LCD_I2C_BYTES_PER_TRANSFER + 1 : 0;
+  if (_lastBytes > _maxBytes)
+    _maxBytes = _lastBytes;
+  _bytes += _lastBytes;
+  _frames++;
+}
+
+#endif // LCD16X2
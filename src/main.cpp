@@ -145,64 +145,71 @@ library.
 *******************************************************************************/
 
 // ***** INCLUDES *****
-#include <Arduino.h>
-#include <EEPROM.h>
-#include <PID_v1.h>
-#include <button.h>
-
-#ifdef MAX31855
-#include <MAX31855.h>
-#endif
-
-#ifdef THERMLIB
-#include <thermistor.h>
-#endif
+#include "hal.h"
+#include "sensor.h"
+#include "buttons.h"
+#include "reflow.h"
+#include "scheduler.h"
+#include "channel.h"
+#include "profile.h"
+#include "ssr.h"
+#include "store.h"
+#include "lcd_frame.h"
+#include "telemetry.h"
+#include "runlog.h"
+#include "autotune.h"
+#include "model.h"
+#include "kalman.h"
+#include "monitor.h"
+#include "timing.h"
 
 #ifdef SSD1306
-#include <SSD1306Ascii.h>
-#include <SSD1306AsciiWire.h>
-#endif
-
-#ifdef LCD16X2
-#include <LCD_I2C.h>
+#include "ssd1306_twi.h"
+#include "twi.h"
+#include "oled_chart.h"
 #endif
 
 // ***** ENABLE SERIAL PRINTOUT OUTPUT *****
+// Stream binary telemetry samples during runs, see telemetry.h; the port is
+// open either way for run log downloads
 //#define SERIAL_PRINTOUT
 
 // ***** GENERAL PROFILE CONSTANTS *****
-#define PROFILE_TYPE_ADDRESS 0
+// Profiles themselves are segment tables in profiles.cpp
 #define TEMPERATURE_ROOM 50
-#define TEMPERATURE_SOAK_MIN 150
-#define TEMPERATURE_COOL_MIN 100
-#define SENSOR_SAMPLING_TIME 1000 // thermocouple reading interval
-#define SOAK_TEMPERATURE_STEP 5
-#define RUNAWAY_TIME 5000 // MAX seconds without temperature change
-
-// ***** LEAD FREE PROFILE CONSTANTS *****
-#define TEMPERATURE_SOAK_MAX_LF 200
-#define TEMPERATURE_REFLOW_MAX_LF 250
-#define SOAK_MICRO_PERIOD_LF 9000
-
-// ***** LEADED PROFILE CONSTANTS *****
-#define TEMPERATURE_SOAK_MAX_PB 180
-#define TEMPERATURE_REFLOW_MAX_PB 224
-#define SOAK_MICRO_PERIOD_PB 10000
+#define SENSOR_SAMPLING_TIME 1000 // Fault monitor and run log sample [ms]
+#define SPLASH_TIME 3500 // Splash on the display, control runs meanwhile
+#define SPLASH_BEEP 500  // Second start-up beep
+#define RESUME_DROP 10   // Resume a run cut short if the plate cooled less [C]
+#define AUX_TEMPERATURE_MAX 150 // Auxiliary heater setpoint at most [C]
 
 // ***** PID PARAMETERS *****
-#define PID_KP_PREHEAT 100
-#define PID_KI_PREHEAT 0.025
-#define PID_KD_PREHEAT 20
-
-#define PID_KP_SOAK 300
-#define PID_KI_SOAK 0.05
-#define PID_KD_SOAK 250
-
-#define PID_KP_REFLOW 300
-#define PID_KI_REFLOW 0.05
-#define PID_KD_REFLOW 350
+// Gains come from the gain schedule, per second; the plate model (model.h)
+// adds feedforward and the estimator (kalman.h) the plate without the lag
 #define PID_SAMPLE_TIME 1000
 
+// ***** SAMPLING RATES *****
+// Sensor reading and PID intervals by reflowState_t, fast where the plate
+// moves fast. The sensor is read no faster than it converts, at an interval
+// that divides SENSOR_SAMPLING_TIME; FixedPID rescales the gains for its
+// sample time. The relay experiment keeps one-second readings.
+typedef struct SAMPLING_RATE {
+  uint16_t sensor; // [ms]
+  uint16_t pid;    // [ms]
+} samplingRate_t;
+
+const samplingRate_t samplingRates[] PROGMEM = {
+    {1000, 1000}, // Idle
+    {100, 200},   // Preheat
+    {250, 500},   // Soak
+    {100, 200},   // Reflow
+    {500, 1000},  // Cool
+    {1000, 1000}, // Complete
+    {1000, 1000}, // Too hot
+    {1000, 1000}, // Error
+    {1000, 1000}, // Autotune
+};
+
 // ***** LCD DISPLAY *****
 #ifdef SSD1306
 #define SCREEN_WIDTH 128
@@ -219,30 +226,11 @@ library.
 #define X_AXIS_START 9 // X-axis starting position for the chart
 #endif
 
-// ***** TYPE DEFINITIONS *****
-typedef enum REFLOW_STATE {
-  REFLOW_STATE_IDLE,
-  REFLOW_STATE_PREHEAT,
-  REFLOW_STATE_SOAK,
-  REFLOW_STATE_REFLOW,
-  REFLOW_STATE_COOL,
-  REFLOW_STATE_COMPLETE,
-  REFLOW_STATE_TOO_HOT,
-  REFLOW_STATE_ERROR
-} reflowState_t;
+// ***** STATE *****
 reflowState_t reflowState;
-
-typedef enum REFLOW_STATUS {
-  REFLOW_STATUS_OFF,
-  REFLOW_STATUS_ON
-} reflowStatus_t;
 reflowStatus_t reflowStatus;
-
-typedef enum REFLOW_PROFILE {
-  REFLOW_PROFILE_LEADFREE,
-  REFLOW_PROFILE_LEADED
-} reflowProfile_t;
 reflowProfile_t reflowProfile;
+reflowFault_t reflowFault;
 
 // ***** LCD MESSAGES *****
 const char ready_m[] PROGMEM = "Ready ";
@@ -253,46 +241,30 @@ const char coolDn_m[] PROGMEM = "CoolDn";
 const char done_m[] PROGMEM = "Done! ";
 const char hot_m[] PROGMEM = "Hot!  ";
 const char error_m[] PROGMEM = "Error";
+const char tune_m[] PROGMEM = "Tune  ";
 
 PGM_P const lcdMessages[] PROGMEM = {ready_m,  preheat_m, soak_m, reflow_m,
-                                     coolDn_m, done_m,    hot_m,  error_m};
-
-// ***** PIN ASSIGNMENT *****
-
-uint8_t thermPin = A6;
-
-#ifdef THERMLIB
-uint8_t thermType = 1;
+                                     coolDn_m, done_m,    hot_m,  error_m,
+                                     tune_m};
+
+// ***** CONTROL CHANNELS *****
+// The plate's PID input is its estimate, see kalman.h
+PlateChannel plate;
+#if CONTROL_CHANNELS > 1
+AuxChannel aux;
+uint8_t auxFaults; // Readings in a row out of the monitor's limits
 #endif
-
-uint8_t ssrPin = 5;
-uint8_t fanPin = 8;
-uint8_t buzzerPin = 3;
-uint8_t ledPin = 6;
-uint8_t btn1Pin = 12;
-uint8_t btn2Pin = 11;
-uint8_t btn3Pin = 10;
-uint8_t btn4Pin = 9;
-
-// ***** PID CONTROL VARIABLES *****
-double setpoint;
-double thermoReading;
-double thermoReadingRead;
-double output;
-double kp = PID_KP_PREHEAT;
-double ki = PID_KI_PREHEAT;
-double kd = PID_KD_PREHEAT;
+uint8_t sensorTurn; // Channel the sensor task reads next
+uint8_t pidTurn;    // Channel the PID task steps next
+uint8_t mainsHz;    // Sensor filter set for, once the SSR has measured it
+unsigned long firstRead;
+unsigned long lastRead; // Of the plate
+bool plateRead;         // The first reading is in, see firstReading()
+uint8_t sampledState;   // reflowState_t the rates are set for
+unsigned long sampleDuty; // Duty x ms over the monitor's sample so far
+unsigned int sampleTime;  // [ms]
+fix16_t setpointOffset; // Up/Down buttons, added to the profile setpoint
 unsigned long windowSize;
-unsigned long windowStartTime;
-
-unsigned long nextRead; // for keeping track of thermocouple reading interval
-unsigned long
-    lastChangedTemp; // for keeping track of thermocouple reading interval
-unsigned long updateLcd;
-unsigned long timerSoak;
-uint8_t soakTemperatureMax;
-uint8_t reflowTemperatureMax;
-unsigned long soakMicroPeriod;
 
 // Seconds timer
 unsigned int timerSeconds;
@@ -300,51 +272,44 @@ unsigned int temperatureUpdate;
 
 uint8_t temperature[SCREEN_WIDTH - X_AXIS_START];
 uint8_t idx;
-
-PID reflowOvenPID(&thermoReading, &output, &setpoint, kp, ki, kd, DIRECT);
+uint8_t plotted; // Samples of temperature[] already on the chart
+#ifdef SSD1306
+bool framed; // Markers and axes drawn
+#endif
 
 #ifdef SSD1306
-SSD1306AsciiWire oled;
+SSD1306AsciiTwi oled;
 #endif
 #ifdef LCD16X2
-LCD_I2C lcd(I2C_ADDRESS, SCREEN_WIDTH, SCREEN_HEIGHT);
-#endif
-#ifdef MAX31885
-MAX31855 thermocouple(thermPin);
-#endif
-#ifdef THERMLIB
-thermistor thermocouple(thermPin, thermType);
+Lcd lcd(I2C_ADDRESS, SCREEN_WIDTH, SCREEN_HEIGHT);
+LcdFrame lcdFrame(lcd);
 #endif
 
-Button startBtn;   // For start/stop
-Button profileBtn; // For selection of Lead-Free or Leaded profile
-Button upBtn;      // For adjust temp up
-Button downBtn;    // for adjust temp down
+// ***** TASKS *****
+Scheduler scheduler;
+int8_t sensorTask;
+int8_t pidTask;
+int8_t buzzerTask;
+int8_t displayTask;
+int8_t storeTask;
+int8_t serialTask;
+int8_t logTask;
+
+const char sensorTask_m[] PROGMEM = "sensor";
+const char pidTask_m[] PROGMEM = "pid";
+const char buzzerTask_m[] PROGMEM = "buzzer";
+const char displayTask_m[] PROGMEM = "display";
+const char storeTask_m[] PROGMEM = "store";
+const char serialTask_m[] PROGMEM = "serial";
+const char logTask_m[] PROGMEM = "log";
 
 #ifdef SSD1306
 /* A helper function to print the degree symbol on LCD display */
 void printDegreeSymbol() {
   const char degree[6] = {0x00, 0x06, 0x09, 0x09, 0x06, 0x00};
-  Wire.beginTransmission(I2C_ADDRESS);
-  Wire.write(0x040);
   for (uint8_t i = 0; i < 6; i++) {
-    Wire.write(degree[i]);
+    oled.ssd1306WriteRam(degree[i]);
   }
-  Wire.endTransmission();
-}
-
-/* A helper function for drawing a pixel on SH1106 display */
-void drawPixel() __attribute__((always_inline));
-inline void drawPixel(uint8_t x, uint8_t y, bool stackUp = false) {
-  oled.setCursor(x, y >> 3);
-  Wire.beginTransmission(I2C_ADDRESS);
-  uint8_t colData = 0;
-  if (stackUp) // if going to be a vertical line, it need to get the existing
-               // data
-    colData = Wire.read();
-  Wire.write(0x040);
-  Wire.write((1 << (y & 7)) | colData);
-  Wire.endTransmission();
 }
 
 /*
@@ -353,8 +318,6 @@ inline void drawPixel(uint8_t x, uint8_t y, bool stackUp = false) {
  */
 void splashDisplay();
 void splashDisplay() {
-  Wire.begin();
-  Wire.setClock(400000L);
   oled.begin(&SH1106_128x64, I2C_ADDRESS);
   oled.setFont(font5x7);
   oled.clear();
@@ -364,14 +327,68 @@ void splashDisplay() {
   oled.println(F("     Version 3.00"));
   oled.println();
   oled.println(F("     2021-06-10"));
+  oled.flush();
 };
 
+/* Temperature markers and time axis, over the splash on the first refresh */
+void drawFrame() {
+  oled.clear();
+  oled.setCursor(0, 2);
+  oled.print(F("250"));
+  oled.setCursor(0, 4);
+  oled.print(F("150"));
+  oled.setCursor(0, 6);
+  oled.print(F(" 50"));
+  chart::begin(oled);
+  chart::drawAxes();
+}
+
+/* Start the chart of a new run */
+void clearChart() {
+  // Initialize reflow plot update timer
+  temperatureUpdate = 0;
+
+  for (idx = 0; idx < sizeof(temperature); idx++) {
+    temperature[idx] = 0;
+  }
+  // Initialize index for average temperature array used for reflow plot
+  idx = 0;
+  plotted = 0;
+  chart::clear();
+}
+
 /*
- * update display - re-factor this part of code out of the loop() as an inline
- * function to make the loop() less crowder.
+ * update display - runs as the display task every UPDATE_RATE, after any
+ * control task that is due. The drawing is queued on the TWI; while the last
+ * refresh is still going out this one is skipped and the next one shows the
+ * current values.
  */
-void updateDisplay() __attribute__((always_inline));
-inline void updateDisplay() {
+void updateDisplay() {
+  TIMING_SCOPE(TIMING_DISPLAY);
+  if (reflowStatus == REFLOW_STATUS_ON) {
+    // We are updating the display faster than sensor reading
+    if (timerSeconds > temperatureUpdate) {
+      // Store temperature reading every 4 s
+      if ((timerSeconds % 4) == 0) {
+        temperatureUpdate = timerSeconds;
+        uint8_t averageReading = map(fix16ToInt(plate.reading), 0, 260, 63, 19);
+        // only plot the chart when temperature raised to TEMPERATURE_ROOM(i.e.
+        // 50 C)
+        if ((idx < CHART_WIDTH) & (plate.reading > FIX16(TEMPERATURE_ROOM))) {
+          temperature[idx++] = averageReading;
+        }
+      }
+    }
+  }
+
+  if (!twi::idle())
+    return;
+  if (!framed) {
+    drawFrame();
+    framed = true;
+    return;
+  }
+
   oled.set2X();
   oled.setCursor(0, 0);
   char buff[7];
@@ -383,106 +400,127 @@ inline void updateDisplay() {
   if (reflowStatus == REFLOW_STATUS_OFF) {
     oled.print(F("      "));
   } else {
-    oled.print((int)setpoint);
+    oled.print(fix16ToInt(plate.setpoint));
     printDegreeSymbol();
     oled.print(F("C "));
   }
 
-  if (reflowProfile == REFLOW_PROFILE_LEADFREE) {
-    oled.print(F("LF"));
-  } else {
-    oled.print(F("PB"));
-  }
+  char name[3];
+  profile::name(reflowProfile, name);
+  oled.print(name);
 
   if (reflowState == REFLOW_STATE_ERROR) {
+    // Fault number, see reflowFault_t
     oled.setCursor(115, 1);
-    oled.print(F("TC"));
+    oled.print('E');
+    oled.print((int)reflowFault);
   }
 
   // Right align temperature reading
   char tempStr[10];
-  sprintf(tempStr, "%4d", (int)thermoReading);
+  sprintf(tempStr, "%4d", fix16ToInt(plate.reading));
   oled.setCursor(74, 1);
   oled.print(tempStr);
   printDegreeSymbol();
   oled.print(F("C"));
 
-  if (reflowStatus == REFLOW_STATUS_ON) {
-    // We are updating the display faster than sensor reading
-    if (timerSeconds > temperatureUpdate) {
-      // Store temperature reading every 4 s
-      if ((timerSeconds % 4) == 0) {
-        temperatureUpdate = timerSeconds;
-        uint8_t averageReading = map(thermoReading, 0, 260, 63, 19);
-        // only plot the chart when temperature raised to TEMPERATURE_ROOM(i.e.
-        // 50 C)
-        if ((idx < (SCREEN_WIDTH - X_AXIS_START)) &
-            (thermoReading > TEMPERATURE_ROOM)) {
-          temperature[idx++] = averageReading;
-        }
-      }
-    }
-  }
-
-  for (uint8_t timeAxis = 0; timeAxis < idx; timeAxis++) {
-    drawPixel(timeAxis + X_AXIS_START + 1, temperature[timeAxis]);
+  // Only samples stored since the last refresh are drawn
+  for (; plotted < idx; plotted++) {
+    chart::plot(plotted, temperature[plotted]);
   }
+  oled.flush();
 }
 #endif // SSD1306 FUNCTIONS
 
 #ifdef LCD16X2
+// One per reflowFault_t
+const char fault_m[] PROGMEM = "ERROR";
+const char aborted_m[] PROGMEM = "ABORTED";
+const char sensor_m[] PROGMEM = "SENSOR ERROR";
+const char heater_m[] PROGMEM = "NO HEAT ERROR";
+const char autotune_m[] PROGMEM = "AUTOTUNE ERROR";
+const char stuckOn_m[] PROGMEM = "SSR STUCK ON";
+const char overtemp_m[] PROGMEM = "OVERTEMP ERROR";
+const char reset_m[] PROGMEM = "RESET IN RUN";
+
+PGM_P const faultMessages[] PROGMEM = {fault_m,    aborted_m, sensor_m,
+                                       heater_m,   autotune_m, stuckOn_m,
+                                       overtemp_m, reset_m};
+
+/* Whole degrees right aligned in the 4 columns of buffer, clamped to fit */
+static void formatTemperature(char *buffer, fix16_t t) {
+  int16_t c = fix16ToInt(t);
+  c = c > 9999 ? 9999 : c < -999 ? -999 : c;
+  snprintf(buffer, 5, "%4d", c);
+}
+
 /*
  *  ERRROR - LCD 16x2
  *
  */
 void errorDisplay();
 void errorDisplay() {
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("RUNAWAY ERROR");
-  lcd.setCursor(0, 1);
+  lcdFrame.clear();
+  lcdFrame.setCursor(0, 0);
+  char buff[16];
+  strcpy_P(buff, (PGM_P)pgm_read_word(&faultMessages[reflowFault]));
+  lcdFrame.print(buff);
+  lcdFrame.setCursor(0, 1);
   char tempStr[5];
-  snprintf(tempStr, sizeof(tempStr), "%4d", (int)thermoReading);
-  lcd.print("TEMP:");
-  lcd.print(tempStr);
+  formatTemperature(tempStr, plate.reading);
+  lcdFrame.print("TEMP:");
+  lcdFrame.print(tempStr);
 };
 /*
  *  UpdateDisplay - LCD 16x2
  *
+ *  Renders into lcdFrame; only the cells that changed go out to the LCD.
  */
-void updateDisplay() __attribute__((always_inline));
-inline void updateDisplay() {
+void updateDisplay() {
+  TIMING_SCOPE(TIMING_DISPLAY);
   if (reflowState != REFLOW_STATE_ERROR) {
-    lcd.clear();
+    lcdFrame.clear();
     // First Line
-    lcd.setCursor(0, 0);
-    lcd.print("T:");
+    lcdFrame.setCursor(0, 0);
+    lcdFrame.print("T:");
     // Right align temperature reading
     char tempStr[5];
-    snprintf(tempStr, sizeof(tempStr), "%4d", (int)thermoReading);
-    lcd.print(tempStr);
+    formatTemperature(tempStr, plate.reading);
+    lcdFrame.print(tempStr);
 
-    lcd.setCursor(9, 0);
+    lcdFrame.setCursor(9, 0);
     char buff[7];
     strcpy_P(buff, (PGM_P)pgm_read_word(&lcdMessages[reflowState]));
-    lcd.print(buff);
+    lcdFrame.print(buff);
 
     // Second Line
-    lcd.setCursor(0, 1);
+    lcdFrame.setCursor(0, 1);
     if (reflowStatus != REFLOW_STATUS_OFF) {
-      lcd.print("SP:");
-      snprintf(tempStr, sizeof(tempStr), "%4d", (int)setpoint);
-      lcd.print(tempStr);
+      lcdFrame.print("SP:");
+      formatTemperature(tempStr, plate.setpoint);
+      lcdFrame.print(tempStr);
     };
-    lcd.setCursor(9, 1);
-    if (reflowProfile == REFLOW_PROFILE_LEADFREE) {
-      lcd.print("Prof LF");
+    lcdFrame.setCursor(9, 1);
+    if (reflowStatus == REFLOW_STATUS_ON) {
+      // Rate of the plate estimate in a run, as +1.3C/s
+      int16_t tenths = fix16ToInt(kalman::rate() * 10 + FIX16_ONE / 2);
+      uint8_t size = tenths < -99 || tenths > 99 ? 99
+                     : tenths < 0                ? -tenths
+                                                 : tenths;
+      char rateStr[8]; // One digit each side of the point
+      snprintf(rateStr, sizeof(rateStr), "%c%u.%uC/s", tenths < 0 ? '-' : '+',
+               (unsigned)(size / 10 % 10), (unsigned)(size % 10));
+      lcdFrame.print(rateStr);
     } else {
-      lcd.print("Prof PB");
+      lcdFrame.print("Prof ");
+      char name[3];
+      profile::name(reflowProfile, name);
+      lcdFrame.print(name);
     }
   } else {
     errorDisplay();
   };
+  lcdFrame.flush();
 };
 /*
  *  Splash - LCD 16x2
@@ -497,366 +535,545 @@ void splashDisplay() {
   lcd.print("HotPlate PID V4");
   lcd.setCursor(0, 1);
   lcd.print("Starting");
+  lcd.flush();
 };
 #endif // END LCD16x2 FUNCTIONS
 
-void setup() {
-#ifdef SERIAL_PRINTOUT
-  Serial.begin(115200);
-  while (!Serial)
-    ;
-  Serial.println("Starting....");
+/* Every heater off now */
+void heatersOff() {
+  plate.off();
+#if CONTROL_CHANNELS > 1
+  aux.off();
+#endif
+}
 
+/* Any heater asked for or still on */
+bool heatersOn() {
+#if CONTROL_CHANNELS > 1
+  if (aux.heating())
+    return true;
 #endif
+  return plate.heating();
+}
 
-  // Check last-save reflow profile value, if not exist, default to lead-free
-  // profile
-  reflowProfile_t value = (reflowProfile_t)EEPROM.read(PROFILE_TYPE_ADDRESS);
-  if ((value == REFLOW_PROFILE_LEADFREE) || (value == REFLOW_PROFILE_LEADED)) {
-    reflowProfile = value;
-  } else {
-    EEPROM.write(PROFILE_TYPE_ADDRESS, 0);
-    reflowProfile = REFLOW_PROFILE_LEADFREE;
+#if CONTROL_CHANNELS > 1
+/*
+ * Auxiliary heater reading, held to the fault monitor's sensor and
+ * temperature limits; it has no plate model to check the heater against
+ */
+void readAux() {
+  aux.read();
+  bool bad = aux.reading <= MONITOR_SENSOR_MIN ||
+             aux.reading >= MONITOR_TEMPERATURE_MAX;
+  auxFaults = bad ? auxFaults + (auxFaults < MONITOR_CONFIRM) : 0;
+  if (auxFaults >= MONITOR_CONFIRM && reflowState != REFLOW_STATE_ERROR) {
+    reflowFault = aux.reading <= MONITOR_SENSOR_MIN ||
+                          aux.reading >= MONITOR_SENSOR_MAX
+                      ? REFLOW_FAULT_SENSOR
+                      : REFLOW_FAULT_OVERTEMP;
+    reflowState = REFLOW_STATE_ERROR;
   }
+}
 
-  // pin initializations
-  pinMode(ssrPin, OUTPUT);
-  digitalWrite(ssrPin, LOW);
-  pinMode(buzzerPin, OUTPUT);
-  digitalWrite(buzzerPin, LOW);
-  pinMode(ledPin, OUTPUT);
-
-  pinMode(btn1Pin, INPUT_PULLUP);
-  pinMode(btn2Pin, INPUT_PULLUP);
-  pinMode(btn3Pin, INPUT_PULLUP);
-  pinMode(btn4Pin, INPUT_PULLUP);
-  startBtn.begin(btn1Pin);
-  profileBtn.begin(btn2Pin);
-  upBtn.begin(btn4Pin);
-  downBtn.begin(btn3Pin);
-
-  // Start-up splash
-  digitalWrite(ledPin, HIGH);
-  splashDisplay();
-  tone(buzzerPin, 1800, 200);
-  delay(500);
-  tone(buzzerPin, 1800, 200);
-  delay(3000);
-  digitalWrite(ledPin, LOW);
-
-  // Temperature markers and time axis
-#ifdef SSD1355
-  oled.clear();
-  oled.setCursor(0, 2);
-  oled.print(F("250"));
-  oled.setCursor(0, 4);
-  oled.print(F("150"));
-  oled.setCursor(0, 6);
-  oled.print(F(" 50"));
-  for (uint8_t i = 18; i < SCREEN_HEIGHT - 1; i++)
-    drawPixel(X_AXIS_START, i, true); // draw a vertical line
-  for (uint8_t i = X_AXIS_START + 1; i < SCREEN_WIDTH; i++)
-    drawPixel(i, SCREEN_HEIGHT - 1); // draw a horizontal line
+/* Auxiliary heater PID step, following the plate's profile */
+void controlAux() {
+  if (reflowState == REFLOW_STATE_AUTOTUNE) {
+    aux.setDuty(0); // The relay experiment is the plate's alone
+    return;
+  }
+  aux.setpoint = plate.setpoint < FIX16(AUX_TEMPERATURE_MAX)
+                     ? plate.setpoint
+                     : FIX16(AUX_TEMPERATURE_MAX);
+  aux.feedback = aux.reading;
+  if (aux.rescheduled(aux.reading)) {
+    tuning_t gains;
+    profile::gains(aux.reading, &gains);
+    aux.pid.SetTunings(gains.kp, gains.ki, gains.kd);
+  }
+  aux.control(0);
+}
 #endif
 
-#ifdef MAX31855
-  // Initialize thermocouple interface
-  if (thermocouple.begin() != 0) {
-    reflowState = REFLOW_STATE_ERROR; // thermocouple connection error
-  };
+/*
+ * Sensor task - read the sensor at the interval of the state (samplingRates)
+ * into the plate estimate, and every SENSOR_SAMPLING_TIME (1000ms) check the
+ * plate and sensor for faults, run or no run, see monitor.h. With more than
+ * one channel the task runs that many times as often and reads them in turn.
+ * At boot it waits for the plate's first reading, see firstReading().
+ */
+void firstReading();
+void readSensor() {
+  TIMING_SCOPE(TIMING_SENSOR);
+#if CONTROL_CHANNELS > 1
+  uint8_t channel = sensorTurn;
+  sensorTurn = (sensorTurn + 1) % CONTROL_CHANNELS;
+  if (channel) {
+    readAux();
+    return;
+  }
 #endif
+  if (!plateRead) {
+    if (!(hal::sensorFaults(0) & SENSOR_FAULT_NOT_READY))
+      firstReading();
+    return;
+  }
+  // Thermocouple converters with a mains notch filter get the frequency
+  if (ssr::mainsFrequency() != mainsHz) {
+    mainsHz = ssr::mainsFrequency();
+    if (mainsHz)
+      hal::sensorMains(mainsHz);
+  }
+  // Duty the heater was actually on for since the last reading
+  fix16_t duty = plate.read();
+  unsigned long now = hal::millis();
+  kalman::update(plate.reading, duty, now - lastRead);
+  sampleDuty += (unsigned long)duty * (now - lastRead);
+  sampleTime += now - lastRead;
+  lastRead = now;
+  // The monitor and the run log take a sample every SENSOR_SAMPLING_TIME,
+  // with the duty over it, whatever the reading interval
+  if (sampleTime < SENSOR_SAMPLING_TIME)
+    return;
+  duty = sampleDuty / sampleTime;
+  sampleDuty = 0;
+  sampleTime = 0;
+  hal::writeLed(true);
+  timerSeconds++;
+
+  reflowFault_t fault = monitor::update(plate.reading, duty, kalman::plate());
+  if (fault != REFLOW_FAULT_NONE && reflowState != REFLOW_STATE_ERROR) {
+    // loop() turns the heater off and ends the run
+    reflowFault = fault;
+    reflowState = REFLOW_STATE_ERROR;
+  }
 
-  windowSize = 2000; // time in ms for PID calculation
-  nextRead = millis();
-  updateLcd = millis();
+  if (reflowStatus == REFLOW_STATUS_ON) {
+    runlog::sample(plate.reading, reflowState, hal::millis());
+  } else {
+    hal::writeLed(false);
+  }
 }
 
-void loop() {
-  static unsigned long buzzerPeriod;
-
-  // update display every UPDATE_RATE(100ms)
-  if (millis() - updateLcd >= UPDATE_RATE) {
-    updateDisplay();
-    updateLcd = millis();
+/*
+ * PID task - advance the profile and run one controller step at the interval
+ * of the state (samplingRates), the SSR timer interrupt switches the heater. Like the
+ * sensor task, it takes the channels in turn.
+ */
+void computePid() {
+  TIMING_SCOPE(TIMING_PID);
+  if (reflowStatus != REFLOW_STATUS_ON) {
+    scheduler.stop(pidTask);
+    return;
   }
-
-  // if Start/Stop button pressed, and current reflow process is on going,
-  // turn it off
-  if (startBtn.debounce() && ((reflowStatus == REFLOW_STATUS_ON) ||
-                              (reflowState == REFLOW_STATE_ERROR))) {
-    reflowStatus = REFLOW_STATUS_OFF;
-    reflowState = REFLOW_STATE_IDLE;
+#if CONTROL_CHANNELS > 1
+  uint8_t channel = pidTurn;
+  pidTurn = (pidTurn + 1) % CONTROL_CHANNELS;
+  if (channel) {
+    controlAux();
+    return;
   }
-
-  // if LF/RF button is pressed and only reflow process is idle, it allows to
-  // toggle
-  if (profileBtn.debounce() && (reflowState == REFLOW_STATE_IDLE)) {
-    // toggle the profile state
-    if (reflowProfile == REFLOW_PROFILE_LEADFREE)
-      reflowProfile = REFLOW_PROFILE_LEADED;
-    else
-      reflowProfile = REFLOW_PROFILE_LEADFREE;
-    EEPROM.write(PROFILE_TYPE_ADDRESS, reflowProfile);
+#endif
+  if (reflowState == REFLOW_STATE_AUTOTUNE) {
+    // The relay drives the heater, loop() finishes the experiment
+    autotune::update(plate.reading, hal::millis());
+    plate.setpoint = fix16FromInt(autotune::target());
+    plate.output = autotune::heater() ? fix16FromInt(windowSize) : 0;
+    plate.setDuty(autotune::heater() ? SSR_DUTY_MAX : 0);
+#ifdef SERIAL_PRINTOUT
+    telemetry::sample(hal::millis(), plate.setpoint, plate.reading,
+                      plate.output, reflowState, kalman::plate(),
+                      kalman::rate());
+#endif
+    return;
   }
-  // if UP Button, change the setpoint
-  if (upBtn.debounce() && (reflowStatus != REFLOW_STATUS_OFF)) {
-    setpoint++;
+  // The plate as it is, not as the lagging sensor shows it
+  unsigned long now = hal::millis();
+  plate.feedback = kalman::plate();
+  if (profile::update(plate.feedback, now)) {
+    if (profile::done()) {
+      // loop() finishes the run
+      heatersOff();
+      return;
+    }
+    reflowState = profile::state();
+    runlog::checkpoint(profile::position(), reflowState, plate.reading);
   }
-  if (downBtn.debounce() && (reflowStatus != REFLOW_STATUS_OFF)) {
-    setpoint--;
+  // Gains follow the plate temperature a degree at a time, SetTunings() is
+  // bumpless
+  if (plate.rescheduled(plate.feedback)) {
+    tuning_t gains;
+    profile::gains(plate.feedback, &gains);
+    plate.pid.SetTunings(gains.kp, gains.ki, gains.kd);
   }
-
-  // read thermocouple every SENSOR_SAMPLING_TIME (1000ms)
-  if (millis() - nextRead >= SENSOR_SAMPLING_TIME) {
-    nextRead = millis();
-    thermoReadingRead = thermoReading;
-#ifdef MAX31855
-    thermoReading = thermocouple.thermocoupleTemperature();
-#endif
-#ifdef THERMLIB
-    thermoReading = thermocouple.analog2temp();
+  plate.setpoint = profile::setpoint() + setpointOffset;
+  // The duty the model needs for the ramp, the PID corrects what it misses
+  plate.control(model::feedForward(plate.setpoint, profile::rate()) *
+                windowSize);
+#ifdef SERIAL_PRINTOUT
+  telemetry::sample(hal::millis(), plate.setpoint, plate.reading,
+                    plate.output, reflowState, kalman::plate(), kalman::rate());
 #endif
-    digitalWrite(ledPin, HIGH);
-    timerSeconds++;
+}
 
-    if (reflowStatus == REFLOW_STATUS_ON) {
-      // Runaway ERROR calculation
-      switch (reflowState) {
-      case REFLOW_STATE_IDLE:
-        if (thermoReadingRead < thermoReading) {
-          if (millis() - lastChangedTemp < RUNAWAY_TIME) {
-            reflowState = REFLOW_STATE_ERROR;
-            reflowStatus = REFLOW_STATUS_OFF;
-          }
-        } else {
-          lastChangedTemp = millis();
-        }
-        break;
-      case REFLOW_STATE_PREHEAT:
-        if (thermoReadingRead < thermoReading) {
-          if (millis() - lastChangedTemp < RUNAWAY_TIME) {
-            reflowState = REFLOW_STATE_ERROR;
-            reflowStatus = REFLOW_STATUS_OFF;
-          }
-        } else {
-          lastChangedTemp = millis();
-        }
-        break;
-      case REFLOW_STATE_SOAK:
-        if (thermoReadingRead <= thermoReading) {
-          if (millis() - lastChangedTemp < RUNAWAY_TIME) {
-            reflowState = REFLOW_STATE_ERROR;
-            reflowStatus = REFLOW_STATUS_OFF;
-          }
-        } else {
-          lastChangedTemp = millis();
-        }
-        break;
-      case REFLOW_STATE_REFLOW:
-        if (thermoReadingRead <= thermoReading) {
-          if (millis() - lastChangedTemp < RUNAWAY_TIME) {
-            reflowState = REFLOW_STATE_ERROR;
-            reflowStatus = REFLOW_STATUS_OFF;
-          }
-        } else {
-          lastChangedTemp = millis();
-        }
-        break;
-      case REFLOW_STATE_COOL:
-        if (thermoReadingRead > thermoReading) {
-          if (millis() - lastChangedTemp < RUNAWAY_TIME) {
-            reflowState = REFLOW_STATE_ERROR;
-            reflowStatus = REFLOW_STATUS_OFF;
-          }
-        } else {
-          lastChangedTemp = millis();
-        }
-        break;
-      case REFLOW_STATE_COMPLETE:
-        break;
-      case REFLOW_STATE_TOO_HOT:
-        break;
-      case REFLOW_STATE_ERROR:
-        break;
-      default:
-        break;
-      }
+/*
+ * Buzzer task - one second after completion, beep and hand over to the
+ * cooling down (too hot) state
+ */
+void completeBeep() {
+  hal::tone(1800, 200);
+  // Reflow process ended
+  if (reflowState == REFLOW_STATE_COMPLETE)
+    reflowState = REFLOW_STATE_TOO_HOT;
+}
 
-#ifdef SERIAL_PRINTOUT
-      Serial.print(timerSeconds);
-      Serial.print(F(", "));
-      Serial.print(setpoint);
-      Serial.print(F(", "));
-      Serial.print(thermoReading);
-      Serial.print(F(", "));
-      Serial.println(output);
-#endif
+/*
+ * Store task - write the settings once they have been left alone for
+ * STORE_COMMIT_DELAY; EEPROM writes stall for milliseconds each, so not
+ * while a run is on
+ */
+void commitStore() {
+  if (reflowStatus == REFLOW_STATUS_ON)
+    scheduler.start(storeTask, STORE_COMMIT_DELAY);
+  else
+    store::commit();
+}
 
-    } else {
-      digitalWrite(ledPin, LOW);
-    }
-  }
+/* Serial task - console commands, uploads and run log downloads */
+void pollSerial() {
+  telemetry::poll(hal::millis());
+  // An upload is written like a Profile press, and can empty the user
+  // profile that was selected
+  if (reflowProfile >= profile::count())
+    reflowProfile = REFLOW_PROFILE_LEADFREE;
+  if (store::pending() && !scheduler.active(storeTask))
+    scheduler.start(storeTask, STORE_COMMIT_DELAY);
+}
 
-  // Reflow oven controller state machine
-  switch (reflowState) {
-  case REFLOW_STATE_IDLE:
-    // If oven temperature is still above room temperature
-    if (thermoReading >= TEMPERATURE_ROOM) {
-      reflowState = REFLOW_STATE_TOO_HOT;
-    } else {
-      // If switch is pressed to start reflow process
-      if (startBtn.debounce()) {
+/* Log task - the run log's queued EEPROM writes, a byte at a time */
+void writeLog() { runlog::flush(); }
 
+/*
+ * Sensor and PID intervals for the reflow state, see samplingRates; the PID
+ * task is started if a run has just begun, else it keeps its phase. At boot
+ * the sensor task first runs when a one-shot sensor's conversion is in.
+ */
+void setSampling() {
+  sampledState = reflowState;
+  samplingRate_t rate;
+  memcpy_P(&rate, &samplingRates[reflowState], sizeof(rate));
+  unsigned int interval = rate.sensor;
+  while (interval < hal::sensorInterval() || SENSOR_SAMPLING_TIME % interval)
+    interval++;
+  bool pending = hal::sensorFaults(0) & SENSOR_FAULT_NOT_READY;
+  scheduler.start(sensorTask,
+                  pending ? hal::sensorInterval() : interval / CONTROL_CHANNELS,
+                  interval / CONTROL_CHANNELS);
+  plate.pid.SetSampleTime(rate.pid);
+#if CONTROL_CHANNELS > 1
+  aux.pid.SetSampleTime(rate.pid);
+#endif
+  if (reflowStatus == REFLOW_STATUS_ON)
+    scheduler.start(pidTask,
+                    scheduler.active(pidTask) ? rate.pid / CONTROL_CHANNELS
+                                              : 0,
+                    rate.pid / CONTROL_CHANNELS);
+}
+
+/*
+ * Start the selected profile from its first segment, or go on with a run a
+ * reset cut short from the segment it was in
+ */
+void startRun(const runCheckpoint_t *resumed) {
 #ifdef SERIAL_PRINTOUT
-        Serial.println(F("Time, Setpoint, Temperature, Output"));
+  telemetry::start(hal::millis(), reflowProfile, windowSize);
 #endif
-        // Intialize seconds timer for serial debug information
-        timerSeconds = 0;
+  reflowFault = REFLOW_FAULT_NONE;
+  int16_t liquidus = profile::liquidus(reflowProfile);
+  if (resumed)
+    runlog::resume(*resumed, liquidus, plate.reading, hal::millis());
+  else
+    runlog::start(reflowProfile, liquidus, plate.reading, hal::millis());
+  // Intialize seconds timer for serial debug information
+  timerSeconds = 0;
 
-#ifdef SD1306
-        // Initialize reflow plot update timer
-        temperatureUpdate = 0;
+#ifdef SSD1306
+  clearChart();
+#endif
+  // The segment starts from the plate temperature
+  profile::begin(reflowProfile, plate.reading, hal::millis(),
+                 resumed ? resumed->segment : 0);
+  model::begin(store::model(), plate.reading);
+  setpointOffset = 0;
+  plate.setpoint = profile::setpoint();
+  // The PID ranges between 0 and the full window size
+  tuning_t gains;
+  profile::gains(plate.reading, &gains);
+  plate.start(windowSize, PID_SAMPLE_TIME, gains);
+#if CONTROL_CHANNELS > 1
+  profile::gains(aux.reading, &gains);
+  aux.start(windowSize, PID_SAMPLE_TIME, gains);
+#endif
+  pidTurn = 0;
+  // Proceed to the first stage
+  reflowStatus = REFLOW_STATUS_ON;
+  reflowState = profile::state();
+  setSampling();
+  runlog::checkpoint(profile::position(), reflowState, plate.reading);
+}
 
-        for (idx = 0; idx < (SCREEN_WIDTH - X_AXIS_START + 1); idx++) {
-          temperature[idx] = 0;
-        }
-        // Initialize index for average temperature array used for reflow plot
-        idx = 0;
+/*
+ * Up pressed while idle - tune the PID gains of this plate with relay
+ * experiments at the soak and reflow temperatures of the selected profile,
+ * see autotune.h. The gains are stored once it is done and replace the
+ * profile gains of every later run.
+ */
+void startAutotune() {
+  const int16_t targets[AUTOTUNE_EXPERIMENTS] = {
+      profile::target(reflowProfile, REFLOW_STATE_SOAK),
+      profile::target(reflowProfile, REFLOW_STATE_REFLOW)};
+#ifdef SERIAL_PRINTOUT
+  telemetry::start(hal::millis(), reflowProfile, windowSize);
 #endif
-        // Initialize PID control window starting time
-        windowStartTime = millis();
-        // Ramp up to minimum soaking temperature
-        setpoint = TEMPERATURE_SOAK_MIN;
-        // Load profile specific constant
-        if (reflowProfile == REFLOW_PROFILE_LEADFREE) {
-          soakTemperatureMax = TEMPERATURE_SOAK_MAX_LF;
-          reflowTemperatureMax = TEMPERATURE_REFLOW_MAX_LF;
-          soakMicroPeriod = SOAK_MICRO_PERIOD_LF;
-        } else {
-          soakTemperatureMax = TEMPERATURE_SOAK_MAX_PB;
-          reflowTemperatureMax = TEMPERATURE_REFLOW_MAX_PB;
-          soakMicroPeriod = SOAK_MICRO_PERIOD_PB;
-        }
-        // Tell the PID to range between 0 and the full window size
-        reflowOvenPID.SetOutputLimits(0, windowSize);
-        reflowOvenPID.SetSampleTime(PID_SAMPLE_TIME);
-        // Turn the PID on
-        reflowOvenPID.SetMode(AUTOMATIC);
-        // Proceed to preheat stage
-        thermoReadingRead = millis();
-        reflowState = REFLOW_STATE_PREHEAT;
+  reflowFault = REFLOW_FAULT_NONE;
+  timerSeconds = 0;
+#ifdef SSD1306
+  clearChart();
+#endif
+  autotune::begin(targets, windowSize, hal::millis());
+  setpointOffset = 0;
+  pidTurn = 0;
+  reflowStatus = REFLOW_STATUS_ON;
+  reflowState = REFLOW_STATE_AUTOTUNE;
+  setSampling();
+}
+
+/*
+ * A button event, taken once: Start starts a run from idle, stops one and
+ * clears an error; Profile selects the next profile while idle; Up and Down
+ * move the setpoint of a run, and repeat while held; holding Up while idle
+ * starts the autotune.
+ */
+void handleButton(const buttonEvent_t &event) {
+  switch (event.button) {
+  case BUTTON_START:
+    if (event.type != BUTTON_EVENT_PRESS)
+      break;
+    if (reflowStatus == REFLOW_STATUS_ON ||
+        reflowState == REFLOW_STATE_ERROR) {
+      if (reflowStatus == REFLOW_STATUS_ON) {
+        reflowFault = REFLOW_FAULT_ABORTED;
+        runlog::end(reflowFault, hal::millis());
       }
+      reflowStatus = REFLOW_STATUS_OFF;
+      reflowState = REFLOW_STATE_IDLE;
+    } else if (reflowState == REFLOW_STATE_IDLE && plateRead &&
+               plate.reading < FIX16(TEMPERATURE_ROOM)) {
+      startRun(NULL);
     }
     break;
 
-  case REFLOW_STATE_PREHEAT:
-    reflowStatus = REFLOW_STATUS_ON;
-    // If minimum soak temperature is achieve
-    if (thermoReading >= TEMPERATURE_SOAK_MIN) {
-      // Chop soaking period into smaller sub-period
-      timerSoak = millis() + soakMicroPeriod;
-      // Set less agressive PID parameters for soaking ramp
-      reflowOvenPID.SetTunings(PID_KP_SOAK, PID_KI_SOAK, PID_KD_SOAK);
-      // Ramp up to first section of soaking temperature
-      setpoint = TEMPERATURE_SOAK_MIN + SOAK_TEMPERATURE_STEP;
-      // Proceed to soaking state
-      reflowState = REFLOW_STATE_SOAK;
-    }
+  case BUTTON_PROFILE:
+    if (event.type != BUTTON_EVENT_PRESS || reflowState != REFLOW_STATE_IDLE)
+      break;
+    reflowProfile = (reflowProfile_t)((reflowProfile + 1) % profile::count());
+    // Written once the presses stop
+    store::settings().profile = reflowProfile;
+    store::change(STORE_SETTINGS);
+    scheduler.start(storeTask, STORE_COMMIT_DELAY);
     break;
 
-  case REFLOW_STATE_SOAK:
-    // If micro soak temperature is achieved
-    if (millis() > timerSoak) {
-      timerSoak = millis() + soakMicroPeriod;
-      // Increment micro setpoint
-      setpoint += SOAK_TEMPERATURE_STEP;
-      if (setpoint > soakTemperatureMax) {
-        // Set agressive PID parameters for reflow ramp
-        reflowOvenPID.SetTunings(PID_KP_REFLOW, PID_KI_REFLOW, PID_KD_REFLOW);
-        // Ramp up to first section of soaking temperature
-        setpoint = reflowTemperatureMax;
-        // Proceed to reflowing state
-        reflowState = REFLOW_STATE_REFLOW;
-      }
+  case BUTTON_UP:
+  case BUTTON_DOWN:
+    if (reflowStatus != REFLOW_STATUS_OFF) {
+      if (event.type == BUTTON_EVENT_PRESS ||
+          event.type == BUTTON_EVENT_REPEAT)
+        setpointOffset += event.button == BUTTON_UP ? FIX16_ONE : -FIX16_ONE;
+    } else if (event.button == BUTTON_UP &&
+               event.type == BUTTON_EVENT_LONG &&
+               reflowState == REFLOW_STATE_IDLE && plateRead &&
+               plate.reading < FIX16(TEMPERATURE_ROOM)) {
+      startAutotune();
     }
     break;
+  }
+}
 
-  case REFLOW_STATE_REFLOW:
-    // Temperature continue to rise by 10 degree when reach
-    // reflowTemperatureMax To avoid hovering at peak temperature for too
-    // long, switch to CoolDn earlier
-    if (thermoReading >= (reflowTemperatureMax - 10)) {
-      // Set PID parameters for cooling ramp
-      reflowOvenPID.SetTunings(PID_KP_REFLOW, PID_KI_REFLOW, PID_KD_REFLOW);
-      // Ramp down to minimum cooling temperature
-      setpoint = TEMPERATURE_COOL_MIN;
-    }
-    if (thermoReading >= reflowTemperatureMax) {
-      // Display only switch to 'CoolDn' when reach to the peak temp
-      reflowState = REFLOW_STATE_COOL;
+/*
+ * The first plate reading at boot starts the fault monitor's model and the
+ * estimator on it, and decides whether a run a reset cut short goes on
+ */
+void firstReading() {
+  plate.read();
+  firstRead = lastRead = hal::millis();
+  plateRead = true;
+  model::begin(store::model(), plate.reading);
+  kalman::begin(plate.reading);
+
+  // A run a reset cut short goes on if the plate is still about where its
+  // segment started, else it is logged as ended by the reset
+  runCheckpoint_t checkpoint;
+  if (reflowState != REFLOW_STATE_ERROR && runlog::interrupted(&checkpoint)) {
+    if (checkpoint.profile < profile::count() &&
+        (checkpoint.state == REFLOW_STATE_COOL ||
+         plate.reading >= fix16FromInt(checkpoint.reading) /
+                                  RUNLOG_SUMMARY_SCALE -
+                              FIX16(RESUME_DROP))) {
+      reflowProfile = (reflowProfile_t)checkpoint.profile;
+      startRun(&checkpoint);
+    } else {
+      runlog::abandon(checkpoint);
+      reflowFault = REFLOW_FAULT_RESET;
+      reflowState = REFLOW_STATE_ERROR;
     }
+  }
+}
+
+void setup() {
+  // Heater off and the plate under watch first, a reset in the middle of a
+  // run leaves it unsupervised only until here
+  hal::begin();
+  ssr::begin((ssrMode_t)SSR_MODE);
+  buttons::begin();
+  windowSize = SSR_WINDOW_SIZE; // time in ms for PID calculation
+  store::begin();
+  runlog::begin();
+  telemetry::begin();
+
+  // Initialize thermocouple interface
+  if (!hal::sensorBegin()) {
+    reflowState = REFLOW_STATE_ERROR; // thermocouple connection error
+    reflowFault = REFLOW_FAULT_SENSOR;
+  };
+  // Check last-save reflow profile value, if not exist, default to lead-free
+  // profile
+  uint8_t value = store::settings().profile;
+  if (value < profile::count()) {
+    reflowProfile = (reflowProfile_t)value;
+  } else {
+    reflowProfile = REFLOW_PROFILE_LEADFREE;
+  }
+
+  // Periodic tasks, control work is always dispatched before the display
+  sensorTask = scheduler.add(readSensor, TASK_PRIORITY_CONTROL, sensorTask_m);
+  pidTask = scheduler.add(computePid, TASK_PRIORITY_CONTROL, pidTask_m);
+  buzzerTask = scheduler.add(completeBeep, TASK_PRIORITY_NORMAL, buzzerTask_m);
+  displayTask =
+      scheduler.add(updateDisplay, TASK_PRIORITY_DISPLAY, displayTask_m);
+  storeTask = scheduler.add(commitStore, TASK_PRIORITY_NORMAL, storeTask_m);
+  serialTask = scheduler.add(pollSerial, TASK_PRIORITY_DISPLAY, serialTask_m);
+  logTask = scheduler.add(writeLog, TASK_PRIORITY_DISPLAY, logTask_m);
+  setSampling();
+  scheduler.start(serialTask, TELEMETRY_POLL, TELEMETRY_POLL);
+  scheduler.start(logTask, RUNLOG_WRITE_INTERVAL, RUNLOG_WRITE_INTERVAL);
+
+  // Start-up splash, the buzzer task beeps the second time and the display
+  // task takes over once it has been seen
+  hal::writeLed(true);
+  splashDisplay();
+  hal::tone(1800, 200);
+  scheduler.start(buzzerTask, SPLASH_BEEP);
+  scheduler.start(displayTask, SPLASH_TIME, UPDATE_RATE);
+
+  // A one-shot sensor has its first conversion in a CONVERSION_TIME, the
+  // sensor task takes it from there
+  if (!(hal::sensorFaults(0) & SENSOR_FAULT_NOT_READY))
+    firstReading();
+}
+
+void loop() {
+  // sensor read and PID step at the rates of the state (samplingRates),
+  // display update every UPDATE_RATE(100ms) and the reflow timers
+  TIMING_BEGIN(TIMING_LOOP);
+  // Collect finished conversions first, the sensor task reads the newest
+  hal::sensorPoll();
+  scheduler.run();
+  if (reflowState != sampledState)
+    setSampling();
+
+  TIMING_BEGIN(TIMING_BUTTONS);
+  buttons::update(hal::millis());
+  buttonEvent_t event;
+  while (buttons::next(&event))
+    handleButton(event);
+  TIMING_END(TIMING_BUTTONS);
+
+  // Reflow oven controller state machine
+  TIMING_BEGIN(TIMING_STATE);
+  switch (reflowState) {
+  case REFLOW_STATE_IDLE:
+    // If oven temperature is still above room temperature
+    if (plate.reading >= FIX16(TEMPERATURE_ROOM))
+      reflowState = REFLOW_STATE_TOO_HOT;
     break;
 
+  case REFLOW_STATE_PREHEAT:
+  case REFLOW_STATE_SOAK:
+  case REFLOW_STATE_REFLOW:
   case REFLOW_STATE_COOL:
-    // If minimum cool temperature is achieve
-    if (thermoReading <= TEMPERATURE_COOL_MIN) {
-      // Retrieve current time for buzzer usage
-      buzzerPeriod = millis() + 1000;
+    // The PID task moves through the profile segments
+    if (profile::done()) {
+      // Beep again in a second
+      scheduler.start(buzzerTask, 1000);
       // Turn on buzzer to indicate completion
-      digitalWrite(buzzerPin, HIGH);
-      digitalWrite(fanPin, HIGH);
+      hal::writeBuzzer(true);
+      hal::writeFan(true);
       // Turn off reflow process
       reflowStatus = REFLOW_STATUS_OFF;
+      runlog::end(REFLOW_FAULT_NONE, hal::millis());
       // Proceed to reflow Completion state
       reflowState = REFLOW_STATE_COMPLETE;
     }
     break;
 
-  case REFLOW_STATE_COMPLETE:
-    if (millis() > buzzerPeriod) {
-      tone(buzzerPin, 1800, 200);
-      // Reflow process ended
-      reflowState = REFLOW_STATE_TOO_HOT;
+  case REFLOW_STATE_AUTOTUNE:
+    if (autotune::status() == AUTOTUNE_DONE) {
+      // Written once the run is off, used from the next Start
+      autotune::save(store::schedule());
+      store::change(STORE_SCHEDULE);
+      if (autotune::identify(store::model()))
+        store::change(STORE_MODEL);
+      scheduler.start(storeTask, STORE_COMMIT_DELAY);
+      scheduler.start(buzzerTask, 1000);
+      hal::writeBuzzer(true);
+      hal::writeFan(true);
+      reflowStatus = REFLOW_STATUS_OFF;
+      reflowState = REFLOW_STATE_COMPLETE;
+    } else if (autotune::status() == AUTOTUNE_FAILED) {
+      reflowFault = REFLOW_FAULT_AUTOTUNE;
+      reflowState = REFLOW_STATE_ERROR;
     }
     break;
 
+  case REFLOW_STATE_COMPLETE:
+    // Buzzer task moves on to REFLOW_STATE_TOO_HOT
+    break;
+
   case REFLOW_STATE_TOO_HOT:
     // If oven temperature drops below room temperature
-    if (thermoReading < TEMPERATURE_ROOM) {
-      digitalWrite(fanPin, LOW);
+    if (plate.reading < FIX16(TEMPERATURE_ROOM)) {
+      hal::writeFan(false);
       reflowState = REFLOW_STATE_IDLE;
     }
     break;
 
   case REFLOW_STATE_ERROR:
     // ERROR
-    digitalWrite(fanPin, HIGH);
-    digitalWrite(ssrPin, LOW);
+    hal::writeFan(true);
+    heatersOff();
     reflowStatus = REFLOW_STATUS_OFF;
-    tone(buzzerPin, 1800, 200);
+    runlog::end(reflowFault, hal::millis());
+    hal::tone(1800, 200);
     break;
 
   default:
     break;
+  }
 
-    // PID computation and SSR control
-    if (reflowStatus == REFLOW_STATUS_ON) {
-
-      reflowOvenPID.Compute();
-
-      if ((millis() - windowStartTime) > windowSize) {
-        // Time to shift the Relay Window
-        windowStartTime += windowSize;
-      }
-      if (output > (millis() - windowStartTime))
-        digitalWrite(ssrPin, HIGH);
-      else
-        digitalWrite(ssrPin, LOW);
-    }
-    // Reflow oven process is off, ensure oven is off
-    else {
-      if (digitalRead(ssrPin) != LOW)
-        digitalWrite(ssrPin, LOW);
-    }
+  // Reflow oven process is off, ensure oven is off
+  if (reflowStatus != REFLOW_STATUS_ON) {
+    if (heatersOn())
+      heatersOff();
   }
+  TIMING_END(TIMING_STATE);
+  TIMING_END(TIMING_LOOP);
 }
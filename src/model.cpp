@@ -0,0 +1,44 @@
+/*
+ * First-order-plus-dead-time plate model
+ */
+#include "model.h"
+
+static fix16_t heating, loss; // See plantModel_t
+static uint8_t deadTime_;     // [s]
+static fix16_t ambient;
+
+namespace model {
+
+void begin(const plantModel_t &params, fix16_t reading) {
+  if (params.heating > 0) {
+    heating = params.heating;
+    loss = params.loss;
+    deadTime_ = params.deadTime;
+  } else {
+    heating = MODEL_HEATING;
+    loss = MODEL_LOSS;
+    deadTime_ = MODEL_DEAD_TIME;
+  }
+  if (deadTime_ >= MODEL_DELAY_MAX)
+    deadTime_ = MODEL_DELAY_MAX - 1;
+  ambient = reading < MODEL_AMBIENT_MAX ? reading : MODEL_AMBIENT;
+}
+
+fix16_t feedForward(fix16_t setpoint, fix16_t rate) {
+  fix16_t rise = rate + fix16Mul(loss, setpoint - ambient);
+  if (rise <= 0)
+    return 0;
+  if (rise >= heating)
+    return FIX16_ONE;
+  return ((int64_t)rise << 16) / heating;
+}
+
+fix16_t heatRate(fix16_t duty) { return fix16Mul(heating, duty); }
+
+fix16_t lossRate(fix16_t temperature) {
+  return fix16Mul(loss, temperature - ambient);
+}
+
+uint8_t deadTime() { return deadTime_; }
+
+} // namespace model
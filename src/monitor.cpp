@@ -0,0 +1,106 @@
+/*
+ * Plate and sensor fault monitor
+ */
+#include "monitor.h"
+
+enum { CHECK_SENSOR, CHECK_OVERTEMP, CHECK_HEATER, CHECK_STUCK_ON, CHECKS };
+
+// Running sums in fix16, wrapping; the history keeps them in 1/16 C, where
+// the difference over a window still fits 16 bits
+#define HISTORY_SHIFT 12
+
+static uint32_t lossSum;  // Model loss over all samples
+static uint32_t heatSum;  // Heater rise the duty asked for, over all samples
+static uint16_t taken[MONITOR_HISTORY]; // Reading plus lossSum
+static uint16_t given[MONITOR_HISTORY]; // heatSum
+static uint8_t head;       // Next entry, the newest is head - 1
+static uint8_t samples;    // In the history, up to MONITOR_HISTORY
+static uint8_t offSamples; // In a row with the SSR off, up to the same
+static bool first = true;
+static fix16_t last;
+static uint8_t persist[CHECKS]; // Failed samples in a row
+
+/* Entry of a history age samples ago */
+static uint16_t at(const uint16_t *history, uint8_t age) {
+  return history[(head + 2 * MONITOR_HISTORY - 1 - age) % MONITOR_HISTORY];
+}
+
+/*
+ * Count a failed sample; the count is only forgotten once the sample is past
+ * the clear threshold, in between it holds. True once it is confirmed.
+ */
+static bool confirm(uint8_t check, bool fail, bool clear) {
+  if (fail) {
+    if (persist[check] < MONITOR_CONFIRM)
+      persist[check]++;
+  } else if (clear) {
+    persist[check] = 0;
+  }
+  return persist[check] >= MONITOR_CONFIRM;
+}
+
+namespace monitor {
+
+reflowFault_t update(fix16_t reading, fix16_t duty, fix16_t estimate) {
+  // Unsigned, the step to or from a faulted sensor's FIX16_MIN overflows
+  uint32_t step = reading > last ? (uint32_t)reading - (uint32_t)last
+                                 : (uint32_t)last - (uint32_t)reading;
+  if (first)
+    step = 0;
+  first = false;
+  last = reading;
+  bool sensor = confirm(
+      CHECK_SENSOR,
+      reading <= MONITOR_SENSOR_MIN || reading >= MONITOR_SENSOR_MAX ||
+          step > (uint32_t)MONITOR_SENSOR_STEP,
+      reading >= MONITOR_SENSOR_MIN + MONITOR_HYSTERESIS &&
+          reading <= MONITOR_SENSOR_MAX - MONITOR_HYSTERESIS &&
+          step <= (uint32_t)MONITOR_SENSOR_STEP / 2);
+  if (persist[CHECK_SENSOR]) {
+    // Nothing the plate did, start the history over once it reads again
+    samples = 0;
+    return sensor ? REFLOW_FAULT_SENSOR : REFLOW_FAULT_NONE;
+  }
+  fix16_t hottest = estimate > reading ? estimate : reading;
+  bool overtemp =
+      confirm(CHECK_OVERTEMP, hottest >= MONITOR_TEMPERATURE_MAX,
+              hottest < MONITOR_TEMPERATURE_MAX - MONITOR_HYSTERESIS);
+
+  lossSum += model::lossRate(reading);
+  heatSum += model::heatRate(duty);
+  taken[head] = ((uint32_t)reading + lossSum) >> HISTORY_SHIFT;
+  given[head] = heatSum >> HISTORY_SHIFT;
+  head = (head + 1) % MONITOR_HISTORY;
+  if (samples < MONITOR_HISTORY)
+    samples++;
+  if (duty)
+    offSamples = 0;
+  else if (offSamples < MONITOR_HISTORY)
+    offSamples++;
+
+  bool heater = false, stuckOn = false;
+  if (samples == MONITOR_HISTORY) {
+    // Heat the plate took up over the window, and what the duty put in a dead
+    // time before it, against a full-on heater [1/16 C]
+    uint8_t delay = model::deadTime();
+    int16_t plate = at(taken, 0) - at(taken, MONITOR_WINDOW);
+    int16_t duties = at(given, delay) - at(given, delay + MONITOR_WINDOW);
+    int16_t full =
+        model::heatRate(FIX16_ONE) * MONITOR_WINDOW >> HISTORY_SHIFT;
+    heater = confirm(CHECK_HEATER, duties >= full / 4 && plate < duties / 4,
+                     duties < full / 8 || plate > duties / 2);
+    bool off = offSamples >= delay + MONITOR_WINDOW;
+    stuckOn = confirm(CHECK_STUCK_ON, off && plate > full / 2,
+                      !off || plate < full / 4);
+  }
+
+  if (overtemp)
+    return REFLOW_FAULT_OVERTEMP;
+  if (stuckOn)
+    return REFLOW_FAULT_STUCK_ON;
+  if (heater)
+    return REFLOW_FAULT_HEATER;
+  return REFLOW_FAULT_NONE;
+}
+
+} // namespace monitor
@@ -0,0 +1,178 @@
+/*
+ * button-check: button events against bouncing contacts
+ *
+ * Drives the simulated button pins through the pin change callback with
+ * contact bounce, a glitch, a long hold, an auto-repeating hold and two
+ * buttons at once, calls buttons::update() every millisecond like loop(),
+ * and checks that each press and release comes out exactly once, stamped
+ * at its first edge and delivered BUTTON_DEBOUNCE after the last bounce;
+ * that a glitch gives nothing; and how long a held Up takes to move the
+ * setpoint 30 C.
+ *
+ *   .pio/build/native/program button-check
+ */
+#include "buttons.h"
+#include "native/commands.h"
+#include "native/sim.h"
+#include <stdio.h>
+#include <vector>
+
+#define BOUNCE 3        // Edges each way, one a ms
+#define HOLD_STEPS 30   // Setpoint steps of the repeat test [C]
+#define HOLD_LIMIT 5000 // For HOLD_STEPS [ms]
+
+static int failures;
+
+struct Edge {
+  unsigned long at; // [ms]
+  button_t button;
+  bool down;
+};
+
+/*
+ * Runs the edges from a fresh start for duration ms; each event comes out
+ * twice, as stamped and with the time it was taken from the queue
+ */
+static std::vector<buttonEvent_t> run(const std::vector<Edge> &edges,
+                                      unsigned long duration) {
+  sim::reset(sim::defaultPlant(), 1);
+  buttons::begin();
+  std::vector<buttonEvent_t> events;
+  for (unsigned long t = 0; t < duration; t++) {
+    for (unsigned i = 0; i < edges.size(); i++)
+      if (edges[i].at == t)
+        sim::setButton(edges[i].button, edges[i].down);
+    buttons::update(hal::millis());
+    buttonEvent_t event;
+    while (buttons::next(&event)) {
+      buttonEvent_t delivered = event;
+      delivered.time = hal::millis();
+      events.push_back(event);
+      events.push_back(delivered);
+    }
+    sim::advance(1);
+  }
+  return events;
+}
+
+/* Press at, bouncing BOUNCE times, release after hold, bouncing too */
+static void bouncy(std::vector<Edge> &edges, button_t button, unsigned long at,
+                   unsigned long hold) {
+  for (int i = 0; i < 2 * BOUNCE - 1; i++)
+    edges.push_back({at + i, button, i % 2 == 0});
+  for (int i = 0; i < 2 * BOUNCE - 1; i++)
+    edges.push_back({at + hold + i, button, i % 2 != 0});
+}
+
+static void report(const char *name, bool ok, const char *detail) {
+  printf("  %-22s %-50s %s\n", name, detail, ok ? "ok" : "FAIL");
+  if (!ok)
+    failures++;
+}
+
+/* The run gave these event types, each once */
+static bool expect(const std::vector<buttonEvent_t> &events,
+                   const uint8_t *types, unsigned count) {
+  if (events.size() != 2 * count)
+    return false;
+  for (unsigned i = 0; i < count; i++)
+    if (events[2 * i].type != types[i])
+      return false;
+  return true;
+}
+
+int buttonCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  char detail[64];
+  printf("button-check: debounce %d ms, long press %d ms, repeat %d..%d ms\n",
+         BUTTON_DEBOUNCE, BUTTON_LONG_PRESS, BUTTON_REPEAT_START,
+         BUTTON_REPEAT_MIN);
+
+  {
+    std::vector<Edge> edges;
+    bouncy(edges, BUTTON_START, 100, 200);
+    std::vector<buttonEvent_t> e = run(edges, 600);
+    const uint8_t types[] = {BUTTON_EVENT_PRESS, BUTTON_EVENT_RELEASE};
+    bool ok = expect(e, types, 2);
+    unsigned long latency = ok ? e[1].time - (100 + 2 * BOUNCE - 2) : 0;
+    ok = ok && e[0].time == 100 && e[2].time == 300 &&
+         latency == BUTTON_DEBOUNCE;
+    snprintf(detail, sizeof(detail),
+             "%u events, stamped %u/%u ms, %lu ms after the bounce",
+             (unsigned)e.size() / 2, ok ? e[0].time : 0, ok ? e[2].time : 0,
+             latency);
+    report("bouncing press", ok, detail);
+  }
+  {
+    std::vector<Edge> edges = {{100, BUTTON_START, true},
+                               {102, BUTTON_START, false}};
+    std::vector<buttonEvent_t> e = run(edges, 300);
+    snprintf(detail, sizeof(detail), "%u events", (unsigned)e.size() / 2);
+    report("2 ms glitch", e.empty(), detail);
+  }
+  {
+    std::vector<Edge> edges;
+    bouncy(edges, BUTTON_PROFILE, 100, 1500);
+    std::vector<buttonEvent_t> e = run(edges, 2000);
+    const uint8_t types[] = {BUTTON_EVENT_PRESS, BUTTON_EVENT_LONG,
+                             BUTTON_EVENT_RELEASE};
+    bool ok = expect(e, types, 3) && e[2].time == 100 + BUTTON_LONG_PRESS;
+    snprintf(detail, sizeof(detail), "%u events, long press at %u ms",
+             (unsigned)e.size() / 2, e.size() > 2 ? e[2].time : 0);
+    report("long press", ok, detail);
+  }
+  {
+    std::vector<Edge> edges;
+    bouncy(edges, BUTTON_UP, 100, HOLD_LIMIT + 1000);
+    std::vector<buttonEvent_t> e = run(edges, HOLD_LIMIT + 2000);
+    unsigned steps = 0;
+    unsigned long stepsAt = 0, shortest = ~0UL, last = 0;
+    bool slower = false; // An interval longer than the one before
+    unsigned long previous = ~0UL;
+    for (unsigned i = 0; i < e.size(); i += 2) {
+      if (e[i].type != BUTTON_EVENT_PRESS && e[i].type != BUTTON_EVENT_REPEAT)
+        continue;
+      if (steps) {
+        unsigned long interval = e[i].time - last;
+        slower = slower || (steps > 1 && interval > previous);
+        if (steps > 1 && interval < shortest)
+          shortest = interval;
+        previous = interval;
+      }
+      last = e[i].time;
+      if (++steps == HOLD_STEPS)
+        stepsAt = e[i].time - 100;
+    }
+    bool ok = stepsAt && stepsAt <= HOLD_LIMIT && !slower &&
+              shortest >= BUTTON_REPEAT_MIN;
+    snprintf(detail, sizeof(detail), "%d C in %lu ms, fastest %lu ms",
+             HOLD_STEPS, stepsAt, shortest);
+    report("held Up", ok, detail);
+  }
+  {
+    std::vector<Edge> edges;
+    bouncy(edges, BUTTON_UP, 100, 200);
+    bouncy(edges, BUTTON_DOWN, 101, 300);
+    std::vector<buttonEvent_t> e = run(edges, 600);
+    bool ok = e.size() == 8;
+    for (unsigned i = 0; ok && i < 8; i += 2)
+      ok = (e[i].type == BUTTON_EVENT_PRESS) == (i < 4);
+    snprintf(detail, sizeof(detail), "%u events", (unsigned)e.size() / 2);
+    report("Up and Down together", ok, detail);
+  }
+  {
+    // One press after the other, as fast as the debounce allows
+    std::vector<Edge> edges;
+    for (int i = 0; i < 20; i++)
+      bouncy(edges, BUTTON_PROFILE, 100 + i * 60, 30);
+    std::vector<buttonEvent_t> e = run(edges, 1400);
+    bool ok = e.size() == 80 && !buttons::dropped();
+    snprintf(detail, sizeof(detail), "%u events, %u dropped",
+             (unsigned)e.size() / 2, buttons::dropped());
+    report("20 quick presses", ok, detail);
+  }
+
+  printf("button-check: %s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
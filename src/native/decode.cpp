@@ -0,0 +1,319 @@
+/*
+ * decode: telemetry capture to CSV
+ *
+ * Splits a capture of the serial port on the frame delimiters, undoes the
+ * COBS encoding, checks the CRC and prints one CSV row per sample, numbering
+ * the runs by their start frames. Bad frames and gaps in the sequence
+ * numbers (frames dropped on the controller or lost on the line) are counted
+ * on stderr. With --columns, each column also goes to a file of its own,
+ * prefix.<column>, one value per line, for tools that load columns.
+ *
+ * With --log it prints the run log sent on TELEMETRY_COMMAND_LOG instead:
+ * the run summaries, then the trace of the last run, both as CSV. With
+ * --timing it prints the loop() section timing sent on
+ * TELEMETRY_COMMAND_TIMING, a row per section with its histogram. The
+ * answers to uploads (program upload) are reported on stderr.
+ *
+ *   .pio/build/native/program decode [capture.bin] [--columns prefix]
+ *   .pio/build/native/program decode --log [capture.bin]
+ *   .pio/build/native/program decode --timing [capture.bin]
+ *
+ * Reads stdin without a file, so a port can be decoded live:
+ *
+ *   stty -F /dev/ttyUSB0 115200 raw && program decode < /dev/ttyUSB0
+ */
+#include "cobs.h"
+#include "crc16.h"
+#include "native/commands.h"
+#include "profile.h"
+#include "runlog.h"
+#include "telemetry.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COLUMNS 9
+
+static const char *columnNames[COLUMNS] = {
+    "run",    "time_ms", "state",    "setpoint", "reading",
+    "output", "duty",    "estimate", "rate"};
+
+static const char *stateNames[] = {"idle",    "preheat", "soak",
+                                   "reflow",  "cool",    "complete",
+                                   "too_hot", "error",   "autotune"};
+
+static const char *faultNames[] = {"none",     "aborted",  "sensor",
+                                   "heater",   "autotune", "stuck_on",
+                                   "overtemp", "reset"};
+
+static const char *sectionNames[] = {"loop",  "buttons", "sensor",
+                                     "pid",   "state",   "display"};
+
+#define NAME(names, i)                                                         \
+  ((i) < sizeof(names) / sizeof(names[0]) ? names[i] : "?")
+
+static uint16_t get16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+static uint32_t get32(const uint8_t *p) {
+  return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+struct decoder_t {
+  bool log;
+  bool timing;
+  FILE *columns[COLUMNS];
+  unsigned long frames, samples, bad, missed;
+  bool synced;
+  uint16_t expected; // Next sequence number
+  int run;
+  uint16_t window; // SSR window of the run [ms]
+  // Trace of the run log, put together from its frames
+  uint16_t traceRun;
+  uint8_t traceInterval;
+  bool traceTruncated;
+  int16_t traceFirst;
+  uint16_t traceLength;
+  uint16_t traceReceived;
+  uint8_t trace[RUNLOG_TRACE_BYTES];
+};
+
+static void summary(const uint8_t *p) {
+  uint8_t profile = p[2];
+  char name[3] = "?";
+  if (profile < builtinProfileCount)
+    profile::name(profile, name);
+  printf("%u,%s,%s,%.1f,%u,%.2f", get16(p), name, NAME(faultNames, p[3]),
+         (int16_t)get16(p + 4) / (double)RUNLOG_SUMMARY_SCALE, get16(p + 6),
+         (int16_t)get16(p + 8) / (double)RUNLOG_SUMMARY_SCALE);
+  for (int i = 0; i < RUNLOG_STAGES + 1; i++) // Stages and duration
+    printf(",%u", get16(p + 10 + 2 * i));
+  printf("\n");
+}
+
+static void traceChunk(decoder_t &d, const uint8_t *p, int length) {
+  uint16_t traceLength = get16(p + 6), offset = get16(p + 8);
+  if (offset == 0) {
+    d.traceRun = get16(p);
+    d.traceInterval = p[2];
+    d.traceTruncated = p[3];
+    d.traceFirst = get16(p + 4);
+    d.traceLength = traceLength;
+    d.traceReceived = 0;
+  }
+  if (offset != d.traceReceived || traceLength != d.traceLength ||
+      offset + length > (int)sizeof(d.trace))
+    return; // A chunk went missing, the trace stays short
+  memcpy(d.trace + offset, p + 10, length);
+  d.traceReceived += length;
+}
+
+/* Undo the zigzag varint deltas */
+static void printTrace(decoder_t &d) {
+  printf("\nrun,time_s,reading\n");
+  if (!d.traceReceived)
+    return;
+  int value = d.traceFirst;
+  unsigned long time = 0;
+  printf("%u,%lu,%.2f\n", d.traceRun, time, value / (double)RUNLOG_TRACE_SCALE);
+  uint16_t zigzag = 0;
+  int shift = 0;
+  for (uint16_t i = 0; i < d.traceReceived; i++) {
+    zigzag |= (uint16_t)(d.trace[i] & 0x7f) << shift;
+    shift += 7;
+    if (d.trace[i] & 0x80)
+      continue;
+    value += (int16_t)((zigzag >> 1) ^ -(zigzag & 1));
+    time += d.traceInterval;
+    printf("%u,%lu,%.2f\n", d.traceRun, time,
+           value / (double)RUNLOG_TRACE_SCALE);
+    zigzag = 0;
+    shift = 0;
+  }
+  if (d.traceReceived < d.traceLength)
+    fprintf(stderr, "decode: trace incomplete, %u of %u bytes\n",
+            d.traceReceived, d.traceLength);
+  if (d.traceTruncated)
+    fprintf(stderr, "decode: run outlasted the trace, its end is missing\n");
+}
+
+static void timingHeader() {
+  printf("section,count,min_us,mean_us,max_us");
+  for (int b = 0; b < TIMING_BUCKETS - 1; b++)
+    printf(",lt_%uus", 2u << b);
+  printf(",ge_%uus\n", 1u << (TIMING_BUCKETS - 1));
+}
+
+static void timingRow(const uint8_t *p) {
+  printf("%s,%u,%u,%u,%u", NAME(sectionNames, p[0]), get16(p + 1),
+         get16(p + 3), get16(p + 7), get16(p + 5));
+  for (int b = 0; b < TIMING_BUCKETS; b++)
+    printf(",%u", get16(p + 9 + 2 * b));
+  printf("\n");
+}
+
+static void row(decoder_t &d, const char *values[COLUMNS]) {
+  for (int c = 0; c < COLUMNS; c++) {
+    printf("%s%s", values[c], c + 1 < COLUMNS ? "," : "\n");
+    if (d.columns[c])
+      fprintf(d.columns[c], "%s\n", values[c]);
+  }
+}
+
+static void frame(decoder_t &d, const uint8_t *data, int length) {
+  uint8_t f[COBS_MAX_LENGTH];
+  int n = length <= COBS_ENCODED_LENGTH(COBS_MAX_LENGTH)
+              ? cobs::decode(data, length, f)
+              : -1;
+  if (n < TELEMETRY_HEADER + 2) {
+    d.bad++;
+    return;
+  }
+  uint16_t crc = CRC16_INIT;
+  for (int i = 0; i < n - 2; i++)
+    crc = crc16Update(crc, f[i]);
+  if (crc != get16(f + n - 2)) {
+    d.bad++;
+    return;
+  }
+
+  d.frames++;
+  uint16_t sequence = get16(f + 1);
+  if (d.synced && sequence != d.expected)
+    d.missed += (uint16_t)(sequence - d.expected);
+  d.synced = true;
+  d.expected = sequence + 1;
+  uint32_t time = get32(f + 3);
+  const uint8_t *payload = f + TELEMETRY_HEADER;
+  int payloadLength = n - 2 - TELEMETRY_HEADER;
+
+  if (f[0] == TELEMETRY_SUMMARY && payloadLength >= 20) {
+    if (d.log)
+      summary(payload);
+  } else if (f[0] == TELEMETRY_TIMING &&
+             payloadLength >= 9 + 2 * TIMING_BUCKETS) {
+    if (d.timing)
+      timingRow(payload);
+  } else if (f[0] == TELEMETRY_TRACE && payloadLength >= 10) {
+    traceChunk(d, payload, payloadLength - 10);
+  } else if (f[0] == TELEMETRY_ACK && payloadLength >= 2) {
+    fprintf(stderr, "upload %s: %s\n",
+            payload[0] == TELEMETRY_CALIBRATION ? "calibration"
+            : payload[0] == TELEMETRY_PROFILE   ? "profile"
+                                                : "?",
+            payload[1] ? "taken" : "refused");
+  } else if (f[0] == TELEMETRY_START && payloadLength >= 3) {
+    d.run++;
+    d.window = get16(payload + 1);
+  } else if (f[0] == TELEMETRY_SAMPLE && payloadLength >= 7) {
+    d.samples++;
+    if (d.log || d.timing)
+      return;
+    char text[COLUMNS][16];
+    snprintf(text[0], sizeof(text[0]), "%d", d.run);
+    snprintf(text[1], sizeof(text[1]), "%lu", (unsigned long)time);
+    uint8_t state = payload[6];
+    snprintf(text[2], sizeof(text[2]), "%s",
+             state < sizeof(stateNames) / sizeof(stateNames[0])
+                 ? stateNames[state]
+                 : "?");
+    snprintf(text[3], sizeof(text[3]), "%.3f",
+             (int16_t)get16(payload) / (double)TELEMETRY_SCALE);
+    snprintf(text[4], sizeof(text[4]), "%.3f",
+             (int16_t)get16(payload + 2) / (double)TELEMETRY_SCALE);
+    snprintf(text[5], sizeof(text[5]), "%u", get16(payload + 4));
+    snprintf(text[6], sizeof(text[6]), "%.3f",
+             d.window ? get16(payload + 4) / (double)d.window : 0.0);
+    // Left empty from firmware that sent no estimate
+    text[7][0] = text[8][0] = '\0';
+    if (payloadLength >= 11) {
+      snprintf(text[7], sizeof(text[7]), "%.3f",
+               (int16_t)get16(payload + 7) / (double)TELEMETRY_SCALE);
+      snprintf(text[8], sizeof(text[8]), "%.3f",
+               (int16_t)get16(payload + 9) / (double)TELEMETRY_SCALE);
+    }
+    const char *values[COLUMNS];
+    for (int c = 0; c < COLUMNS; c++)
+      values[c] = text[c];
+    row(d, values);
+  }
+}
+
+int decodeTelemetry(int argc, char **argv) {
+  const char *path = NULL, *prefix = NULL;
+  bool log = false, timing = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--log")) {
+      log = true;
+    } else if (!strcmp(argv[i], "--timing")) {
+      timing = true;
+    } else if (!strcmp(argv[i], "--columns") && i + 1 < argc) {
+      prefix = argv[++i];
+    } else if (!path && argv[i][0] != '-') {
+      path = argv[i];
+    } else {
+      fprintf(stderr, "usage: decode [--log|--timing] [capture.bin] "
+                      "[--columns prefix]\n");
+      return 2;
+    }
+  }
+
+  FILE *in = path ? fopen(path, "rb") : stdin;
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+  static decoder_t d;
+  memset(&d, 0, sizeof(d));
+  d.log = log;
+  d.timing = timing;
+  for (int c = 0; prefix && c < COLUMNS; c++) {
+    char name[256];
+    snprintf(name, sizeof(name), "%s.%s", prefix, columnNames[c]);
+    d.columns[c] = fopen(name, "w");
+    if (!d.columns[c]) {
+      perror(name);
+      return 1;
+    }
+  }
+  if (log)
+    printf("run,profile,fault,peak,above_liquidus_s,max_ramp_c_s,preheat_s,"
+           "soak_s,reflow_s,cool_s,duration_s\n");
+  else if (timing)
+    timingHeader();
+  else
+    row(d, columnNames);
+
+  // Bytes up to the first delimiter may be the tail of a frame: skip them
+  uint8_t buffer[COBS_ENCODED_LENGTH(COBS_MAX_LENGTH) + 1];
+  int length = 0;
+  bool aligned = false;
+  unsigned long bytes = 0;
+  int byte;
+  while ((byte = fgetc(in)) != EOF) {
+    bytes++;
+    if (byte == COBS_DELIMITER) {
+      if (aligned && length)
+        frame(d, buffer, length);
+      aligned = true;
+      length = 0;
+    } else if (length < (int)sizeof(buffer)) {
+      buffer[length++] = byte;
+    } else {
+      length = sizeof(buffer) + 1; // Too long, bad once delimited
+    }
+  }
+  if (path)
+    fclose(in);
+  if (log)
+    printTrace(d);
+  for (int c = 0; c < COLUMNS; c++)
+    if (d.columns[c])
+      fclose(d.columns[c]);
+
+  fprintf(stderr,
+          "decode: %lu bytes, %lu frames, %lu samples in %d runs, %lu bad "
+          "frames, %lu missed\n",
+          bytes, d.frames, d.samples, d.run, d.bad, d.missed);
+  return d.bad ? 1 : 0;
+}
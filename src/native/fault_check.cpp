@@ -0,0 +1,223 @@
+/*
+ * fault-check: fault monitor on simulated fault traces
+ *
+ * Runs the controller on the simulated plate, presses Start and breaks the
+ * sensor or the heater at a random time into the run (or while idle), then
+ * reports for each fault how often the monitor found it, whether it named
+ * the right one, and how long it took. The same plates run whole profiles
+ * without a fault to count false trips. The plates are the ones the
+ * simulator is usually compared on, from the stock plate to three times its
+ * power with twice the sensor lag, all with the default plate model.
+ *
+ * Each run forks, so every one starts from setup() with the controller's
+ * state as the firmware boots with it.
+ *
+ *   .pio/build/native/program fault-check
+ */
+#include "native/commands.h"
+#include "native/sim.h"
+#include "reflow.h"
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define CHECK_SEEDS 20         // Runs per fault and per plate
+#define CHECK_PRESS_AT 1000    // Start press after setup() [ms]
+#define CHECK_PRESS_LENGTH 100 // [ms]
+#define CHECK_ONSET_MIN 20     // Fault this long after Start at the earliest
+#define CHECK_ONSET_SPAN 180   // and this much later at the latest [s]
+#define CHECK_DURATION 1200    // Fault-free runs, profile and cooling [s]
+
+typedef struct CHECK_PLATE {
+  const char *name;
+  double power;    // [W]
+  double capacity; // [J/K]
+  double lag;      // [s]
+} checkPlate_t;
+
+static const checkPlate_t plates[] = {
+    {"stock", 400, 300, 4},        {"1200W", 1200, 300, 4},
+    {"1200W lag 8", 1200, 300, 8}, {"heavy", 600, 600, 4},
+    {"light", 700, 200, 4},        {"lag 8", 400, 300, 8},
+};
+#define PLATES (sizeof(plates) / sizeof(plates[0]))
+
+typedef struct CHECK_FAULT {
+  const char *name;
+  sim::Fault fault;
+  reflowFault_t expected;
+  bool run;              // Injected during a run, else while idle
+  unsigned long latency; // Longest time to find it that passes [s]
+} checkFault_t;
+
+static const checkFault_t faults[] = {
+    {"sensor open", sim::FAULT_SENSOR_OPEN, REFLOW_FAULT_SENSOR, true, 5},
+    {"sensor short", sim::FAULT_SENSOR_SHORT, REFLOW_FAULT_SENSOR, true, 5},
+    {"heater dead", sim::FAULT_HEATER_DEAD, REFLOW_FAULT_HEATER, true, 90},
+    {"SSR stuck on", sim::FAULT_HEATER_STUCK, REFLOW_FAULT_STUCK_ON, true,
+     240},
+    {"stuck, idle", sim::FAULT_HEATER_STUCK, REFLOW_FAULT_STUCK_ON, false,
+     60},
+};
+#define FAULTS (sizeof(faults) / sizeof(faults[0]))
+
+static const char *faultNames[] = {"none",     "aborted",  "sensor",
+                                   "heater",   "autotune", "stuck_on",
+                                   "overtemp", "reset"};
+
+typedef struct CHECK_RESULT {
+  reflowFault_t fault; // REFLOW_FAULT_NONE if the run went through
+  unsigned long after; // Fault injected to found, or run time [ms]
+  double peak;         // Plate until then [C]
+} checkResult_t;
+
+static uint32_t randomState = 7;
+
+static uint32_t random32() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+/* One run from boot, fault at onset s after Start (or setup()) */
+static checkResult_t simulate(const checkPlate_t &plate, uint32_t seed,
+                              sim::Fault fault, bool run,
+                              unsigned long onset) {
+  sim::PlantParams params = sim::defaultPlant();
+  params.heaterPower = plate.power;
+  params.heatCapacity = plate.capacity;
+  params.sensorLag = plate.lag;
+  sim::reset(params, seed);
+  setup();
+
+  unsigned long pressAt = hal::millis() + CHECK_PRESS_AT;
+  bool started = !run;           // Onset counts from Start or setup()
+  unsigned long from = hal::millis();
+  unsigned long injected = 0;
+  unsigned long end = hal::millis() + (onset + CHECK_DURATION) * 1000UL;
+  checkResult_t result = {REFLOW_FAULT_NONE, 0, 0};
+  while (hal::millis() < end) {
+    unsigned long now = hal::millis();
+    if (!started) {
+      if (reflowState != REFLOW_STATE_IDLE) {
+        started = true;
+        from = now;
+      }
+      sim::setButton(BUTTON_START, now >= pressAt &&
+                                       now < pressAt + CHECK_PRESS_LENGTH);
+    }
+    if (started && !injected && fault != sim::FAULT_NONE &&
+        now >= from + onset * 1000) {
+      sim::inject(fault);
+      injected = now;
+    }
+    loop();
+    if (sim::plant().plate() > result.peak)
+      result.peak = sim::plant().plate();
+    if (reflowState == REFLOW_STATE_ERROR) {
+      result.fault = reflowFault;
+      result.after = now - (injected ? injected : from);
+      break;
+    }
+    sim::advance(1);
+  }
+  if (result.fault == REFLOW_FAULT_NONE)
+    result.after = hal::millis() - from;
+  return result;
+}
+
+/* simulate() in a child process, the controller state dies with it */
+static checkResult_t isolated(const checkPlate_t &plate, uint32_t seed,
+                              sim::Fault fault, bool run,
+                              unsigned long onset) {
+  checkResult_t result = {REFLOW_FAULT_NONE, 0, 0};
+  int pipes[2];
+  fflush(stdout);
+  if (pipe(pipes))
+    return result;
+  pid_t child = fork();
+  if (child == 0) {
+    close(pipes[0]);
+    result = simulate(plate, seed, fault, run, onset);
+    _exit(write(pipes[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+  }
+  close(pipes[1]);
+  if (child < 0 || read(pipes[0], &result, sizeof(result)) != sizeof(result))
+    result.fault = REFLOW_FAULT_ABORTED; // Counts as wrong
+  close(pipes[0]);
+  if (child > 0)
+    waitpid(child, NULL, 0);
+  return result;
+}
+
+int faultCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  bool pass = true;
+
+  printf("fault-check: %u runs per fault over %u plates, onset %u..%u s\n",
+         (unsigned)CHECK_SEEDS, (unsigned)PLATES, CHECK_ONSET_MIN,
+         CHECK_ONSET_MIN + CHECK_ONSET_SPAN);
+  printf("  %-14s %5s %5s  %-26s %s\n", "fault", "found", "wrong",
+         "latency min/mean/max [s]", "plate max [C]");
+  for (uint8_t f = 0; f < FAULTS; f++) {
+    const checkFault_t &c = faults[f];
+    unsigned found = 0, wrong = 0;
+    unsigned long min = ~0UL, max = 0, sum = 0;
+    double peak = 0;
+    int wrongFault = -1;
+    for (uint32_t seed = 1; seed <= CHECK_SEEDS; seed++) {
+      unsigned long onset = CHECK_ONSET_MIN + random32() % CHECK_ONSET_SPAN;
+      checkResult_t r =
+          isolated(plates[seed % PLATES], seed, c.fault, c.run, onset);
+      if (r.fault != c.expected) {
+        wrong++;
+        wrongFault = r.fault;
+        continue;
+      }
+      found++;
+      sum += r.after;
+      if (r.peak > peak)
+        peak = r.peak;
+      if (r.after < min)
+        min = r.after;
+      if (r.after > max)
+        max = r.after;
+    }
+    bool ok = !wrong && max <= c.latency * 1000;
+    pass = pass && ok;
+    char latency[32];
+    snprintf(latency, sizeof(latency), "%.0f/%.1f/%.0f",
+             found ? min / 1000.0 : 0.0, found ? sum / 1000.0 / found : 0.0,
+             max / 1000.0);
+    printf("  %-14s %5u %5u  %-26s %-13.0f %s", c.name, found, wrong, latency,
+           peak, ok ? "ok" : "FAIL");
+    if (wrongFault >= 0)
+      printf(" (%s)", wrongFault < (int)(sizeof(faultNames) /
+                                         sizeof(faultNames[0]))
+                          ? faultNames[wrongFault]
+                          : "?");
+    printf("\n");
+  }
+
+  // Fault-free profiles and the cooling after them
+  unsigned trips = 0;
+  double hours = 0;
+  for (uint8_t p = 0; p < PLATES; p++) {
+    for (uint32_t seed = 1; seed <= CHECK_SEEDS; seed++) {
+      checkResult_t r = isolated(plates[p], seed, sim::FAULT_NONE, true, 0);
+      hours += r.after / 3600000.0;
+      if (r.fault != REFLOW_FAULT_NONE) {
+        trips++;
+        printf("  false trip: %s, seed %u, %s after %.0f s\n", plates[p].name,
+               seed, faultNames[r.fault], r.after / 1000.0);
+      }
+    }
+  }
+  pass = pass && !trips;
+  printf("  %-14s %5u runs, %.1f h, %u false trips\n", "no fault",
+         (unsigned)(PLATES * CHECK_SEEDS), hours, trips);
+  printf("fault-check: %s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
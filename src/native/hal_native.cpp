@@ -0,0 +1,285 @@
+/*
+ * Hardware abstraction layer - host build backed by the plant simulator
+ */
+#include "hal.h"
+#include "native/sim.h"
+#include "sensor.h"
+#include <chrono>
+
+#define EEPROM_SIZE 1024
+#define SERIAL_TX_SIZE 128 // As UART_TX_SIZE
+
+// One plate per control channel, the faults are the first one's
+static sim::Plant plantModel[CONTROL_CHANNELS] = {
+    sim::Plant(sim::defaultPlant()),
+#if CONTROL_CHANNELS > 1
+    sim::Plant(sim::defaultPlant()),
+#endif
+};
+static unsigned long clockMs;
+static double energy;
+
+static void (*timerCallback)();
+static unsigned int timerPeriod;
+
+// Mains behind the SSRs and the zero-cross detector
+static unsigned int mainsFreq;
+static unsigned long halfCycles; // Crossings since reset
+static void (*zeroCrossCallback)();
+
+static sim::Fault fault;
+
+/*
+ * The plate's sensor read through the driver base like the firmware's
+ * converters, a new sample every CONVERSION_TIME; an open sensor and a short
+ * come back as the fault bits a converter would set
+ */
+class SimSensor : public SensorDriver<SimSensor> {
+public:
+  static const unsigned int CONVERSION_TIME = 100;
+  static const bool FREE_RUNNING = true;
+
+  bool init(uint8_t channel) {
+    _channel = channel;
+    return true;
+  }
+  void convert() {}
+  sensorSample_t collect() {
+    // Noise goes on with the fault
+    sensorSample_t s = {fix16FromFloat(plantModel[_channel].read()),
+                        FIX16(25), 0};
+    if (_channel == 0 && fault == sim::FAULT_SENSOR_OPEN)
+      s.faults = SENSOR_FAULT_OPEN;
+    if (_channel == 0 && fault == sim::FAULT_SENSOR_SHORT)
+      s.faults = SENSOR_FAULT_SHORT_GND;
+    return s;
+  }
+
+private:
+  uint8_t _channel;
+};
+
+static SimSensor sensors[CONTROL_CHANNELS];
+
+static bool ssrLevel[CONTROL_CHANNELS];   // Pin
+static bool conducting[CONTROL_CHANNELS]; // Zero-cross SSR, since the crossing
+static bool fanLevel;
+static bool ledLevel;
+static bool buzzerLevel;
+
+static bool buttonDown[BUTTON_COUNT];
+static void (*buttonCallback)();
+
+static uint8_t eepromData[EEPROM_SIZE];
+static unsigned long eepromWriteCount[EEPROM_SIZE];
+static unsigned long eepromReadCount;
+static long eepromCut = -1; // Writes left before they are dropped
+
+static unsigned long serialBaud;
+static unsigned long serialQueued; // Bytes in the transmit buffer, x 10000
+static std::vector<uint8_t> serialData;
+static std::vector<uint8_t> serialInput;
+
+namespace sim {
+
+void reset(const PlantParams &params, uint32_t seed) {
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++) {
+    plantModel[c] = Plant(params, seed + c);
+    ssrLevel[c] = conducting[c] = false;
+  }
+  clockMs = 0;
+  energy = 0;
+  fault = FAULT_NONE;
+  timerCallback = NULL;
+  timerPeriod = 0;
+  mainsFreq = 50;
+  halfCycles = 0;
+  zeroCrossCallback = NULL;
+  fanLevel = ledLevel = buzzerLevel = false;
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++)
+    buttonDown[i] = false;
+  buttonCallback = NULL;
+  memset(eepromData, 0xff, sizeof(eepromData));
+  memset(eepromWriteCount, 0, sizeof(eepromWriteCount));
+  eepromReadCount = 0;
+  eepromCut = -1;
+  serialBaud = 0;
+  serialQueued = 0;
+  serialData.clear();
+  serialInput.clear();
+}
+
+void advance(unsigned long ms) {
+  const double dt = 0.001;
+  while (ms--) {
+    // A zero-cross SSR switches at the crossing to where its pin is then;
+    // the detector's pulse comes just before the crossing, in time for the
+    // half-cycle engines to set the pin
+    unsigned long crossing = (unsigned long long)clockMs * 2 * mainsFreq / 1000;
+    if (crossing != halfCycles) {
+      halfCycles = crossing;
+      if (zeroCrossCallback)
+        zeroCrossCallback();
+      for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+        conducting[c] = ssrLevel[c];
+    }
+    for (uint8_t c = 0; c < CONTROL_CHANNELS; c++) {
+      bool on = mainsFreq ? conducting[c] : ssrLevel[c];
+      bool heating = c ? on
+                       : fault == FAULT_HEATER_STUCK ||
+                             (on && fault != FAULT_HEATER_DEAD);
+      plantModel[c].step(dt, heating ? 1.0 : 0.0);
+      if (heating)
+        energy += plantModel[c].params().heaterPower * dt;
+    }
+    clockMs++;
+    // The line drains baud / 10 bytes a second
+    serialQueued = serialQueued > serialBaud ? serialQueued - serialBaud : 0;
+    if (timerPeriod && (clockMs % timerPeriod) == 0)
+      timerCallback();
+  }
+}
+
+void inject(Fault f) { fault = f; }
+
+void setMains(unsigned int hertz) { mainsFreq = hertz; }
+
+// A level change is a pin change interrupt, taken at once
+void setButton(button_t button, bool pressed) {
+  bool changed = buttonDown[button] != pressed;
+  buttonDown[button] = pressed;
+  if (changed && buttonCallback)
+    buttonCallback();
+}
+
+Plant &plant(uint8_t channel) { return plantModel[channel]; }
+bool ssr(uint8_t channel) {
+  return mainsFreq ? conducting[channel] : ssrLevel[channel];
+}
+bool fan() { return fanLevel; }
+bool buzzer() { return buzzerLevel; }
+double heaterEnergy() { return energy; }
+uint8_t *eeprom() { return eepromData; }
+void eepromCutAfter(long count) { eepromCut = count; }
+unsigned long eepromWrites(int address) { return eepromWriteCount[address]; }
+unsigned long eepromReads() { return eepromReadCount; }
+const std::vector<uint8_t> &serial() { return serialData; }
+void serialSend(uint8_t data) { serialInput.push_back(data); }
+
+} // namespace sim
+
+namespace hal {
+
+void begin() {}
+
+unsigned long millis() { return clockMs; }
+
+// The host's own clock: code takes no virtual time to run
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void delay(unsigned long ms) { sim::advance(ms); }
+
+void timerBegin(unsigned int periodMs, void (*callback)()) {
+  timerCallback = callback;
+  timerPeriod = periodMs;
+}
+
+void zeroCrossBegin(void (*callback)()) { zeroCrossCallback = callback; }
+
+void writeSsr(uint8_t channel, bool on) { ssrLevel[channel] = on; }
+
+bool readSsr(uint8_t channel) { return ssrLevel[channel]; }
+
+void writeFan(bool on) { fanLevel = on; }
+
+void writeLed(bool on) { ledLevel = on; }
+
+void writeBuzzer(bool on) { buzzerLevel = on; }
+
+void tone(unsigned int frequency, unsigned long duration) {
+  (void)frequency;
+  (void)duration;
+}
+
+bool sensorBegin() {
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+    sensors[c].begin(c, clockMs);
+  return true;
+}
+
+void sensorPoll() {
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+    sensors[c].poll(clockMs);
+}
+
+unsigned int sensorInterval() { return SimSensor::CONVERSION_TIME; }
+
+fix16_t readTemperature(uint8_t channel) {
+  const sensorSample_t &sample = sensors[channel].sample();
+  return sample.faults ? FIX16_MIN : sample.temperature;
+}
+
+// The simulated sensor has no mains pickup to filter
+void sensorMains(uint8_t hertz) { (void)hertz; }
+
+uint8_t sensorFaults(uint8_t channel) {
+  return sensors[channel].sample().faults;
+}
+
+fix16_t coldJunction(uint8_t channel) {
+  return sensors[channel].sample().coldJunction;
+}
+
+uint8_t eepromRead(int address) {
+  eepromReadCount++;
+  return eepromData[address];
+}
+
+void eepromWrite(int address, uint8_t value) {
+  if (eepromCut == 0)
+    return;
+  if (eepromCut > 0)
+    eepromCut--;
+  eepromWriteCount[address]++;
+  eepromData[address] = value;
+}
+
+void serialBegin(unsigned long baud) { serialBaud = baud; }
+
+uint8_t serialRoom() {
+  return SERIAL_TX_SIZE - 1 - (serialQueued + 9999) / 10000;
+}
+
+void serialWrite(const uint8_t *data, uint8_t length) {
+  serialData.insert(serialData.end(), data, data + length);
+  serialQueued += length * 10000UL;
+}
+
+int serialRead() {
+  if (serialInput.empty())
+    return -1;
+  uint8_t data = serialInput.front();
+  serialInput.erase(serialInput.begin());
+  return data;
+}
+
+uint8_t buttonLevels() {
+  uint8_t levels = 0;
+  for (uint8_t b = 0; b < BUTTON_COUNT; b++)
+    if (buttonDown[b])
+      levels |= 1 << b;
+  return levels;
+}
+
+void buttonsBegin(void (*callback)()) { buttonCallback = callback; }
+
+// Callbacks only run between loop() passes here
+void interruptsOff() {}
+
+void interruptsOn() {}
+
+} // namespace hal
@@ -0,0 +1,119 @@
+/*
+ * ntc-check: thermistor table against the Beta equation
+ *
+ * Walks every 13-bit ADC code and compares the table interpolation of
+ * ntc::temperature() with the equation evaluated in double, failing if they
+ * differ by more than NTC_CHECK_TOLERANCE between NTC_CHECK_LOW and
+ * NTC_CHECK_HIGH. It then feeds a noisy 10-bit converter through the same
+ * oversampling as src/avr/adc.cpp and reports the spread of the readings
+ * against single conversions.
+ *
+ *   .pio/build/native/program ntc-check
+ */
+#include "native/commands.h"
+#include "ntc.h"
+#include <math.h>
+#include <stdio.h>
+
+#define NTC_CHECK_TOLERANCE 0.25 // [C]
+#define NTC_CHECK_LOW 20.0       // [C]
+#define NTC_CHECK_HIGH 300.0     // [C]
+#define NOISE_LSB 0.7            // Converter noise, RMS [LSB]
+#define NOISE_READINGS 2000
+#define OVERSAMPLE 64     // As ADC_OVERSAMPLE
+#define OVERSAMPLE_BITS 3 // As ADC_OVERSAMPLE_BITS
+#define BLOCKS 16         // As ADC_BLOCKS
+
+static double equation(double adc) {
+  double r = NTC_PULLUP * adc / (NTC_ADC_MAX - adc);
+  return 1 / (1 / (NTC_T0 + 273.15) + log(r / NTC_R0) / NTC_BETA) - 273.15;
+}
+
+static uint32_t noiseState = 7;
+
+static double gaussian() {
+  double u[2];
+  for (int i = 0; i < 2; i++) {
+    noiseState ^= noiseState << 13;
+    noiseState ^= noiseState >> 17;
+    noiseState ^= noiseState << 5;
+    u[i] = (noiseState + 1.0) / 4294967297.0;
+  }
+  return sqrt(-2 * log(u[0])) * cos(2 * M_PI * u[1]);
+}
+
+static int convert(double code) {
+  int c = (int)floor(code + NOISE_LSB * gaussian() + 0.5);
+  return c < 0 ? 0 : c > 1023 ? 1023 : c;
+}
+
+/* Spread of readings at temperature t, single conversions or oversampled */
+static void spread(double t, double *single, double *oversampled) {
+  // ADC code of t by bisection on the equation, which falls with the code
+  double lo = 1, hi = NTC_ADC_MAX - 1;
+  for (int i = 0; i < 60; i++) {
+    double mid = (lo + hi) / 2;
+    if (equation(mid) > t)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  double code = lo / (1 << OVERSAMPLE_BITS); // 10-bit
+
+  double sum1 = 0, sum2 = 0, over1 = 0, over2 = 0;
+  for (int n = 0; n < NOISE_READINGS; n++) {
+    double a = equation(convert(code) << OVERSAMPLE_BITS) - t;
+    sum1 += a;
+    sum2 += a * a;
+
+    uint32_t blocks = 0;
+    for (int b = 0; b < BLOCKS; b++) {
+      uint16_t accumulator = 0;
+      for (int s = 0; s < OVERSAMPLE; s++)
+        accumulator += convert(code);
+      blocks += accumulator >> OVERSAMPLE_BITS;
+    }
+    double o = fix16ToFloat(ntc::temperature((blocks + BLOCKS / 2) / BLOCKS)) -
+               t;
+    over1 += o;
+    over2 += o * o;
+  }
+  *single = sqrt(sum2 / NOISE_READINGS -
+                 (sum1 / NOISE_READINGS) * (sum1 / NOISE_READINGS));
+  *oversampled = sqrt(over2 / NOISE_READINGS -
+                      (over1 / NOISE_READINGS) * (over1 / NOISE_READINGS));
+}
+
+int ntcCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+
+  double worst = 0, worstAt = 0;
+  for (int adc = 1; adc < NTC_ADC_MAX - 1; adc++) {
+    double exact = equation(adc);
+    if (exact < NTC_CHECK_LOW || exact > NTC_CHECK_HIGH)
+      continue;
+    double error = fabs(fix16ToFloat(ntc::temperature(adc)) - exact);
+    if (error > worst) {
+      worst = error;
+      worstAt = exact;
+    }
+  }
+  bool pass = worst <= NTC_CHECK_TOLERANCE;
+
+  printf("ntc-check: %d-point table, %d-bit input\n", NTC_TABLE_SIZE,
+         NTC_ADC_BITS);
+  printf("max table error %.3f C at %.1f C, tolerance %.2f C between %.0f "
+         "and %.0f C: %s\n",
+         worst, worstAt, NTC_CHECK_TOLERANCE, NTC_CHECK_LOW, NTC_CHECK_HIGH,
+         pass ? "PASS" : "FAIL");
+  printf("reading spread with %.1f LSB RMS converter noise:\n", NOISE_LSB);
+  printf("%10s %16s %16s\n", "T [C]", "single [C RMS]", "oversampled");
+  const double points[] = {25, 100, 150, 200, 250};
+  for (unsigned i = 0; i < sizeof(points) / sizeof(points[0]); i++) {
+    double single, oversampled;
+    spread(points[i], &single, &oversampled);
+    printf("%10.0f %16.3f %16.3f\n", points[i], single, oversampled);
+  }
+  return pass ? 0 : 1;
+}
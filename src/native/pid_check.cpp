@@ -0,0 +1,145 @@
+/*
+ * pid-check: FixedPID against the PID_v1 double controller it replaces
+ *
+ * Each controller drives its own copy of the simulated plate through the same
+ * lead-free stage timeline (preheat, stepped soak, reflow, cool) with the
+ * stage gains switched at the same moments. The check passes when the plate
+ * temperatures of the two runs stay within PID_CHECK_TOLERANCE with the
+ * derivative filter off; the filtered run is reported for information.
+ *
+ * The arithmetic alone agrees to a few thousandths of a degree. What is left
+ * comes from FixedPID holding its integrator during the saturated preheat
+ * ramp, where PID_v1 winds up, and from the bumpless gain switches.
+ *
+ *   .pio/build/native/program pid-check
+ */
+#include "fixpid.h"
+#include "native/commands.h"
+#include "native/sim.h"
+#include <PID_v1.h>
+#include <math.h>
+
+#define PID_CHECK_TOLERANCE 2.0 // Max plate temperature difference [C]
+#define CHECK_SAMPLE_TIME 1000  // [ms]
+#define CHECK_OUTPUT_MAX 2000   // SSR window [ms]
+#define CHECK_DURATION 420      // [s]
+#define CHECK_FILTER_TIME 2000  // Derivative filter of the second run [ms]
+
+typedef struct CHECK_STAGE {
+  unsigned int start; // [s]
+  double kp;
+  double ki;
+  double kd;
+} checkStage_t;
+
+/* Fixed gains by stage, local to the check: preheat, soak, reflow, cool.
+   Switched in steps, harder on SetTunings() than the firmware's schedule */
+static const checkStage_t stages[] = {
+    {0, 100, 0.025, 20},
+    {120, 300, 0.05, 250},
+    {210, 300, 0.05, 350},
+    {300, 300, 0.05, 350},
+};
+#define STAGE_COUNT (sizeof(stages) / sizeof(stages[0]))
+
+static double setpointAt(unsigned int t) {
+  if (t < 120)
+    return 150;
+  if (t < 210)
+    return 155 + 5 * ((t - 120) / 9 < 9 ? (t - 120) / 9 : 9);
+  if (t < 300)
+    return 250;
+  return 100;
+}
+
+typedef struct CHECK_RESULT {
+  double maxPlate; // Max plate temperature difference [C]
+  double maxOut;   // Max output difference [% of range]
+  double rmsOut;   // RMS output difference [% of range]
+} checkResult_t;
+
+static checkResult_t compare(unsigned int filterTime) {
+  sim::PlantParams params = sim::defaultPlant();
+  sim::reset(params);
+  sim::Plant floatPlant(params, 7);
+  sim::Plant fixedPlant(params, 7);
+
+  double dInput = floatPlant.read(), dOutput = 0, dSetpoint = setpointAt(0);
+  fix16_t fInput = fix16FromFloat(fixedPlant.read()), fOutput = 0,
+          fSetpoint = fix16FromFloat(dSetpoint);
+
+  PID floatPid(&dInput, &dOutput, &dSetpoint, stages[0].kp, stages[0].ki,
+               stages[0].kd, DIRECT);
+  FixedPID fixedPid(&fInput, &fOutput, &fSetpoint, FIX16(stages[0].kp),
+                    FIX16(stages[0].ki), FIX16(stages[0].kd));
+  floatPid.SetOutputLimits(0, CHECK_OUTPUT_MAX);
+  floatPid.SetSampleTime(CHECK_SAMPLE_TIME);
+  floatPid.SetMode(AUTOMATIC);
+  fixedPid.SetOutputLimits(0, fix16FromInt(CHECK_OUTPUT_MAX));
+  fixedPid.SetSampleTime(CHECK_SAMPLE_TIME);
+  fixedPid.SetDerivativeFilter(filterTime);
+  fixedPid.SetMode(AUTOMATIC);
+
+  checkResult_t result = {0, 0, 0};
+  double sumSquares = 0;
+  unsigned int stage = 0;
+  unsigned int steps = CHECK_DURATION * 1000 / CHECK_SAMPLE_TIME;
+
+  for (unsigned int k = 0; k < steps; k++) {
+    unsigned int t = k * CHECK_SAMPLE_TIME / 1000;
+    if (stage + 1 < STAGE_COUNT && t >= stages[stage + 1].start) {
+      stage++;
+      floatPid.SetTunings(stages[stage].kp, stages[stage].ki,
+                          stages[stage].kd);
+      fixedPid.SetTunings(FIX16(stages[stage].kp), FIX16(stages[stage].ki),
+                          FIX16(stages[stage].kd));
+    }
+    dSetpoint = setpointAt(t);
+    fSetpoint = fix16FromFloat(dSetpoint);
+    dInput = floatPlant.read();
+    fInput = fix16FromFloat(fixedPlant.read());
+
+    // PID_v1 times itself from millis()
+    sim::advance(CHECK_SAMPLE_TIME);
+    floatPid.Compute();
+    fixedPid.Compute();
+
+    double diff = 100.0 * fabs(dOutput - fix16ToFloat(fOutput)) /
+                  CHECK_OUTPUT_MAX;
+    sumSquares += diff * diff;
+    if (diff > result.maxOut)
+      result.maxOut = diff;
+
+    for (unsigned int ms = 0; ms < CHECK_SAMPLE_TIME; ms++) {
+      floatPlant.step(0.001, dOutput / CHECK_OUTPUT_MAX);
+      fixedPlant.step(0.001, fix16ToFloat(fOutput) / CHECK_OUTPUT_MAX);
+    }
+    double plate = fabs(floatPlant.plate() - fixedPlant.plate());
+    if (plate > result.maxPlate)
+      result.maxPlate = plate;
+  }
+  result.rmsOut = sqrt(sumSquares / steps);
+  return result;
+}
+
+int pidCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+
+  checkResult_t plain = compare(0);
+  checkResult_t filtered = compare(CHECK_FILTER_TIME);
+  bool pass = plain.maxPlate <= PID_CHECK_TOLERANCE;
+
+  printf("pid-check: FixedPID vs PID_v1, lead-free stage timeline, %d s\n",
+         CHECK_DURATION);
+  printf("%-26s %12s %14s %14s\n", "", "max|dT| [C]", "max|dOut| [%]",
+         "rms|dOut| [%]");
+  printf("%-26s %12.3f %14.2f %14.2f\n", "derivative filter off",
+         plain.maxPlate, plain.maxOut, plain.rmsOut);
+  printf("%-19s %4d ms %12.3f %14.2f %14.2f\n", "derivative filter",
+         CHECK_FILTER_TIME, filtered.maxPlate, filtered.maxOut,
+         filtered.rmsOut);
+  printf("tolerance: %.2f C on the unfiltered plate temperature: %s\n",
+         PID_CHECK_TOLERANCE, pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
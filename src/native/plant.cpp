@@ -0,0 +1,53 @@
+/*
+ * Thermal plant simulator
+ */
+#include "native/plant.h"
+#include <math.h>
+
+namespace sim {
+
+static const double KELVIN = 273.15;
+
+PlantParams defaultPlant() {
+  PlantParams p;
+  p.ambient = 25.0;
+  p.heatCapacity = 300.0;
+  p.heaterPower = 400.0;
+  p.lossCoefficient = 1.0;
+  p.radiativeLoss = 3.4e-10;
+  p.sensorLag = 4.0;
+  p.sensorNoise = 0.3;
+  return p;
+}
+
+Plant::Plant(const PlantParams &params, uint32_t seed)
+    : _params(params), _plate(params.ambient), _sensor(params.ambient),
+      _rng(seed ? seed : 1) {}
+
+void Plant::step(double dt, double heater) {
+  double t = _plate + KELVIN;
+  double a = _params.ambient + KELVIN;
+  double loss = _params.lossCoefficient * (_plate - _params.ambient) +
+                _params.radiativeLoss * (t * t * t * t - a * a * a * a);
+  _plate += dt * (heater * _params.heaterPower - loss) / _params.heatCapacity;
+  if (_params.sensorLag > 0)
+    _sensor += dt * (_plate - _sensor) / _params.sensorLag;
+  else
+    _sensor = _plate;
+}
+
+double Plant::read() { return _sensor + _params.sensorNoise * gaussian(); }
+
+/* Box-Muller over a xorshift32 generator, reproducible for a given seed */
+double Plant::gaussian() {
+  double u[2];
+  for (uint8_t i = 0; i < 2; i++) {
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    u[i] = (_rng + 1.0) / 4294967297.0;
+  }
+  return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+} // namespace sim
@@ -0,0 +1,201 @@
+/*
+ * sensor-check: sensor drivers against their datasheets
+ *
+ * Decodes the example words of the MAX31855, MAX6675 and MAX31856 datasheet
+ * tables (thermocouple and cold junction, fault bits, a missing device) and
+ * the thermistor's open and short thresholds, then runs a one-shot and a
+ * free-running driver through SensorDriver on the simulator clock and checks
+ * that poll() collects each conversion once it is due and never before.
+ *
+ *   .pio/build/native/program sensor-check
+ */
+#include "native/commands.h"
+#include "native/sim.h"
+#include "ntc.h"
+#include "sensor.h"
+#include <math.h>
+#include <stdio.h>
+
+#define POLL_STEP 7 // [ms], the loop() passes of the driver test
+
+static int failures;
+
+static void expect(const char *device, const char *what, sensorSample_t s,
+                   double temperature, double coldJunction, uint8_t faults) {
+  bool ok = s.faults == faults;
+  if (!faults)
+    ok = ok && fix16ToFloat(s.temperature) == temperature;
+  if (coldJunction != coldJunction) // NaN: not reported
+    ok = ok && s.coldJunction == SENSOR_NO_COLD_JUNCTION;
+  else
+    ok = ok && fix16ToFloat(s.coldJunction) == coldJunction;
+  if (!ok) {
+    printf("  %-10s %-24s got %.4f C, cold junction %.4f C, faults 0x%02x\n",
+           device, what, fix16ToFloat(s.temperature),
+           fix16ToFloat(s.coldJunction), s.faults);
+    failures++;
+  }
+}
+
+static void max31855() {
+  const struct {
+    uint32_t word;
+    double temperature;
+  } table[] = {{0x64000000, 1600},    {0x3e800000, 1000}, {0x064c0000, 100.75},
+               {0x01900000, 25},      {0x00000000, 0},    {0xfffc0000, -0.25},
+               {0xfff00000, -1},      {0xf0600000, -250}};
+  for (unsigned i = 0; i < sizeof(table) / sizeof(table[0]); i++)
+    expect("MAX31855", "thermocouple", sensor::decodeMax31855(table[i].word),
+           table[i].temperature, 0, 0);
+  const struct {
+    uint16_t bits;
+    double temperature;
+  } junction[] = {{0x7f00, 127}, {0x6400, 100}, {0x1900, 25},
+                  {0xfff0, -0.0625}, {0xc900, -55}};
+  for (unsigned i = 0; i < sizeof(junction) / sizeof(junction[0]); i++)
+    expect("MAX31855", "cold junction",
+           sensor::decodeMax31855(0x01900000 | junction[i].bits), 25,
+           junction[i].temperature, 0);
+  expect("MAX31855", "open", sensor::decodeMax31855(0x00011901), 0, 25,
+         SENSOR_FAULT_OPEN);
+  expect("MAX31855", "short to GND", sensor::decodeMax31855(0x00011902), 0,
+         25, SENSOR_FAULT_SHORT_GND);
+  expect("MAX31855", "short to VCC", sensor::decodeMax31855(0x00011904), 0,
+         25, SENSOR_FAULT_SHORT_VCC);
+  expect("MAX31855", "no device", sensor::decodeMax31855(0xffffffff), 0, NAN,
+         SENSOR_FAULT_NO_DEVICE);
+}
+
+static void max6675() {
+  expect("MAX6675", "1023.75 C", sensor::decodeMax6675(0x7ff8), 1023.75, NAN,
+         0);
+  expect("MAX6675", "100 C", sensor::decodeMax6675(0x0c80), 100, NAN, 0);
+  expect("MAX6675", "0 C", sensor::decodeMax6675(0x0000), 0, NAN, 0);
+  expect("MAX6675", "open", sensor::decodeMax6675(0x0c84), 0, NAN,
+         SENSOR_FAULT_OPEN);
+  expect("MAX6675", "no device", sensor::decodeMax6675(0xffff), 0, NAN,
+         SENSOR_FAULT_NO_DEVICE);
+}
+
+static sensorSample_t max31856(uint16_t junction, uint32_t thermocouple,
+                               uint8_t status) {
+  const uint8_t registers[6] = {
+      (uint8_t)(junction >> 8),      (uint8_t)junction,
+      (uint8_t)(thermocouple >> 16), (uint8_t)(thermocouple >> 8),
+      (uint8_t)thermocouple,         status};
+  return sensor::decodeMax31856(registers);
+}
+
+static void max31856() {
+  const struct {
+    uint32_t word;
+    double temperature;
+  } table[] = {{0x640000, 1600}, {0x3e8000, 1000}, {0x064800, 100.5},
+               {0x019000, 25},   {0x000000, 0},    {0xffffe0, -0.0078125},
+               {0xfff000, -1},   {0xf38000, -200}, {0xf06000, -250}};
+  for (unsigned i = 0; i < sizeof(table) / sizeof(table[0]); i++)
+    expect("MAX31856", "thermocouple", max31856(0x1900, table[i].word, 0),
+           table[i].temperature, 25, 0);
+  const struct {
+    uint16_t bits;
+    double temperature;
+  } junction[] = {{0x7ffc, 127.984375}, {0x1900, 25}, {0x0000, 0},
+                  {0xfffc, -0.015625},  {0xc900, -55}};
+  for (unsigned i = 0; i < sizeof(junction) / sizeof(junction[0]); i++)
+    expect("MAX31856", "cold junction", max31856(junction[i].bits, 0x019000, 0),
+           25, junction[i].temperature, 0);
+  // The unused low bits of LTCBL do not count
+  expect("MAX31856", "low bits", max31856(0x1900, 0x01901f, 0), 25, 25, 0);
+  expect("MAX31856", "open", max31856(0x1900, 0x019000, 0x01), 0, 25,
+         SENSOR_FAULT_OPEN);
+  expect("MAX31856", "over or under voltage", max31856(0x1900, 0, 0x02), 0, 25,
+         SENSOR_FAULT_SHORT_GND | SENSOR_FAULT_SHORT_VCC);
+  expect("MAX31856", "range", max31856(0x1900, 0, 0x40), 0, 25,
+         SENSOR_FAULT_RANGE);
+  expect("MAX31856", "cold junction range", max31856(0x1900, 0, 0x80), 0, 25,
+         SENSOR_FAULT_RANGE);
+}
+
+static void thermistor() {
+  uint16_t open = ntc::adcCode(NTC_OPEN), shorted = ntc::adcCode(NTC_SHORT);
+  expect("thermistor", "open", sensor::decodeThermistor(open), 0, NAN,
+         SENSOR_FAULT_OPEN);
+  expect("thermistor", "short to GND", sensor::decodeThermistor(shorted), 0,
+         NAN, SENSOR_FAULT_SHORT_GND);
+  // Just inside both thresholds the table reading stands
+  expect("thermistor", "inside open", sensor::decodeThermistor(open - 1),
+         fix16ToFloat(ntc::temperature(open - 1)), NAN, 0);
+  expect("thermistor", "inside short", sensor::decodeThermistor(shorted + 1),
+         fix16ToFloat(ntc::temperature(shorted + 1)), NAN, 0);
+  printf("  thermistor open at ADC %u and over, short at %u and under\n",
+         open, shorted);
+}
+
+/* Records when each conversion was started and collected */
+template <bool Free, unsigned int Time>
+class Recorder : public SensorDriver<Recorder<Free, Time> > {
+public:
+  static const unsigned int CONVERSION_TIME = Time;
+  static const bool FREE_RUNNING = Free;
+
+  bool init(uint8_t pin) {
+    (void)pin;
+    started = collected = 0;
+    early = 0;
+    return true;
+  }
+  void convert() {
+    startedAt = hal::millis();
+    started++;
+  }
+  sensorSample_t collect() {
+    // A free-running device has a result whenever it is read
+    if (started && hal::millis() - startedAt < CONVERSION_TIME)
+      early++;
+    collected++;
+    sensorSample_t s = {fix16FromInt(collected), SENSOR_NO_COLD_JUNCTION, 0};
+    return s;
+  }
+
+  unsigned long startedAt;
+  unsigned int started, collected, early;
+};
+
+template <bool Free, unsigned int Time>
+static void schedule(const char *name, unsigned long duration) {
+  sim::reset(sim::defaultPlant(), 1);
+  Recorder<Free, Time> driver;
+  driver.begin(0, hal::millis());
+  unsigned long boot = hal::millis();
+  while (hal::millis() < boot + duration) {
+    driver.poll(hal::millis());
+    sim::advance(POLL_STEP);
+  }
+  // One conversion a CONVERSION_TIME, late by at most a poll step each
+  unsigned int expected = duration / (Time + POLL_STEP);
+  bool ok = !driver.early && driver.collected >= expected &&
+            driver.collected <= duration / Time + 1 &&
+            fix16ToInt(driver.sample().temperature) == (int)driver.collected;
+  printf("  %-12s boot %4lu ms, %u conversions in %lu ms, %u collected "
+         "early: %s\n",
+         name, boot, driver.collected, duration, driver.early,
+         ok ? "ok" : "FAIL");
+  if (!ok)
+    failures++;
+}
+
+int sensorCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+
+  printf("sensor-check: datasheet words\n");
+  max31855();
+  max6675();
+  max31856();
+  thermistor();
+  printf("driver schedule, polled every %d ms:\n", POLL_STEP);
+  schedule<false, 200>("one-shot", 10000);
+  schedule<true, 100>("free-running", 10000);
+  printf("sensor-check: %s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
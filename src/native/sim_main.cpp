@@ -0,0 +1,502 @@
+/*
+ * Host simulator entry point ([env:native])
+ *
+ * Runs the controller's setup()/loop() against the simulated hot plate on a
+ * virtual clock, one loop() pass per simulated millisecond, presses Start and
+ * reports how the run went. A full profile takes milliseconds of wall time.
+ * With --autotune, Up is held first: the autotune runs, the plate cools
+ * back to idle and the run then goes with the tuned gains. With --fault, the
+ * sensor or the heater breaks --fault-at s after Start (see sim::Fault).
+ *
+ * A reset in the middle of a run is two invocations sharing an EEPROM image:
+ * the first with --eeprom file and a --duration that ends mid-run, the
+ * second with the same --eeprom and the plate at --plate C, which boots into
+ * the resumed run, or the reset fault if the plate cooled too far.
+ *
+ * --ssr picks the SSR engine (ssr.h) over the firmware's SSR_MODE, on --mains
+ * Hz from the zero-cross detector; --mains 0 is no detector, and the burst
+ * and half-cycle engines stay on windows.
+ *
+ * --timing lists the loop() section timing (timing.h) of the run, in host
+ * time, and asks for it on the serial port too like a PC would. --send puts
+ * a file on the serial port after setup(), an upload from program upload,
+ * and the summary reports the calibration and user profiles then in force.
+ *
+ *   .pio/build/native/program [--profile lf|pb] [--duration s] [--trace]
+ *                             [--telemetry capture.bin] [--download]
+ *                             [--timing] [--send upload.bin] [--autotune]
+ *                             [--fault open|short|heater|stuck]
+ *                             [--fault-at s] [--eeprom image.bin]
+ *                             [--plate C] [--ssr window|burst|half]
+ *                             [--mains 50|60|0]
+ *                             [--power W] [--mass J/K] [--loss W/K]
+ *                             [--ambient C] [--lag s] [--noise C] [--seed n]
+ *
+ * or one of the host checks in native/commands.h:
+ *
+ *   .pio/build/native/program pid-check
+ *   .pio/build/native/program ntc-check
+ *   .pio/build/native/program store-check
+ *   .pio/build/native/program fault-check
+ *   .pio/build/native/program sensor-check
+ *   .pio/build/native/program button-check
+ *   .pio/build/native/program ssr-check
+ *   .pio/build/native/program bench [--report bench.csv] [--baseline old.csv]
+ *   .pio/build/native/program decode capture.bin
+ *   .pio/build/native/program upload calibration offset gain
+ */
+#include "lcd_frame.h"
+#include "native/commands.h"
+#include "native/sim.h"
+#include "kalman.h"
+#include "profile.h"
+#include "reflow.h"
+#include "runlog.h"
+#include "scheduler.h"
+#include "ssr.h"
+#include "store.h"
+#include "telemetry.h"
+#include "timing.h"
+#include <chrono>
+#include <math.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#define START_PRESS_AT 1000    // First Start press after setup() [ms]
+#define START_PRESS_LENGTH 100 // How long the button is held [ms]
+#define TUNE_PRESS_LENGTH 1500 // Up held for the autotune [ms]
+#define START_RETRY 2000       // Press again if the run did not start [ms]
+#define START_ATTEMPTS 5
+#define DOWNLOAD_TIME 1000     // Run log download after the run [ms]
+#define EEPROM_USED (RUNLOG_BASE + RUNLOG_SIZE)
+
+static const char *stateNames[] = {"idle",    "preheat", "soak",
+                                   "reflow",  "cool",    "complete",
+                                   "too_hot", "error",   "autotune"};
+
+static const char *faultNames[] = {"none",     "aborted",  "sensor",
+                                   "heater",   "autotune", "stuck_on",
+                                   "overtemp", "reset"};
+
+/* In timingSection_t order */
+static const char *timingNames[] = {"loop",  "buttons", "sensor",
+                                    "pid",   "state",   "display"};
+
+/* In sim::Fault order */
+static const char *injectNames[] = {"none", "open", "short", "heater",
+                                    "stuck"};
+
+/* In ssrMode_t order */
+static const char *ssrModeNames[] = {"window", "burst", "half"};
+
+/* Hold button from pressAt for length ms, again every START_RETRY */
+static void press(button_t button, unsigned long now, unsigned long &pressAt,
+                  uint8_t &presses, unsigned long length) {
+  if (now == pressAt && presses < START_ATTEMPTS) {
+    sim::setButton(button, true);
+    presses++;
+  } else if (now == pressAt + length) {
+    sim::setButton(button, false);
+    pressAt = now + START_RETRY;
+  }
+}
+
+static void usage(const char *name) {
+  fprintf(stderr,
+          "usage: %s [--profile lf|pb] [--duration s] [--trace]\n"
+          "          [--telemetry capture.bin] [--download] [--timing]\n"
+          "          [--send upload.bin] [--autotune]\n"
+          "          [--fault open|short|heater|stuck] [--fault-at s]\n"
+          "          [--eeprom image.bin] [--plate C]"
+          " [--ssr window|burst|half] [--mains 50|60|0]\n"
+          "          [--power W] [--mass J/K] [--loss W/K] [--ambient C]\n"
+          "          [--lag s] [--noise C] [--seed n]\n",
+          name);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && !strcmp(argv[1], "pid-check"))
+    return pidCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "ntc-check"))
+    return ntcCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "store-check"))
+    return storeCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "fault-check"))
+    return faultCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "sensor-check"))
+    return sensorCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "button-check"))
+    return buttonCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "ssr-check"))
+    return ssrCheck(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "bench"))
+    return bench(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "decode"))
+    return decodeTelemetry(argc - 1, argv + 1);
+  if (argc > 1 && !strcmp(argv[1], "upload"))
+    return encodeUpload(argc - 1, argv + 1);
+
+  sim::PlantParams params = sim::defaultPlant();
+  const char *profileName = "lf";
+  unsigned long duration = 900;
+  uint32_t seed = 1;
+  bool trace = false;
+  bool download = false;
+  bool timed = false;
+  bool autotune = false;
+  sim::Fault fault = sim::FAULT_NONE;
+  unsigned long faultAt = 60; // After Start [s]
+  const char *capture = NULL;
+  const char *image = NULL;
+  const char *upload = NULL;
+  double plateAt = NAN; // At boot [C], ambient if not given
+  int ssrMode = -1;     // The firmware's SSR_MODE
+  unsigned int mains = 50;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (!strcmp(arg, "--trace")) {
+      trace = true;
+      continue;
+    }
+    if (!strcmp(arg, "--download")) {
+      download = true;
+      continue;
+    }
+    if (!strcmp(arg, "--timing")) {
+      timed = true;
+      continue;
+    }
+    if (!strcmp(arg, "--autotune")) {
+      autotune = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      usage(argv[0]);
+    const char *value = argv[++i];
+    if (!strcmp(arg, "--profile")) {
+      profileName = value;
+    } else if (!strcmp(arg, "--send")) {
+      upload = value;
+    } else if (!strcmp(arg, "--fault")) {
+      uint8_t f = 0;
+      while (f < sizeof(injectNames) / sizeof(injectNames[0]) &&
+             strcmp(value, injectNames[f]))
+        f++;
+      if (f == sizeof(injectNames) / sizeof(injectNames[0]))
+        usage(argv[0]);
+      fault = (sim::Fault)f;
+    } else if (!strcmp(arg, "--fault-at")) {
+      faultAt = strtoul(value, NULL, 10);
+    } else if (!strcmp(arg, "--eeprom")) {
+      image = value;
+    } else if (!strcmp(arg, "--plate")) {
+      plateAt = atof(value);
+    } else if (!strcmp(arg, "--ssr")) {
+      ssrMode = 0;
+      while (ssrMode < SSR_MODES && strcmp(value, ssrModeNames[ssrMode]))
+        ssrMode++;
+      if (ssrMode == SSR_MODES)
+        usage(argv[0]);
+    } else if (!strcmp(arg, "--mains")) {
+      mains = strtoul(value, NULL, 10);
+    } else if (!strcmp(arg, "--telemetry")) {
+      capture = value;
+    } else if (!strcmp(arg, "--duration")) {
+      duration = strtoul(value, NULL, 10);
+    } else if (!strcmp(arg, "--power")) {
+      params.heaterPower = atof(value);
+    } else if (!strcmp(arg, "--mass")) {
+      params.heatCapacity = atof(value);
+    } else if (!strcmp(arg, "--loss")) {
+      params.lossCoefficient = atof(value);
+    } else if (!strcmp(arg, "--ambient")) {
+      params.ambient = atof(value);
+    } else if (!strcmp(arg, "--lag")) {
+      params.sensorLag = atof(value);
+    } else if (!strcmp(arg, "--noise")) {
+      params.sensorNoise = atof(value);
+    } else if (!strcmp(arg, "--seed")) {
+      seed = strtoul(value, NULL, 10);
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  std::chrono::steady_clock::time_point wallStart =
+      std::chrono::steady_clock::now();
+
+  sim::reset(params, seed);
+  sim::setMains(mains);
+  if (!isnan(plateAt))
+    sim::plant().setTemperature(plateAt);
+  FILE *saved = image ? fopen(image, "rb") : NULL;
+  if (saved) {
+    if (fread(sim::eeprom(), 1, EEPROM_USED, saved) != EEPROM_USED)
+      fprintf(stderr, "%s: short EEPROM image\n", image);
+    fclose(saved);
+  }
+  // Select the profile the way a Profile press leaves it, a user profile
+  // from the image too
+  store::begin();
+  uint8_t p = 0;
+  for (; p < profile::count(); p++) {
+    char name[3];
+    profile::name(p, name);
+    if (!strcasecmp(profileName, name))
+      break;
+  }
+  if (p == profile::count())
+    usage(argv[0]);
+  reflowProfile_t profile = (reflowProfile_t)p;
+  store::settings().profile = profile;
+  store::change(STORE_SETTINGS);
+  store::commit();
+  setup();
+  if (ssrMode >= 0)
+    ssr::begin((ssrMode_t)ssrMode);
+  FILE *sent = upload ? fopen(upload, "rb") : NULL;
+  if (upload && !sent) {
+    perror(upload);
+    return 1;
+  }
+  for (int byte; sent && (byte = fgetc(sent)) != EOF;)
+    sim::serialSend(byte);
+  if (sent)
+    fclose(sent);
+
+  unsigned long end = hal::millis() + duration * 1000UL;
+  unsigned long pressAt = hal::millis() + START_PRESS_AT;
+  uint8_t presses = 0;
+  bool started = false;
+  unsigned long startedAt = 0, injectedAt = 0, detectedAt = 0; // [ms]
+  bool tuning = autotune; // Autotune before the run
+  bool tuneStarted = false;
+  unsigned long tuneTime = 0; // [ms]
+  double peak = sim::plant().plate();
+  double trackingSquares = 0; // Plate against setpoint while heating
+  unsigned long trackingMs = 0;
+  double readingSquares = 0, estimateSquares = 0; // Against the plate, in a run
+#if CONTROL_CHANNELS > 1
+  double auxPeak = sim::plant(1).plate();
+  double auxSquares = 0; // Against its own setpoint while heating
+  unsigned long heatersOverlap = 0; // Both SSRs on at once [ms]
+#endif
+  unsigned long nextTrace = hal::millis();
+
+  if (trace)
+    printf("time_ms,state,setpoint,reading,plate,sensor,ssr\n");
+
+  while (hal::millis() < end) {
+    unsigned long now = hal::millis();
+    if (tuning) {
+      end = now + duration * 1000UL; // The run gets the full duration
+      if (reflowState == REFLOW_STATE_AUTOTUNE) {
+        sim::setButton(BUTTON_UP, false);
+        tuneStarted = true;
+        tuneTime = now;
+      } else if (reflowState == REFLOW_STATE_ERROR) {
+        break;
+      } else if (tuneStarted && reflowState == REFLOW_STATE_IDLE) {
+        // Cooled down
+        tuning = false;
+        presses = 0;
+        pressAt = now + START_PRESS_AT;
+      } else if (!tuneStarted) {
+        press(BUTTON_UP, now, pressAt, presses, TUNE_PRESS_LENGTH);
+      }
+    } else if (!started) {
+      if (reflowState == REFLOW_STATE_TOO_HOT) {
+        // Wait for the plate to cool, noise can flip it back from idle
+        sim::setButton(BUTTON_START, false);
+        pressAt = now + START_PRESS_AT;
+      } else if (reflowState != REFLOW_STATE_IDLE) {
+        started = true;
+        startedAt = now;
+        peak = sim::plant().plate();
+      } else {
+        press(BUTTON_START, now, pressAt, presses, START_PRESS_LENGTH);
+      }
+    }
+
+    if (started && fault != sim::FAULT_NONE && !injectedAt &&
+        now >= startedAt + faultAt * 1000) {
+      sim::inject(fault);
+      injectedAt = now;
+    }
+
+    loop();
+
+    if (injectedAt && !detectedAt && reflowState == REFLOW_STATE_ERROR)
+      detectedAt = now;
+    if (trace && now >= nextTrace) {
+      printf("%lu,%s,%.1f,%.2f,%.2f,%.2f,%d\n", now, stateNames[reflowState],
+             fix16ToFloat(plate.setpoint), fix16ToFloat(plate.reading),
+             sim::plant().plate(),
+             sim::plant().sensor(), sim::ssr() ? 1 : 0);
+      nextTrace += 1000;
+    }
+    if (started && sim::plant().plate() > peak)
+      peak = sim::plant().plate();
+    if (started && reflowStatus == REFLOW_STATUS_ON &&
+        reflowState != REFLOW_STATE_COOL) {
+      double error = sim::plant().plate() - fix16ToFloat(plate.setpoint);
+      trackingSquares += error * error;
+      trackingMs++;
+      error = fix16ToFloat(plate.reading) - sim::plant().plate();
+      readingSquares += error * error;
+      error = fix16ToFloat(kalman::plate()) - sim::plant().plate();
+      estimateSquares += error * error;
+#if CONTROL_CHANNELS > 1
+      error = sim::plant(1).plate() - fix16ToFloat(aux.setpoint);
+      auxSquares += error * error;
+#endif
+    }
+#if CONTROL_CHANNELS > 1
+    if (started && sim::plant(1).plate() > auxPeak)
+      auxPeak = sim::plant(1).plate();
+    if (sim::ssr(0) && sim::ssr(1))
+      heatersOverlap++;
+#endif
+    if (started && (reflowState == REFLOW_STATE_COMPLETE ||
+                    reflowState == REFLOW_STATE_ERROR))
+      break;
+
+    sim::advance(1);
+  }
+
+  // Sending the timing starts it over, keep what the run took
+  timingStats_t sections[TIMING_SECTIONS];
+  for (uint8_t i = 0; i < TIMING_SECTIONS; i++)
+    sections[i] = timing::stats((timingSection_t)i);
+
+  // Ask for the run log as a PC would after the run
+  if (download || timed) {
+    if (download)
+      sim::serialSend(TELEMETRY_COMMAND_LOG);
+    if (timed)
+      sim::serialSend(TELEMETRY_COMMAND_TIMING);
+    for (unsigned long t = 0; t < DOWNLOAD_TIME; t++) {
+      loop();
+      sim::advance(1);
+    }
+  }
+
+  double wallMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - wallStart)
+                      .count();
+
+  FILE *out = trace ? stderr : stdout;
+  char name[3];
+  profile::name(profile, name);
+  fprintf(out, "profile: %s\n", name);
+  if (autotune) {
+    const gainSchedule_t &schedule = store::schedule();
+    fprintf(out, "autotune_s: %.0f\n", tuneTime / 1000.0);
+    for (uint8_t i = 0; i < schedule.count; i++)
+      fprintf(out, "tuned_%dC: kp %.1f ki %.3f kd %.0f\n",
+              schedule.point[i].temperature,
+              fix16ToFloat(schedule.point[i].gains.kp),
+              fix16ToFloat(schedule.point[i].gains.ki),
+              fix16ToFloat(schedule.point[i].gains.kd));
+    const plantModel_t &model = store::model();
+    fprintf(out, "model: heating %.3f C/s, loss 1/%.0f s, dead time %u s\n",
+            fix16ToFloat(model.heating),
+            model.loss ? 1 / fix16ToFloat(model.loss) : 0.0, model.deadTime);
+  }
+  fprintf(out, "ssr: %s, mains %u Hz\n", ssrModeNames[ssr::mode()],
+          ssr::mainsFrequency());
+  if (upload) {
+    const settings_t &settings = store::settings();
+    fprintf(out, "calibration: offset %.2f C, gain %.4f\n",
+            fix16ToFloat(settings.sensorOffset),
+            fix16ToFloat(settings.sensorGain));
+    fprintf(out, "user_profiles:");
+    for (uint8_t i = builtinProfileCount; i < profile::count(); i++) {
+      char name[3];
+      profile::name(i, name);
+      fprintf(out, " %s", name);
+    }
+    fprintf(out, "\n");
+  }
+  fprintf(out, "boot_to_first_read_ms: %lu\n", firstRead);
+  fprintf(out, "started: %s\n", started ? "yes" : "no");
+  fprintf(out, "start_presses: %u\n", presses);
+  fprintf(out, "final_state: %s\n", stateNames[reflowState]);
+  fprintf(out, "fault: %s\n", faultNames[reflowFault]);
+  if (injectedAt)
+    fprintf(out, "fault_injected_s: %.1f, detected after %.1f s\n",
+            (injectedAt - startedAt) / 1000.0,
+            detectedAt ? (detectedAt - injectedAt) / 1000.0 : -1.0);
+  fprintf(out, "virtual_time_s: %.3f\n", hal::millis() / 1000.0);
+  fprintf(out, "peak_plate_c: %.1f\n", peak);
+  fprintf(out, "overshoot_c: %.1f\n", peak - profile::peak(profile));
+  fprintf(out, "tracking_rms_c: %.2f\n",
+          trackingMs ? sqrt(trackingSquares / trackingMs) : 0.0);
+  fprintf(out, "plate_error_rms_c: reading %.2f, estimate %.2f\n",
+          trackingMs ? sqrt(readingSquares / trackingMs) : 0.0,
+          trackingMs ? sqrt(estimateSquares / trackingMs) : 0.0);
+#if CONTROL_CHANNELS > 1
+  fprintf(out, "aux_peak_c: %.1f\n", auxPeak);
+  fprintf(out, "aux_tracking_rms_c: %.2f\n",
+          trackingMs ? sqrt(auxSquares / trackingMs) : 0.0);
+  fprintf(out, "heaters_overlap_s: %.1f\n", heatersOverlap / 1000.0);
+#endif
+  fprintf(out, "heater_energy_kj: %.1f\n", sim::heaterEnergy() / 1000.0);
+  fprintf(out, "wall_time_ms: %.1f\n", wallMs);
+#ifdef LCD16X2
+  fprintf(out, "lcd_frames: %u\n", lcdFrame.frames());
+  fprintf(out, "lcd_i2c_bytes_per_frame: mean %.1f, max %u, full repaint %u\n",
+          lcdFrame.frames() ? (double)lcdFrame.bytes() / lcdFrame.frames() : 0.0,
+          lcdFrame.maxBytes(), LCD_FRAME_FULL_BYTES);
+#endif
+  runTrace_t runTrace;
+  fprintf(out, "runlog_trace_bytes: %u of %u\n",
+          runlog::trace(&runTrace) ? runTrace.length : 0,
+          (unsigned)RUNLOG_TRACE_BYTES);
+#ifdef SERIAL_PRINTOUT
+  fprintf(out, "telemetry_bytes: %zu, dropped frames %u\n", sim::serial().size(),
+          telemetry::dropped());
+  if (capture) {
+    FILE *file = fopen(capture, "wb");
+    if (!file ||
+        fwrite(sim::serial().data(), 1, sim::serial().size(), file) !=
+            sim::serial().size()) {
+      perror(capture);
+      return 1;
+    }
+    fclose(file);
+  }
+#endif
+  if (image) {
+    FILE *file = fopen(image, "wb");
+    if (!file || fwrite(sim::eeprom(), 1, EEPROM_USED, file) != EEPROM_USED) {
+      perror(image);
+      return 1;
+    }
+    fclose(file);
+  }
+  fprintf(out, "tasks: name runs late overruns lateness_min/mean/max_ms "
+               "max_run_ms\n");
+  for (uint8_t i = 0; i < scheduler.count(); i++) {
+    const taskStats_t &st = scheduler.stats(i);
+    fprintf(out, "  %-8s %6u %5u %5u %5u/%.2f/%u %5u\n", scheduler.name(i),
+            st.runs, st.late, st.overruns, st.runs ? st.minLateness : 0,
+            st.runs ? (double)st.sumLateness / st.runs : 0.0, st.maxLateness,
+            st.maxRunTime);
+  }
+  if (timed) {
+    fprintf(out, "timing: section count min/mean/max_us, histogram from "
+                 "<2 us in powers of two\n");
+    for (uint8_t i = 0; i < TIMING_SECTIONS; i++) {
+      const timingStats_t &t = sections[i];
+      fprintf(out, "  %-8s %8u %u/%.1f/%u  ", timingNames[i], t.count, t.min,
+              t.count ? (double)t.sum / t.count : 0.0, t.max);
+      for (uint8_t b = 0; b < TIMING_BUCKETS; b++)
+        fprintf(out, " %u", t.bucket[b]);
+      fprintf(out, "\n");
+    }
+  }
+  return reflowState == REFLOW_STATE_ERROR ? 1 : 0;
+}
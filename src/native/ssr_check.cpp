@@ -0,0 +1,195 @@
+/*
+ * ssr-check: the SSR engines side by side
+ *
+ * For each engine of ssr.h on simulated 50 Hz mains, with the heater as the
+ * zero-cross SSR switches it:
+ *
+ * - resolution: every requested duty from 0 to SSR_DUTY_MAX held for
+ *   MEASURE_TIME, the duty delivered over it, how many different duties
+ *   come out and the worst error against the request;
+ * - polarity: the worst difference between the time conducted in positive
+ *   and in negative half-cycles over the same runs, in half-cycles;
+ * - ripple: the plate held at RIPPLE_AT by the fixed duty that balances its
+ *   losses there, the true plate temperature peak to peak within each
+ *   window's time, which leaves out the slow drift of the plate.
+ *
+ * Then that 50 and 60 Hz are told apart and anything else is not, and that
+ * the half-cycle engines drop back to windows when the crossings stop and
+ * come back with them.
+ *
+ *   .pio/build/native/program ssr-check
+ */
+#include "native/commands.h"
+#include "native/sim.h"
+#include "ssr.h"
+#include <math.h>
+#include <stdio.h>
+
+#define MAINS 50             // [Hz]
+#define SETTLE_TIME 3000     // Detection and a window to latch the duty [ms]
+#define MEASURE_TIME 10000   // Whole windows and cycles [ms]
+#define RIPPLE_AT 100.0      // [C]
+#define RIPPLE_SETTLE 120000 // [ms]
+#define RIPPLE_TIME 20000    // [ms]
+
+// Worst acceptable, by engine
+static const double maxError[SSR_MODES] = {0.006, 0.003, 0.002}; // Of full
+static const unsigned maxImbalance[SSR_MODES] = {50, 1, 1}; // Half-cycles
+
+static const char *modeNames[] = {"window", "burst", "half-cycle"};
+
+static int failures;
+
+static void report(const char *name, bool ok, const char *detail) {
+  printf("  %-22s %-50s %s\n", name, detail, ok ? "ok" : "FAIL");
+  if (!ok)
+    failures++;
+}
+
+/* Fresh start with the engine running on mains hertz */
+static void start(ssrMode_t mode, unsigned int hertz) {
+  sim::reset(sim::defaultPlant(), 1);
+  sim::setMains(hertz);
+  ssr::begin(mode);
+}
+
+/*
+ * Duty delivered over MEASURE_TIME and the difference between the
+ * polarities in half-cycles; false if the engine did not start
+ */
+static bool deliver(ssrMode_t mode, uint16_t duty, double *delivered,
+                    double *imbalance) {
+  start(mode, MAINS);
+  ssr::setDuty(0, duty);
+  sim::advance(SETTLE_TIME);
+  if (ssr::mode() != mode)
+    return false;
+  long on = 0, polarity = 0; // [ms]
+  for (unsigned long t = 0; t < MEASURE_TIME; t++) {
+    sim::advance(1);
+    if (sim::ssr(0)) {
+      on++;
+      // Half-cycle under way, as the simulation counts them
+      unsigned long half = (hal::millis() - 1) * 2 * MAINS / 1000;
+      polarity += half % 2 ? -1 : 1;
+    }
+  }
+  *delivered = (double)on / MEASURE_TIME;
+  *imbalance = fabs((double)polarity) * 2 * MAINS / 1000;
+  return true;
+}
+
+/* Duty balancing the plate's losses at temperature t */
+static uint16_t holdingDuty(const sim::PlantParams &p, double t) {
+  double k = t + 273.15, a = p.ambient + 273.15;
+  double loss = p.lossCoefficient * (t - p.ambient) +
+                p.radiativeLoss * (k * k * k * k - a * a * a * a);
+  return (uint16_t)lround(loss / p.heaterPower * SSR_DUTY_MAX);
+}
+
+static void compare(ssrMode_t mode) {
+  char name[32], detail[64];
+  double worst = 0, worstImbalance = 0, previous = -1;
+  unsigned levels = 0;
+  uint16_t worstAt = 0;
+  bool started = true;
+  for (uint16_t d = 0; d <= SSR_DUTY_MAX && started; d++) {
+    double delivered = 0, imbalance = 0;
+    started = deliver(mode, d, &delivered, &imbalance);
+    double error = fabs(delivered - (double)d / SSR_DUTY_MAX);
+    if (error > worst) {
+      worst = error;
+      worstAt = d;
+    }
+    if (imbalance > worstImbalance)
+      worstImbalance = imbalance;
+    if (delivered != previous)
+      levels++;
+    previous = delivered;
+  }
+  snprintf(name, sizeof(name), "%s resolution", modeNames[mode]);
+  snprintf(detail, sizeof(detail), "%u levels, worst %.2f%% off at %.1f%%",
+           levels, worst * 100, worstAt * 100.0 / SSR_DUTY_MAX);
+  report(name, started && worst <= maxError[mode], detail);
+  snprintf(name, sizeof(name), "%s polarity", modeNames[mode]);
+  snprintf(detail, sizeof(detail), "%.0f half-cycles apart at worst",
+           worstImbalance);
+  report(name, started && worstImbalance <= maxImbalance[mode], detail);
+
+  start(mode, MAINS);
+  sim::plant().setTemperature(RIPPLE_AT);
+  uint16_t duty = holdingDuty(sim::plant().params(), RIPPLE_AT);
+  ssr::setDuty(0, duty);
+  sim::advance(RIPPLE_SETTLE);
+  double ripple = 0, sum = 0;
+  for (unsigned long t = 0; t < RIPPLE_TIME; t += SSR_WINDOW_SIZE) {
+    double low = sim::plant().plate(), high = low;
+    for (unsigned long i = 0; i < SSR_WINDOW_SIZE; i++) {
+      sim::advance(1);
+      double plate = sim::plant().plate();
+      low = plate < low ? plate : low;
+      high = plate > high ? plate : high;
+      sum += plate;
+    }
+    if (high - low > ripple)
+      ripple = high - low;
+  }
+  snprintf(name, sizeof(name), "%s ripple", modeNames[mode]);
+  snprintf(detail, sizeof(detail), "%.3f C peak to peak at %.1f C, %.1f%%",
+           ripple, sum / RIPPLE_TIME, duty * 100.0 / SSR_DUTY_MAX);
+  report(name, ssr::mode() == mode, detail);
+}
+
+int ssrCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  char detail[64];
+  printf("ssr-check: %d Hz mains, duty measured over %d s, window %d ms in %d "
+         "steps\n",
+         MAINS, MEASURE_TIME / 1000, SSR_WINDOW_SIZE, SSR_RESOLUTION);
+
+  for (uint8_t m = 0; m < SSR_MODES; m++)
+    compare((ssrMode_t)m);
+
+  const unsigned int mains[] = {50, 60, 55, 0};
+  for (uint8_t i = 0; i < sizeof(mains) / sizeof(mains[0]); i++) {
+    start(SSR_MODE_HALF_CYCLE, mains[i]);
+    sim::advance(1000);
+    bool detected = mains[i] == 50 || mains[i] == 60;
+    bool ok = ssr::mainsFrequency() == (detected ? mains[i] : 0) &&
+              ssr::mode() ==
+                  (detected ? SSR_MODE_HALF_CYCLE : SSR_MODE_WINDOW);
+    char name[32];
+    snprintf(name, sizeof(name), "%u Hz mains", mains[i]);
+    snprintf(detail, sizeof(detail), "measured %u Hz, %s",
+             ssr::mainsFrequency(), modeNames[ssr::mode()]);
+    report(name, ok, detail);
+  }
+
+  {
+    start(SSR_MODE_BURST, 60);
+    ssr::setDuty(0, SSR_DUTY_MAX / 2);
+    sim::advance(1000);
+    bool ok = ssr::mode() == SSR_MODE_BURST;
+    sim::setMains(0);
+    unsigned long lost = 0;
+    while (ssr::mode() != SSR_MODE_WINDOW && lost < 1000) {
+      sim::advance(1);
+      lost++;
+    }
+    ok = ok && lost <= SSR_ZERO_CROSS_LOST * SSR_TICK;
+    sim::setMains(60);
+    unsigned long back = 0;
+    while (ssr::mode() != SSR_MODE_BURST && back < 2000) {
+      sim::advance(1);
+      back++;
+    }
+    ok = ok && ssr::mode() == SSR_MODE_BURST;
+    snprintf(detail, sizeof(detail), "windows after %lu ms, back after %lu ms",
+             lost, back);
+    report("crossings lost", ok, detail);
+  }
+
+  printf("ssr-check: %s\n", failures ? "FAIL" : "PASS");
+  return failures ? 1 : 0;
+}
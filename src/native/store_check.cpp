@@ -0,0 +1,173 @@
+/*
+ * store-check: EEPROM store under resets and wear
+ *
+ * Commits a changing settings and user profiles record over and over and
+ * cuts the power after a random number of byte writes each time, then boots
+ * the store again. Every boot must come back with either the record being
+ * written or the one committed before it, never a mix or the defaults. It
+ * also reports how Profile presses wear the EEPROM against rewriting one
+ * byte per press, how many bytes a boot reads, and that an upgrade takes the
+ * old firmware's profile byte over but not the first byte of an older store.
+ *
+ *   .pio/build/native/program store-check
+ */
+#include "native/commands.h"
+#include "native/sim.h"
+#include "store.h"
+#include <stdio.h>
+#include <string.h>
+
+#define RESET_CYCLES 5000
+#define PRESSES 1000
+#define MASHED_PRESSES 20
+
+static uint32_t randomState = 11;
+
+static uint32_t random32() {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static unsigned long totalWrites() {
+  unsigned long n = 0;
+  for (int i = 0; i < STORE_SIZE; i++)
+    n += sim::eepromWrites(i);
+  return n;
+}
+
+static void fill(uint32_t n, settings_t *settings, userProfiles_t *profiles) {
+  memset(settings, 0, sizeof(*settings));
+  settings->profile = n % 4;
+  settings->sensorOffset = n * 1000;
+  settings->sensorGain = FIX16_ONE + n;
+  memset(profiles, 0, sizeof(*profiles));
+  for (uint8_t p = 0; p < STORE_USER_PROFILES; p++) {
+    userProfile_t &u = profiles->profile[p];
+    u.name[0] = 'U';
+    u.name[1] = '1' + p;
+    u.count = STORE_USER_SEGMENTS;
+    for (uint8_t i = 0; i < STORE_USER_SEGMENTS; i++)
+      u.segments[i].target = (int16_t)(n + i * 10 + p);
+  }
+}
+
+int storeCheck(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  bool pass = true;
+
+  // Boot on erased EEPROM
+  sim::reset(sim::defaultPlant());
+  store::begin();
+  unsigned long bootReads = sim::eepromReads();
+  bool defaults = store::settings().profile == 0 &&
+                  store::settings().sensorGain == FIX16_ONE &&
+                  store::schedule().count == 0;
+  pass = pass && defaults;
+  printf("store-check: boot reads %lu of %d bytes, defaults %s\n", bootReads,
+         STORE_SIZE, defaults ? "ok" : "WRONG");
+
+  // Upgrades: the old firmware's profile byte is taken over, the sequence
+  // number of a slot of an earlier store version is not
+  sim::reset(sim::defaultPlant());
+  sim::eeprom()[0] = 1;
+  store::begin();
+  bool legacy = store::settings().profile == 1;
+  sim::reset(sim::defaultPlant());
+  sim::eeprom()[0] = 1;
+  sim::eeprom()[1] = 0;
+  sim::eeprom()[2] = STORE_VERSION - 1;
+  store::begin();
+  bool older = store::settings().profile == 0;
+  pass = pass && legacy && older;
+  printf("upgrades: old firmware profile %s, earlier store version %s\n",
+         legacy ? "kept" : "LOST", older ? "ignored" : "TAKEN AS PROFILE");
+
+  // Button mashing coalesces into one commit, ending where it started into
+  // none
+  for (int i = 0; i < MASHED_PRESSES; i++) {
+    store::settings().profile = (i + 1) % 2;
+    store::change(STORE_SETTINGS);
+  }
+  store::commit();
+  unsigned long mashed = totalWrites();
+  for (int i = 0; i < 2; i++) {
+    store::settings().profile = (store::settings().profile + 1) % 2;
+    store::change(STORE_SETTINGS);
+  }
+  store::commit();
+  bool coalesced = totalWrites() == mashed;
+  pass = pass && coalesced;
+  printf("%d presses: %lu byte writes, back to the same profile: %lu (%s)\n",
+         MASHED_PRESSES, mashed, totalWrites() - mashed,
+         coalesced ? "ok" : "WRONG");
+
+  // Wear of one committed press after another
+  sim::reset(sim::defaultPlant());
+  store::begin();
+  for (int i = 0; i < PRESSES; i++) {
+    store::settings().profile = (i + 1) % 2;
+    store::change(STORE_SETTINGS);
+    store::commit();
+  }
+  unsigned long worst = 0;
+  for (int i = 0; i < STORE_SIZE; i++)
+    if (sim::eepromWrites(i) > worst)
+      worst = sim::eepromWrites(i);
+  printf("%d committed presses: at most %lu writes to a byte, one byte per "
+         "press before: %d\n",
+         PRESSES, worst, PRESSES);
+
+  // Resets in the middle of commits
+  sim::reset(sim::defaultPlant());
+  store::begin();
+  settings_t settings, committed;
+  userProfiles_t profiles, committedProfiles;
+  fill(0, &committed, &committedProfiles);
+  memcpy(&store::settings(), &committed, sizeof(committed));
+  memcpy(&store::profiles(), &committedProfiles, sizeof(committedProfiles));
+  store::change(STORE_SETTINGS);
+  store::change(STORE_PROFILES);
+  store::commit();
+
+  unsigned long torn = 0, completed = 0, failures = 0;
+  for (uint32_t n = 1; n <= RESET_CYCLES; n++) {
+    fill(n, &settings, &profiles);
+    memcpy(&store::settings(), &settings, sizeof(settings));
+    memcpy(&store::profiles(), &profiles, sizeof(profiles));
+    store::change(STORE_SETTINGS);
+    store::change(STORE_PROFILES);
+    sim::eepromCutAfter(random32() % (sizeof(settings_t) +
+                                      sizeof(userProfiles_t) + 12));
+    store::commit();
+    sim::eepromCutAfter(-1);
+
+    store::begin();
+    bool settingsNew = !memcmp(&store::settings(), &settings, sizeof(settings));
+    bool settingsOld =
+        !memcmp(&store::settings(), &committed, sizeof(committed));
+    bool profilesNew =
+        !memcmp(&store::profiles(), &profiles, sizeof(profiles));
+    bool profilesOld = !memcmp(&store::profiles(), &committedProfiles,
+                               sizeof(committedProfiles));
+    if (!(settingsNew || settingsOld) || !(profilesNew || profilesOld)) {
+      failures++;
+      continue;
+    }
+    if (settingsNew && profilesNew)
+      completed++;
+    else
+      torn++;
+    if (settingsNew)
+      committed = settings;
+    if (profilesNew)
+      committedProfiles = profiles;
+  }
+  pass = pass && failures == 0;
+  printf("%d commits cut short at random: %lu completed, %lu kept the "
+         "previous copy, %lu lost: %s\n",
+         RESET_CYCLES, completed, torn, failures, pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
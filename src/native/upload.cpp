@@ -0,0 +1,138 @@
+/*
+ * upload: store uploads for the serial port
+ *
+ * Writes TELEMETRY_COMMAND_UPLOAD and the COBS encoded upload frame
+ * (telemetry.h) to stdout, to be sent to the controller as is. The sensor
+ * calibration is an offset added to the reading [C] and a gain it is scaled
+ * by. A user profile goes into slot 0 or 1 with a two-letter name, the solder
+ * liquidus [C] and up to STORE_USER_SEGMENTS segments, each
+ *
+ *   state:type:target:rate:band   ramp or cool at rate [C/s] to target [C],
+ *                                 done within band [C] of it
+ *   state:hold:target:time        hold target [C] for time [s]
+ *
+ * with state preheat, soak, reflow or cool, as shown while it runs. A slot
+ * given without a name is emptied.
+ *
+ *   .pio/build/native/program upload calibration 1.5 1.02 > cal.bin
+ *   .pio/build/native/program upload profile 0 LT 138 \
+ *       preheat:ramp:90:1:5 soak:ramp:130:0.5:5 reflow:ramp:165:1:1 \
+ *       cool:cool:100:1:5 > lt.bin
+ *   stty -F /dev/ttyUSB0 115200 raw && cat lt.bin > /dev/ttyUSB0
+ *
+ * The controller answers with TELEMETRY_ACK, which program decode reports.
+ */
+#include "cobs.h"
+#include "crc16.h"
+#include "native/commands.h"
+#include "profile.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* In reflowState_t order from REFLOW_STATE_PREHEAT */
+static const char *stateNames[] = {"preheat", "soak", "reflow", "cool"};
+
+/* In segmentType_t order */
+static const char *typeNames[] = {"ramp", "hold", "cool"};
+
+static uint8_t frame[TELEMETRY_UPLOAD_MAX];
+static uint8_t length;
+
+static void put(uint8_t data) { frame[length++] = data; }
+
+static void put32(uint32_t data) {
+  for (uint8_t i = 0; i < 4; i++)
+    put(data >> (8 * i));
+}
+
+static int usage() {
+  fprintf(stderr,
+          "usage: upload calibration offset gain\n"
+          "       upload profile slot [name liquidus segment...]\n"
+          "segment: state:ramp|cool:target:rate:band or "
+          "state:hold:target:time\n");
+  return 2;
+}
+
+static int lookup(const char *name, const char **names, int count) {
+  for (int i = 0; i < count; i++)
+    if (name && !strcmp(name, names[i]))
+      return i;
+  return -1;
+}
+
+/* state:type:target:rate:band or state:hold:target:time */
+static bool segment(char *text, userSegment_t *s) {
+  char *field[5];
+  int n = 0;
+  for (char *f = strtok(text, ":"); f && n < 5; f = strtok(NULL, ":"))
+    field[n++] = f;
+  int state = n ? lookup(field[0], stateNames, 4) : -1;
+  int type = n > 1 ? lookup(field[1], typeNames, 3) : -1;
+  if (state < 0 || type < 0 || n != (type == SEGMENT_HOLD ? 4 : 5))
+    return false;
+  memset(s, 0, sizeof(*s));
+  s->type = type;
+  s->state = REFLOW_STATE_PREHEAT + state;
+  s->target = atoi(field[2]);
+  if (type == SEGMENT_HOLD) {
+    s->time = atoi(field[3]);
+  } else {
+    s->rate = atof(field[3]) * 256 + 0.5;
+    s->band = atoi(field[4]);
+  }
+  return true;
+}
+
+int encodeUpload(int argc, char **argv) {
+  length = 0;
+  if (argc == 4 && !strcmp(argv[1], "calibration")) {
+    fix16_t gain = fix16FromFloat(atof(argv[3]));
+    if (gain <= 0)
+      return usage();
+    put(TELEMETRY_CALIBRATION);
+    put32(fix16FromFloat(atof(argv[2])));
+    put32(gain);
+  } else if ((argc == 3 || argc >= 5) && !strcmp(argv[1], "profile")) {
+    userProfile_t user;
+    memset(&user, 0, sizeof(user));
+    int slot = atoi(argv[2]);
+    if (slot < 0 || slot >= STORE_USER_PROFILES ||
+        argc - 5 > STORE_USER_SEGMENTS)
+      return usage();
+    if (argc >= 5) {
+      strncpy(user.name, argv[3], sizeof(user.name) - 1);
+      user.liquidus = atoi(argv[4]);
+      for (int i = 5; i < argc; i++)
+        if (!segment(argv[i], &user.segments[user.count++]))
+          return usage();
+      if (!user.count || !profile::valid(user)) {
+        fprintf(stderr, "upload: the profile cannot run\n");
+        return 1;
+      }
+    }
+    put(TELEMETRY_PROFILE);
+    put(slot);
+    // The record has the same byte layout on the line and in the store
+    memcpy(frame + length, &user, sizeof(user));
+    length += sizeof(user);
+  } else {
+    return usage();
+  }
+
+  uint16_t crc = CRC16_INIT;
+  for (uint8_t i = 0; i < length; i++)
+    crc = crc16Update(crc, frame[i]);
+  put(crc);
+  put(crc >> 8);
+
+  uint8_t encoded[COBS_ENCODED_LENGTH(TELEMETRY_UPLOAD_MAX) + 2];
+  uint8_t n = 0;
+  encoded[n++] = TELEMETRY_COMMAND_UPLOAD;
+  n += cobs::encode(frame, length, encoded + n);
+  encoded[n++] = COBS_DELIMITER;
+  fwrite(encoded, 1, n, stdout);
+  return 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * NTC thermistor conversion
+ */
+#include "ntc.h"
+#include "hal.h"
+
+namespace ntc {
+
+// Index pack 0..N-1 for building the table in a single constant expression
+template <int... I> struct Indices {};
+template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndices<0, I...> {
+  typedef Indices<I...> type;
+};
+
+struct Table {
+  int16_t t[NTC_TABLE_SIZE]; // [1/NTC_TABLE_SCALE C]
+};
+
+constexpr int16_t entry(int i) {
+  return (int16_t)(betaTemperature((double)i * (1 << NTC_TABLE_SHIFT)) *
+                       NTC_TABLE_SCALE +
+                   0.5);
+}
+
+template <int... I> constexpr Table makeTable(Indices<I...>) {
+  return {{entry(I)...}};
+}
+
+static constexpr Table table PROGMEM =
+    makeTable(MakeIndices<NTC_TABLE_SIZE>::type());
+
+fix16_t temperature(uint16_t adc) {
+  if (adc >= NTC_ADC_MAX)
+    adc = NTC_ADC_MAX - 1;
+  uint16_t i = adc >> NTC_TABLE_SHIFT;
+  int16_t t0 = pgm_read_word(&table.t[i]);
+  int16_t t1 = pgm_read_word(&table.t[i + 1]);
+  int16_t fraction = adc & ((1 << NTC_TABLE_SHIFT) - 1);
+  // t0 + (t1 - t0) * fraction, in table units scaled up to Q16.16
+  int32_t t = ((int32_t)t0 << NTC_TABLE_SHIFT) + (int32_t)(t1 - t0) * fraction;
+  return t * (FIX16_ONE / NTC_TABLE_SCALE >> NTC_TABLE_SHIFT);
+}
+
+} // namespace ntc
@@ -0,0 +1,60 @@
+/*
+ * Temperature chart on the 128x64 OLED
+ */
+#include "oled_chart.h"
+
+#ifdef SSD1306
+
+namespace chart {
+
+static SSD1306AsciiTwi *display;
+
+/* count copies of value on page from column x, one cursor move */
+static void writeRun(uint8_t x, uint8_t page, uint8_t value, uint8_t count) {
+  display->setCursor(x, page);
+  while (count--)
+    display->ssd1306WriteRam(value);
+}
+
+/* Time axis bit of a sample column's page */
+static uint8_t axisBits(uint8_t page) {
+  return page == CHART_LAST_PAGE ? 1 << (CHART_BOTTOM & 7) : 0;
+}
+
+void begin(SSD1306AsciiTwi &oled) { display = &oled; }
+
+void drawAxes() {
+  for (uint8_t page = CHART_FIRST_PAGE; page <= CHART_LAST_PAGE; page++) {
+    // Temperature axis from CHART_AXIS_TOP down to the time axis
+    uint8_t bits = 0xff;
+    if (page == CHART_FIRST_PAGE)
+      bits <<= CHART_AXIS_TOP & 7;
+    writeRun(CHART_AXIS_X, page, bits, 1);
+  }
+  writeRun(CHART_AXIS_X + 1, CHART_LAST_PAGE, axisBits(CHART_LAST_PAGE),
+           CHART_WIDTH);
+  display->flush();
+}
+
+void clear() {
+  for (uint8_t page = CHART_FIRST_PAGE; page <= CHART_LAST_PAGE; page++)
+    writeRun(CHART_AXIS_X + 1, page, axisBits(page), CHART_WIDTH);
+  display->flush();
+}
+
+void plot(uint8_t sample, uint8_t y) {
+  if (sample >= CHART_WIDTH)
+    return;
+  if (y < CHART_AXIS_TOP)
+    y = CHART_AXIS_TOP;
+  if (y > CHART_BOTTOM)
+    y = CHART_BOTTOM;
+  uint8_t page = y >> 3;
+  writeRun(CHART_AXIS_X + 1 + sample, page, (1 << (y & 7)) | axisBits(page),
+           1);
+  display->flush();
+}
+
+} // namespace chart
+
+#endif // SSD1306
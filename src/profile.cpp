@@ -0,0 +1,243 @@
+/*
+ * Reflow profile engine
+ */
+#include "profile.h"
+#include "hal.h"
+
+static profile_t current;         // Copied from PROGMEM
+static const userProfile_t *user; // Or the user profile in the store
+static profileSegment_t segment_; // Segment in progress
+static uint8_t segmentIndex;
+static fix16_t setpoint_;
+static fix16_t rate_; // Setpoint movement of the last tick [C/s]
+static unsigned long segmentStart; // [ms]
+static unsigned long lastTick;     // [ms]
+
+/* User profile of a profile index past the built-ins, skipping unused ones */
+static const userProfile_t *userProfile(uint8_t index) {
+  index -= builtinProfileCount;
+  const userProfiles_t &profiles = store::profiles();
+  for (uint8_t i = 0; i < STORE_USER_PROFILES; i++) {
+    if (!profiles.profile[i].count)
+      continue;
+    if (!index--)
+      return &profiles.profile[i];
+  }
+  return NULL;
+}
+
+static void load(uint8_t index, unsigned long now) {
+  segmentIndex = index;
+  segmentStart = now;
+  if (index >= current.count)
+    return;
+
+  if (user) {
+    const userSegment_t &s = user->segments[index];
+    segment_.type = s.type;
+    segment_.state = s.state;
+    segment_.target = s.target;
+    segment_.rate = (fix16_t)s.rate << 8;
+    segment_.time = s.time;
+    segment_.band = s.band;
+  } else {
+    memcpy_P(&segment_, &current.segments[index], sizeof(segment_));
+  }
+}
+
+/* Points of the schedule in the store, 0 if the profile's is in force */
+static uint8_t storedPoints() {
+  uint8_t count = store::schedule().count;
+  return count <= STORE_SCHEDULE_POINTS ? count : 0;
+}
+
+static void schedulePoint(uint8_t i, schedulePoint_t *point) {
+  if (storedPoints())
+    *point = store::schedule().point[i];
+  else
+    memcpy_P(point, &current.schedule[i], sizeof(*point));
+}
+
+/* Move the setpoint by rate over dt ms toward the segment target */
+static void approach(unsigned long dt) {
+  fix16_t target = fix16FromInt(segment_.target);
+  rate_ = 0;
+  if (segment_.type == SEGMENT_HOLD || segment_.rate == 0) {
+    setpoint_ = target;
+    return;
+  }
+  fix16_t step = (int64_t)segment_.rate * dt / 1000;
+  if (setpoint_ < target) {
+    setpoint_ = target - setpoint_ <= step ? target : setpoint_ + step;
+    rate_ = segment_.rate;
+  } else if (setpoint_ > target) {
+    setpoint_ = setpoint_ - target <= step ? target : setpoint_ - step;
+    rate_ = -segment_.rate;
+  }
+}
+
+#define ANY_STATE 0xff
+
+/* Highest segment target of a profile, of the segments shown as state */
+static int16_t highest(uint8_t index, uint8_t state) {
+  int16_t highest = 0;
+  if (index < builtinProfileCount) {
+    profile_t p;
+    memcpy_P(&p, &builtinProfiles[index], sizeof(p));
+    for (uint8_t i = 0; i < p.count; i++) {
+      int16_t target = pgm_read_word(&p.segments[i].target);
+      uint8_t s = pgm_read_byte(&p.segments[i].state);
+      if ((state == ANY_STATE || s == state) && target > highest)
+        highest = target;
+    }
+  } else {
+    const userProfile_t *p = userProfile(index);
+    for (uint8_t i = 0; i < p->count && i < STORE_USER_SEGMENTS; i++) {
+      const userSegment_t &s = p->segments[i];
+      if ((state == ANY_STATE || s.state == state) && s.target > highest)
+        highest = s.target;
+    }
+  }
+  return highest;
+}
+
+namespace profile {
+
+void begin(uint8_t index, fix16_t reading, unsigned long now,
+           uint8_t segment) {
+  if (index >= count())
+    index = 0;
+  user = NULL;
+  if (index < builtinProfileCount) {
+    memcpy_P(&current, &builtinProfiles[index], sizeof(current));
+  } else {
+    user = userProfile(index);
+    memcpy(current.name, user->name, sizeof(current.name));
+    current.liquidus = user->liquidus;
+    current.count = user->count;
+    if (current.count > STORE_USER_SEGMENTS)
+      current.count = STORE_USER_SEGMENTS;
+    current.segments = NULL;
+    current.points = defaultSchedulePoints;
+    current.schedule = defaultSchedule;
+  }
+  setpoint_ = reading;
+  lastTick = now;
+  load(segment, now);
+  if (!done())
+    approach(0);
+}
+
+bool update(fix16_t reading, unsigned long now) {
+  if (done())
+    return false;
+
+  unsigned long dt = now - lastTick;
+  lastTick = now;
+  approach(dt);
+
+  fix16_t target = fix16FromInt(segment_.target);
+  fix16_t band = fix16FromInt(segment_.band);
+  bool finished = false;
+  switch (segment_.type) {
+  case SEGMENT_RAMP:
+    finished = setpoint_ == target && reading >= target - band;
+    break;
+  case SEGMENT_HOLD:
+    finished = now - segmentStart >= (unsigned long)segment_.time * 1000;
+    break;
+  case SEGMENT_COOL:
+    finished = setpoint_ == target && reading <= target + band;
+    break;
+  default:
+    finished = true;
+    break;
+  }
+  if (!finished)
+    return false;
+
+  load(segmentIndex + 1, now);
+  // Holds and rate 0 segments start at their target right away
+  if (!done())
+    approach(0);
+  return true;
+}
+
+bool done() { return segmentIndex >= current.count; }
+
+fix16_t setpoint() { return setpoint_; }
+
+fix16_t rate() {
+  return setpoint_ == fix16FromInt(segment_.target) ? 0 : rate_;
+}
+
+reflowState_t state() { return (reflowState_t)segment_.state; }
+
+const profileSegment_t &segment() { return segment_; }
+
+uint8_t position() { return segmentIndex; }
+
+void gains(fix16_t reading, tuning_t *gains) {
+  uint8_t count = storedPoints() ? storedPoints() : current.points;
+
+  // First point above the reading, the gains lie between it and the one below
+  schedulePoint_t below, above;
+  schedulePoint(0, &above);
+  below = above;
+  uint8_t i = 0;
+  while (fix16FromInt(above.temperature) <= reading && ++i < count) {
+    below = above;
+    schedulePoint(i, &above);
+  }
+  if (i == 0 || i == count) {
+    *gains = above.gains;
+    return;
+  }
+  fix16_t share = fix16Div(reading - fix16FromInt(below.temperature),
+                           fix16FromInt(above.temperature - below.temperature));
+  gains->kp = below.gains.kp + fix16Mul(above.gains.kp - below.gains.kp, share);
+  gains->ki = below.gains.ki + fix16Mul(above.gains.ki - below.gains.ki, share);
+  gains->kd = below.gains.kd + fix16Mul(above.gains.kd - below.gains.kd, share);
+}
+
+uint8_t count() {
+  uint8_t n = builtinProfileCount;
+  for (uint8_t i = 0; i < STORE_USER_PROFILES; i++)
+    if (store::profiles().profile[i].count)
+      n++;
+  return n;
+}
+
+void name(uint8_t index, char *buffer) {
+  if (index < builtinProfileCount)
+    memcpy_P(buffer, builtinProfiles[index].name, sizeof(current.name));
+  else
+    memcpy(buffer, userProfile(index)->name, sizeof(current.name));
+  buffer[sizeof(current.name) - 1] = '\0';
+}
+
+int16_t peak(uint8_t index) { return highest(index, ANY_STATE); }
+
+int16_t target(uint8_t index, reflowState_t state) {
+  return highest(index, state);
+}
+
+int16_t liquidus(uint8_t index) {
+  if (index < builtinProfileCount)
+    return pgm_read_word(&builtinProfiles[index].liquidus);
+  return userProfile(index)->liquidus;
+}
+
+bool valid(const userProfile_t &user) {
+  if (user.count > STORE_USER_SEGMENTS)
+    return false;
+  for (uint8_t i = 0; i < user.count; i++) {
+    const userSegment_t &s = user.segments[i];
+    if (s.type > SEGMENT_COOL || s.state < REFLOW_STATE_PREHEAT ||
+        s.state > REFLOW_STATE_COOL || (s.type != SEGMENT_HOLD && !s.rate))
+      return false;
+  }
+  return true;
+}
+
+} // namespace profile
@@ -0,0 +1,89 @@
+/*
+ * Built-in reflow profiles
+ *
+ * Preheat ramps to the soak start and hands over once the plate is within
+ * 5 C of it, so the slow final approach of the preheat gains does not stall
+ * the run. Soak ramps slowly through the flux activation range, reflow
+ * steps the setpoint to the peak and cooling begins once the plate is within
+ * 1 C of it. The bands are checked against the Kalman estimate of the plate
+ * (kalman.h) rather than the lagging reading, so the heater is cut when the
+ * plate itself gets there instead of early to leave room for the lag. Add a
+ * profile by adding a table and an entry to builtinProfiles[]; the Profile
+ * button cycles through them and then through the user profiles in the
+ * store, which run with defaultSchedule[].
+ *
+ * The gain schedule puts the gains that used to be switched at the start of
+ * preheat, soak and reflow at the middle of the temperatures each stage
+ * spans, so the gains change over the same range but without a step.
+ */
+#include "profile.h"
+#include "hal.h"
+#include "store.h"
+
+// ***** PID PARAMETERS *****
+#define PID_KP_PREHEAT FIX16(100)
+#define PID_KI_PREHEAT FIX16(0.025)
+#define PID_KD_PREHEAT FIX16(20)
+
+#define PID_KP_SOAK FIX16(300)
+#define PID_KI_SOAK FIX16(0.05)
+#define PID_KD_SOAK FIX16(250)
+
+#define PID_KP_REFLOW FIX16(300)
+#define PID_KI_REFLOW FIX16(0.05)
+#define PID_KD_REFLOW FIX16(350)
+
+#define GAINS_PREHEAT PID_KP_PREHEAT, PID_KI_PREHEAT, PID_KD_PREHEAT
+#define GAINS_SOAK PID_KP_SOAK, PID_KI_SOAK, PID_KD_SOAK
+#define GAINS_REFLOW PID_KP_REFLOW, PID_KI_REFLOW, PID_KD_REFLOW
+
+/* Gains against the plate temperature, interpolated in between */
+const schedulePoint_t defaultSchedule[] PROGMEM = {
+    // temperature [C], gains
+    {100, {GAINS_PREHEAT}},
+    {175, {GAINS_SOAK}},
+    {225, {GAINS_REFLOW}},
+};
+
+const uint8_t defaultSchedulePoints =
+    sizeof(defaultSchedule) / sizeof(defaultSchedule[0]);
+
+// ***** SHARED PROFILE CONSTANTS *****
+#define TEMPERATURE_SOAK_MIN 150
+#define TEMPERATURE_COOL_MIN 100
+#define PREHEAT_RATE FIX16(1.0) // [C/s]
+#define PREHEAT_BAND 5          // [C]
+#define SOAK_BAND 5             // [C]
+#define REFLOW_BAND 1           // [C]
+
+// ***** LEAD FREE PROFILE *****
+static const profileSegment_t leadFree[] PROGMEM = {
+    // type, state, target [C], rate [C/s], time [s], band [C]
+    {SEGMENT_RAMP, REFLOW_STATE_PREHEAT, TEMPERATURE_SOAK_MIN, PREHEAT_RATE,
+     0, PREHEAT_BAND},
+    {SEGMENT_RAMP, REFLOW_STATE_SOAK, 200, FIX16(5.0 / 9), 0, SOAK_BAND},
+    {SEGMENT_RAMP, REFLOW_STATE_REFLOW, 250, 0, 0, REFLOW_BAND},
+    {SEGMENT_COOL, REFLOW_STATE_COOL, TEMPERATURE_COOL_MIN, 0, 0, 0},
+};
+
+// ***** LEADED PROFILE *****
+static const profileSegment_t leaded[] PROGMEM = {
+    {SEGMENT_RAMP, REFLOW_STATE_PREHEAT, TEMPERATURE_SOAK_MIN, PREHEAT_RATE,
+     0, PREHEAT_BAND},
+    {SEGMENT_RAMP, REFLOW_STATE_SOAK, 180, FIX16(5.0 / 10), 0, SOAK_BAND},
+    {SEGMENT_RAMP, REFLOW_STATE_REFLOW, 224, 0, 0, REFLOW_BAND},
+    {SEGMENT_COOL, REFLOW_STATE_COOL, TEMPERATURE_COOL_MIN, 0, 0, 0},
+};
+
+#define SEGMENTS(table) sizeof(table) / sizeof(table[0]), table
+#define SCHEDULE(table) SEGMENTS(table)
+
+/* Indexed by reflowProfile_t */
+const profile_t builtinProfiles[] PROGMEM = {
+    // name, liquidus [C], segments, gain schedule
+    {"LF", 217, SEGMENTS(leadFree), SCHEDULE(defaultSchedule)},
+    {"PB", 183, SEGMENTS(leaded), SCHEDULE(defaultSchedule)},
+};
+
+const uint8_t builtinProfileCount =
+    sizeof(builtinProfiles) / sizeof(builtinProfiles[0]);
@@ -0,0 +1,353 @@
+/*
+ * Run history log
+ */
+#include "runlog.h"
+#include "crc16.h"
+#include <stddef.h>
+
+static_assert(RUNLOG_BASE + RUNLOG_SIZE <= 1024, "run log beyond EEPROM");
+static_assert(RUNLOG_TRACE_BYTES >= 256, "no room for the run log trace");
+static_assert(offsetof(runCheckpoint_t, crc) ==
+                  sizeof(runCheckpoint_t) - sizeof(uint16_t),
+              "checkpoint CRC must be written last");
+
+static bool running;
+static uint8_t newest;   // Slot of the newest summary
+static uint16_t lastRun; // Its run number
+static bool any;         // There is a valid summary
+
+static runSummary_t current;
+static runTrace_t header;
+static int16_t traceLast; // Last traced reading [1/RUNLOG_TRACE_SCALE C]
+static unsigned long started, lastSample, lastTrace; // [ms]
+static unsigned long stageMs[RUNLOG_STAGES];
+static unsigned long aboveMs;
+static fix16_t liquidus_;
+static fix16_t recent[RUNLOG_RAMP_SPAN]; // Last readings, one per second
+static uint8_t recentCount;
+
+// Writes waiting for flush(): a record from its RAM copy, byte by byte
+typedef struct PENDING_WRITE {
+  uint16_t address;
+  const uint8_t *data;
+  uint8_t length;
+  uint8_t done; // Bytes written so far
+} pendingWrite_t;
+
+static pendingWrite_t checkpointWrite, summaryWrite, headerWrite;
+static runCheckpoint_t checkpoint_; // Queued
+static uint8_t traceQueue[RUNLOG_TRACE_QUEUE]; // By trace offset
+static uint16_t traceWritten; // Trace bytes in the EEPROM, the rest queued
+
+static uint16_t crc(const uint8_t *data, uint8_t length, uint16_t crc) {
+  while (length--)
+    crc = crc16Update(crc, *data++);
+  return crc;
+}
+
+static void read(uint16_t address, void *data, uint8_t length) {
+  uint8_t *p = (uint8_t *)data;
+  while (length--)
+    *p++ = hal::eepromRead(address++);
+}
+
+/* Queue record for flush(), which must not change until it is written */
+static void queue(pendingWrite_t &w, uint16_t address, const void *data,
+                  uint8_t length) {
+  w.address = address;
+  w.data = (const uint8_t *)data;
+  w.length = length;
+  w.done = 0;
+}
+
+/* Next byte of w that differs from the EEPROM, false if none is left */
+static bool step(pendingWrite_t &w) {
+  while (w.done < w.length) {
+    uint16_t address = w.address + w.done;
+    uint8_t value = w.data[w.done++];
+    if (hal::eepromRead(address) != value) {
+      hal::eepromWrite(address, value);
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Trace byte i, from the EEPROM or the queue */
+static uint8_t traceAt(uint16_t i) {
+  return i < traceWritten ? hal::eepromRead(RUNLOG_TRACE_DATA + i)
+                          : traceQueue[i % RUNLOG_TRACE_QUEUE];
+}
+
+static bool stepTrace() {
+  while (traceWritten < header.length) {
+    uint16_t address = RUNLOG_TRACE_DATA + traceWritten;
+    uint8_t value = traceQueue[traceWritten++ % RUNLOG_TRACE_QUEUE];
+    if (hal::eepromRead(address) != value) {
+      hal::eepromWrite(address, value);
+      return true;
+    }
+  }
+  return false;
+}
+
+/* Everything queued, waiting on the EEPROM. Not while a run is on: the
+   reads then see the records written so far, flush() does the rest */
+static void drain() {
+  if (running)
+    return;
+  while (step(checkpointWrite) || stepTrace() || step(summaryWrite) ||
+         step(headerWrite))
+    ;
+}
+
+static uint16_t summaryAddress(uint8_t slot) {
+  return RUNLOG_BASE + slot * sizeof(runSummary_t);
+}
+
+static bool readSummary(uint8_t slot, runSummary_t *s) {
+  read(summaryAddress(slot), s, sizeof(*s));
+  return s->crc ==
+         crc((const uint8_t *)s, sizeof(*s) - sizeof(s->crc), CRC16_INIT);
+}
+
+/* Temperature in 1/scale C, rounded and saturated to 16 bits */
+static int16_t scaled(fix16_t t, uint8_t scale) {
+  int32_t x = ((int64_t)t * scale + FIX16_ONE / 2) >> 16;
+  return x > 32767 ? 32767 : x < -32767 ? -32767 : x;
+}
+
+/* Summary of current into the next slot, CRC last */
+static void writeSummary() {
+  current.crc = crc((const uint8_t *)&current,
+                    sizeof(current) - sizeof(current.crc), CRC16_INIT);
+  uint8_t slot = any ? (newest + 1) % RUNLOG_SUMMARIES : 0;
+  queue(summaryWrite, summaryAddress(slot), &current, sizeof(current));
+  newest = slot;
+  lastRun = current.run;
+  any = true;
+}
+
+static void openRun(uint16_t run, uint8_t profile, int16_t liquidus,
+                 fix16_t reading, unsigned long now) {
+  drain(); // The last run's summary and header, before they are reused
+  memset(&current, 0, sizeof(current));
+  current.run = run;
+  current.profile = profile;
+  current.peak = scaled(reading, RUNLOG_SUMMARY_SCALE);
+  liquidus_ = fix16FromInt(liquidus);
+  memset(stageMs, 0, sizeof(stageMs));
+  aboveMs = 0;
+  recentCount = 0;
+  started = lastSample = lastTrace = now;
+
+  // The header goes last: until then the old trace fails its CRC
+  memset(&header, 0, sizeof(header));
+  header.run = current.run;
+  header.interval = RUNLOG_TRACE_INTERVAL;
+  header.first = traceLast = scaled(reading, RUNLOG_TRACE_SCALE);
+  traceWritten = 0;
+  const uint16_t crcAddress = RUNLOG_TRACE_BASE + offsetof(runTrace_t, crc);
+  hal::eepromWrite(crcAddress, ~hal::eepromRead(crcAddress));
+  running = true;
+}
+
+static void traceAppend(int16_t value) {
+  int16_t delta = value - traceLast;
+  // Zigzag: small differences of either sign become small numbers
+  uint16_t zigzag = ((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+  uint8_t bytes[3], n = 0;
+  do {
+    bytes[n] = zigzag & 0x7f;
+    zigzag >>= 7;
+    if (zigzag)
+      bytes[n] |= 0x80;
+    n++;
+  } while (zigzag);
+  if (header.length + n > RUNLOG_TRACE_BYTES) {
+    header.truncated = 1;
+    return;
+  }
+  // flush() keeps up with a byte every few seconds, this is only a backstop
+  while (header.length + n - traceWritten > RUNLOG_TRACE_QUEUE)
+    stepTrace();
+  for (uint8_t i = 0; i < n; i++)
+    traceQueue[(header.length + i) % RUNLOG_TRACE_QUEUE] = bytes[i];
+  header.length += n;
+  traceLast = value;
+}
+
+namespace runlog {
+
+void begin() {
+  any = false;
+  for (uint8_t slot = 0; slot < RUNLOG_SUMMARIES; slot++) {
+    runSummary_t s;
+    if (!readSummary(slot, &s))
+      continue;
+    if (!any || (int16_t)(s.run - lastRun) > 0) {
+      newest = slot;
+      lastRun = s.run;
+      any = true;
+    }
+  }
+  running = false;
+}
+
+void start(uint8_t profile, int16_t liquidus, fix16_t reading,
+           unsigned long now) {
+  openRun(any ? lastRun + 1 : 0, profile, liquidus, reading, now);
+}
+
+void checkpoint(uint8_t segment, reflowState_t state, fix16_t reading) {
+  if (!running)
+    return;
+  // A checkpoint still queued is out of date, this one starts over. Bytes
+  // go out in order, CRC last: a reset in between leaves the old checkpoint,
+  // or one that fails its CRC
+  runCheckpoint_t &c = checkpoint_;
+  c.run = current.run;
+  c.profile = current.profile;
+  c.segment = segment;
+  c.state = state;
+  c.reading = scaled(reading, RUNLOG_SUMMARY_SCALE);
+  c.crc = crc((const uint8_t *)&c, sizeof(c) - sizeof(c.crc), CRC16_INIT);
+  queue(checkpointWrite, RUNLOG_CHECKPOINT_BASE, &c, sizeof(c));
+}
+
+bool interrupted(runCheckpoint_t *c) {
+  drain();
+  read(RUNLOG_CHECKPOINT_BASE, c, sizeof(*c));
+  if (c->crc !=
+      crc((const uint8_t *)c, sizeof(*c) - sizeof(c->crc), CRC16_INIT))
+    return false;
+  // The run after the newest summary never got its own
+  return c->run == (uint16_t)(any ? lastRun + 1 : 0);
+}
+
+void resume(const runCheckpoint_t &c, int16_t liquidus, fix16_t reading,
+            unsigned long now) {
+  openRun(c.run, c.profile, liquidus, reading, now);
+  if (c.reading > current.peak)
+    current.peak = c.reading;
+}
+
+void abandon(const runCheckpoint_t &c) {
+  memset(&current, 0, sizeof(current));
+  current.run = c.run;
+  current.profile = c.profile;
+  current.fault = REFLOW_FAULT_RESET;
+  current.peak = c.reading;
+  writeSummary();
+}
+
+void sample(fix16_t reading, reflowState_t state, unsigned long now) {
+  if (!running)
+    return;
+  unsigned long dt = now - lastSample;
+  lastSample = now;
+
+  uint8_t stage = state - REFLOW_STATE_PREHEAT;
+  if (stage < RUNLOG_STAGES)
+    stageMs[stage] += dt;
+  if (reading >= liquidus_)
+    aboveMs += dt;
+  int16_t peak = scaled(reading, RUNLOG_SUMMARY_SCALE);
+  if (peak > current.peak)
+    current.peak = peak;
+
+  // Steepest rise over RUNLOG_RAMP_SPAN readings, in summary units per s
+  if (recentCount == RUNLOG_RAMP_SPAN) {
+    int16_t ramp = scaled((reading - recent[0]) / RUNLOG_RAMP_SPAN,
+                          RUNLOG_SUMMARY_SCALE);
+    if (ramp > current.maxRamp)
+      current.maxRamp = ramp;
+    memmove(recent, recent + 1, sizeof(recent) - sizeof(recent[0]));
+    recentCount--;
+  }
+  recent[recentCount++] = reading;
+
+  if (now - lastTrace >= RUNLOG_TRACE_INTERVAL * 1000UL) {
+    lastTrace += RUNLOG_TRACE_INTERVAL * 1000UL;
+    traceAppend(scaled(reading, RUNLOG_TRACE_SCALE));
+  }
+}
+
+void end(reflowFault_t fault, unsigned long now) {
+  if (!running)
+    return;
+  running = false;
+
+  current.fault = fault;
+  for (uint8_t i = 0; i < RUNLOG_STAGES; i++)
+    current.stage[i] = (stageMs[i] + 500) / 1000;
+  current.aboveLiquidus = (aboveMs + 500) / 1000;
+  current.duration = (now - started + 500) / 1000;
+  writeSummary();
+
+  // CRC of the header fields, then of the deltas
+  uint16_t c = crc((const uint8_t *)&header,
+                   sizeof(header) - sizeof(header.crc), CRC16_INIT);
+  for (uint16_t i = 0; i < header.length; i++)
+    c = crc16Update(c, traceAt(i));
+  header.crc = c;
+  // After the trace and the summary, so a header that made it is valid
+  queue(headerWrite, RUNLOG_TRACE_BASE, &header, sizeof(header));
+}
+
+bool active() { return running; }
+
+void flush() {
+  // One byte at most: the checkpoint and the trace as the run goes, the
+  // summary and the header once it ended
+  if (!step(checkpointWrite) && !stepTrace() && !step(summaryWrite))
+    step(headerWrite);
+}
+
+uint8_t count() {
+  drain();
+  uint8_t n = 0;
+  runSummary_t s;
+  for (uint8_t slot = 0; slot < RUNLOG_SUMMARIES; slot++)
+    if (readSummary(slot, &s))
+      n++;
+  return n;
+}
+
+bool summary(uint8_t i, runSummary_t *s) {
+  if (!any)
+    return false;
+  // Walk back from the newest, skipping slots that never held a summary
+  uint8_t n = count();
+  if (i >= n)
+    return false;
+  uint8_t skip = n - 1 - i;
+  for (uint8_t k = 0; k < RUNLOG_SUMMARIES; k++) {
+    uint8_t slot = (newest + RUNLOG_SUMMARIES - k) % RUNLOG_SUMMARIES;
+    if (!readSummary(slot, s))
+      continue;
+    if (!skip--)
+      return true;
+  }
+  return false;
+}
+
+bool trace(runTrace_t *t) {
+  if (running)
+    return false;
+  drain();
+  read(RUNLOG_TRACE_BASE, t, sizeof(*t));
+  if (t->length > RUNLOG_TRACE_BYTES)
+    return false;
+  uint16_t c = crc((const uint8_t *)t, sizeof(*t) - sizeof(t->crc),
+                   CRC16_INIT);
+  for (uint16_t i = 0; i < t->length; i++)
+    c = crc16Update(c, hal::eepromRead(RUNLOG_TRACE_DATA + i));
+  return c == t->crc;
+}
+
+uint8_t traceByte(uint16_t i) {
+  return hal::eepromRead(RUNLOG_TRACE_DATA + i);
+}
+
+} // namespace runlog
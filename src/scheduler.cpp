@@ -0,0 +1,101 @@
+/*
+ * Cooperative deadline scheduler
+ */
+#include "scheduler.h"
+
+/* True once now has reached deadline, valid across the millis() wrap */
+static inline bool reached(unsigned long now, unsigned long deadline) {
+  return (long)(now - deadline) >= 0;
+}
+
+Scheduler::Scheduler() : _count(0) {}
+
+int8_t Scheduler::add(taskFunction_t function, taskPriority_t priority,
+                      PGM_P name) {
+  if (_count >= SCHEDULER_MAX_TASKS)
+    return -1;
+  task_t &task = _tasks[_count];
+  task.function = function;
+  task.name = name;
+  task.deadline = 0;
+  task.period = 0;
+  task.priority = priority;
+  task.active = false;
+  memset(&task.stats, 0, sizeof(task.stats));
+  task.stats.minLateness = 0xffff;
+  return _count++;
+}
+
+void Scheduler::start(uint8_t id, unsigned long delay, unsigned long period) {
+  task_t &task = _tasks[id];
+  task.deadline = hal::millis() + delay;
+  task.period = period;
+  task.active = true;
+}
+
+void Scheduler::stop(uint8_t id) { _tasks[id].active = false; }
+
+bool Scheduler::active(uint8_t id) const { return _tasks[id].active; }
+
+void Scheduler::run() {
+  uint8_t ran = 0; // Tasks already dispatched in this call
+
+  for (;;) {
+    unsigned long now = hal::millis();
+    int8_t next = -1;
+    for (uint8_t i = 0; i < _count; i++) {
+      const task_t &task = _tasks[i];
+      if (!task.active || (ran & (1 << i)) || !reached(now, task.deadline))
+        continue;
+      if ((next < 0) || (task.priority < _tasks[next].priority) ||
+          ((task.priority == _tasks[next].priority) &&
+           !reached(task.deadline, _tasks[next].deadline)))
+        next = i;
+    }
+    if (next < 0)
+      return;
+    ran |= 1 << next;
+    dispatch(next, now);
+  }
+}
+
+void Scheduler::dispatch(uint8_t id, unsigned long now) {
+  task_t &task = _tasks[id];
+  taskStats_t &stats = task.stats;
+
+  unsigned long lateness = now - task.deadline;
+  uint16_t late = lateness > 0xffff ? 0xffff : lateness;
+  if (late > 0)
+    stats.late++;
+  if (late < stats.minLateness)
+    stats.minLateness = late;
+  if (late > stats.maxLateness)
+    stats.maxLateness = late;
+  stats.sumLateness += late;
+  stats.runs++;
+
+  // Re-arm before running so the task may stop or restart itself
+  if (task.period) {
+    task.deadline += task.period;
+    if (reached(now, task.deadline)) {
+      // Drop the releases we missed rather than running them back to back
+      stats.overruns++;
+      task.deadline = now + task.period;
+    }
+  } else {
+    task.active = false;
+  }
+
+  task.function();
+
+  unsigned long runTime = hal::millis() - now;
+  if (runTime > stats.maxRunTime)
+    stats.maxRunTime = runTime > 0xffff ? 0xffff : runTime;
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t i = 0; i < _count; i++) {
+    memset(&_tasks[i].stats, 0, sizeof(taskStats_t));
+    _tasks[i].stats.minLateness = 0xffff;
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ * Temperature sensor drivers - device words to samples
+ */
+#include "sensor.h"
+#include "ntc.h"
+
+static sensorSample_t fault(uint8_t faults, fix16_t coldJunction) {
+  sensorSample_t s = {0, coldJunction, faults};
+  return s;
+}
+
+namespace sensor {
+
+sensorSample_t decodeThermistor(uint16_t adc) {
+  // The thermistor pulls the input to ground, the pull-up to AVcc
+  if (adc >= ntc::adcCode(NTC_OPEN))
+    return fault(SENSOR_FAULT_OPEN, SENSOR_NO_COLD_JUNCTION);
+  if (adc <= ntc::adcCode(NTC_SHORT))
+    return fault(SENSOR_FAULT_SHORT_GND, SENSOR_NO_COLD_JUNCTION);
+  sensorSample_t s = {ntc::temperature(adc), SENSOR_NO_COLD_JUNCTION, 0};
+  return s;
+}
+
+/*
+ * D31..18 thermocouple, signed 0.25 C; D16 fault; D15..4 cold junction,
+ * signed 0.0625 C; D2 short to VCC, D1 short to GND, D0 open. D17 and D3
+ * always read 0, a missing device leaves SO high.
+ */
+sensorSample_t decodeMax31855(uint32_t word) {
+  if (word & 0x00020008UL)
+    return fault(SENSOR_FAULT_NO_DEVICE, SENSOR_NO_COLD_JUNCTION);
+  // 0.0625 C is 2^12 in fix16, the 12 bits sit 4 up in the low half
+  fix16_t coldJunction = (fix16_t)(int16_t)(word & 0xfff0) * 256;
+  if (word & 0x00010000UL) {
+    uint8_t faults = 0;
+    if (word & 0x01)
+      faults |= SENSOR_FAULT_OPEN;
+    if (word & 0x02)
+      faults |= SENSOR_FAULT_SHORT_GND;
+    if (word & 0x04)
+      faults |= SENSOR_FAULT_SHORT_VCC;
+    return fault(faults, coldJunction);
+  }
+  // 0.25 C is 2^14, the 14 bits sit 18 up
+  sensorSample_t s = {(fix16_t)((int32_t)(word & 0xfffc0000UL) >> 4),
+                      coldJunction, 0};
+  return s;
+}
+
+/* D15 always 0; D14..3 thermocouple, 0.25 C; D2 open */
+sensorSample_t decodeMax6675(uint16_t word) {
+  if (word & 0x8000)
+    return fault(SENSOR_FAULT_NO_DEVICE, SENSOR_NO_COLD_JUNCTION);
+  if (word & 0x0004)
+    return fault(SENSOR_FAULT_OPEN, SENSOR_NO_COLD_JUNCTION);
+  sensorSample_t s = {(fix16_t)(word >> 3) << 14, SENSOR_NO_COLD_JUNCTION,
+                      0};
+  return s;
+}
+
+/*
+ * CJTH:CJTL cold junction, signed 0.015625 C in the top 14 bits;
+ * LTCBH:LTCBM:LTCBL thermocouple, signed 0.0078125 C in the top 19 bits;
+ * SR bit 7 cold-junction range, 6 thermocouple range, 1 input over or under
+ * the supply, 0 open
+ */
+sensorSample_t decodeMax31856(const uint8_t registers[6]) {
+  fix16_t coldJunction =
+      (fix16_t)(int16_t)((registers[0] << 8 | registers[1]) & 0xfffc) * 256;
+  uint8_t status = registers[5];
+  uint8_t faults = 0;
+  if (status & 0x01)
+    faults |= SENSOR_FAULT_OPEN;
+  if (status & 0x02) // Either rail, the device does not say which
+    faults |= SENSOR_FAULT_SHORT_GND | SENSOR_FAULT_SHORT_VCC;
+  if (status & 0xc0)
+    faults |= SENSOR_FAULT_RANGE;
+  if (faults)
+    return fault(faults, coldJunction);
+  // Sign extended from 24 bits, then 2^-7 C is 2^9 in fix16 after the 5
+  // unused bits
+  int32_t word = (int32_t)((uint32_t)registers[2] << 24 |
+                           (uint32_t)registers[3] << 16 |
+                           (uint32_t)(registers[4] & 0xe0) << 8) >>
+                 8;
+  sensorSample_t s = {word * 16, coldJunction, 0};
+  return s;
+}
+
+} // namespace sensor
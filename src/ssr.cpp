@@ -0,0 +1,172 @@
+/*
+ * SSR output engines
+ */
+#include "ssr.h"
+
+// Written by loop() with the interrupts held off, read by them
+static volatile uint16_t requestedDuty[CONTROL_CHANNELS];
+
+// Interrupts only, or loop() with them held off
+static uint8_t requestedMode;
+static volatile uint8_t engine; // ssrMode_t in use
+static uint8_t windowSteps[CONTROL_CHANNELS]; // Window in progress
+static uint8_t step; // Position in the window of the first channel
+static uint16_t accumulator[CONTROL_CHANNELS][2]; // By half of the cycle
+static bool cycleOn[CONTROL_CHANNELS]; // Burst: the first half decided
+static bool secondHalf;                // Of the coming half-cycle
+static uint16_t allTicks[CONTROL_CHANNELS];
+static uint16_t onTicks[CONTROL_CHANNELS];
+
+// Mains frequency detection
+static volatile uint8_t frequency; // [Hz]
+static uint8_t crossings;          // Timed so far
+static unsigned long firstCrossing; // [ms]
+static uint8_t silentTicks;        // Since the last crossing
+
+/* Accumulators staggered by channel, the second half of the cycle half a
+ * cycle's worth of duty on */
+static void startHalfCycles() {
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++) {
+    accumulator[c][0] = c * (SSR_DUTY_MAX / CONTROL_CHANNELS);
+    accumulator[c][1] = (accumulator[c][0] + SSR_DUTY_MAX / 2) % SSR_DUTY_MAX;
+    cycleOn[c] = false;
+  }
+  secondHalf = true; // The next crossing starts a cycle
+  engine = requestedMode;
+}
+
+/* 50 or 60 from the time from the first to the last of SSR_DETECT
+ * crossings, else 0 */
+static uint8_t classify(unsigned long span) {
+  // A half-cycle is 10 ms at 50 Hz and 8.33 ms at 60 Hz, allow 4%
+  const unsigned long at50 = (SSR_DETECT - 1) * 10UL,
+                      at60 = (SSR_DETECT - 1) * 25UL / 3;
+  if (span >= at50 - at50 / 25 && span <= at50 + at50 / 25)
+    return 50;
+  if (span >= at60 - at60 / 25 && span <= at60 + at60 / 25)
+    return 60;
+  return 0;
+}
+
+namespace ssr {
+
+void begin(ssrMode_t mode) {
+  hal::interruptsOff();
+  requestedMode = mode;
+  engine = SSR_MODE_WINDOW;
+  frequency = 0;
+  crossings = 0;
+  silentTicks = 0;
+  step = 0; // The tick counts run on for ControlChannel::read()
+  hal::interruptsOn();
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++)
+    off(c);
+  hal::timerBegin(SSR_TICK, tick);
+  hal::zeroCrossBegin(halfCycle);
+}
+
+ssrMode_t mode() { return (ssrMode_t)engine; }
+
+uint8_t mainsFrequency() { return frequency; }
+
+void setDuty(uint8_t channel, uint16_t duty) {
+  hal::interruptsOff();
+  requestedDuty[channel] = duty > SSR_DUTY_MAX ? SSR_DUTY_MAX : duty;
+  hal::interruptsOn();
+}
+
+uint16_t duty(uint8_t channel) {
+  hal::interruptsOff();
+  uint16_t d = requestedDuty[channel];
+  hal::interruptsOn();
+  return d;
+}
+
+void ticks(uint8_t channel, uint16_t *all, uint16_t *on) {
+  hal::interruptsOff();
+  *all = allTicks[channel];
+  *on = onTicks[channel];
+  hal::interruptsOn();
+}
+
+void off(uint8_t channel) {
+  hal::interruptsOff();
+  requestedDuty[channel] = 0;
+  windowSteps[channel] = 0;
+  cycleOn[channel] = false;
+  hal::writeSsr(channel, false);
+  hal::interruptsOn();
+}
+
+void tick() {
+  if (silentTicks < 0xff)
+    silentTicks++;
+  if (silentTicks >= SSR_ZERO_CROSS_LOST) {
+    // No detector, or it stopped: windows, and time the mains again once
+    // it is back
+    crossings = 0;
+    frequency = 0;
+    if (engine != SSR_MODE_WINDOW) {
+      engine = SSR_MODE_WINDOW;
+      for (uint8_t c = 0; c < CONTROL_CHANNELS; c++) {
+        windowSteps[c] = 0;
+        hal::writeSsr(c, false);
+      }
+    }
+  }
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++) {
+    // Step in the channel's own window
+    uint8_t s = step + SSR_RESOLUTION - c * (SSR_RESOLUTION / CONTROL_CHANNELS);
+    if (s >= SSR_RESOLUTION)
+      s -= SSR_RESOLUTION;
+    if (engine != SSR_MODE_WINDOW)
+      continue;
+    if (s == 0)
+      windowSteps[c] = ((unsigned long)requestedDuty[c] * SSR_RESOLUTION +
+                        SSR_DUTY_MAX / 2) /
+                       SSR_DUTY_MAX;
+    bool on = s < windowSteps[c];
+    hal::writeSsr(c, on);
+    allTicks[c]++;
+    if (on)
+      onTicks[c]++;
+  }
+  if (++step >= SSR_RESOLUTION)
+    step = 0;
+}
+
+void halfCycle() {
+  silentTicks = 0;
+  if (crossings < SSR_DETECT) {
+    if (!crossings)
+      firstCrossing = hal::millis();
+    if (++crossings == SSR_DETECT) {
+      frequency = classify(hal::millis() - firstCrossing);
+      if (frequency && requestedMode != SSR_MODE_WINDOW)
+        startHalfCycles();
+    }
+  }
+  if (engine == SSR_MODE_WINDOW)
+    return;
+  secondHalf = !secondHalf;
+  for (uint8_t c = 0; c < CONTROL_CHANNELS; c++) {
+    bool on;
+    if (engine == SSR_MODE_BURST && secondHalf) {
+      on = cycleOn[c];
+    } else {
+      uint16_t &a =
+          accumulator[c][engine == SSR_MODE_HALF_CYCLE ? secondHalf : 0];
+      a += requestedDuty[c];
+      on = a >= SSR_DUTY_MAX;
+      if (on)
+        a -= SSR_DUTY_MAX;
+      cycleOn[c] = on;
+    }
+    hal::writeSsr(c, on);
+    allTicks[c]++;
+    if (on)
+      onTicks[c]++;
+  }
+}
+
+} // namespace ssr
@@ -0,0 +1,191 @@
+/*
+ * Persistent settings store
+ */
+#include "store.h"
+#include "crc16.h"
+#include "hal.h"
+
+#define STORE_LEGACY_PROFILE_ADDRESS 0 // Single profile byte of old firmware
+#define STORE_LEGACY_PROFILES 2        // Lead-free and leaded
+#define SLOT_HEADER 3                  // Sequence and version
+#define SLOT_OVERHEAD (SLOT_HEADER + 2)
+
+static settings_t settings_;
+static gainSchedule_t schedule_;
+static userProfiles_t profiles_;
+static plantModel_t model_;
+
+struct partition_t {
+  uint8_t *record;
+  uint16_t size;
+  uint16_t base;
+  uint8_t slots;
+};
+
+#define SLOT_SIZE(record) (sizeof(record) + SLOT_OVERHEAD)
+#define SETTINGS_BASE 0
+#define SCHEDULE_BASE                                                          \
+  (SETTINGS_BASE + STORE_SETTINGS_SLOTS * SLOT_SIZE(settings_t))
+#define PROFILES_BASE                                                          \
+  (SCHEDULE_BASE + STORE_SCHEDULE_SLOTS * SLOT_SIZE(gainSchedule_t))
+#define MODEL_BASE                                                             \
+  (PROFILES_BASE + STORE_PROFILES_SLOTS * SLOT_SIZE(userProfiles_t))
+#define STORE_USED (MODEL_BASE + STORE_MODEL_SLOTS * SLOT_SIZE(plantModel_t))
+
+static_assert(STORE_USED <= STORE_SIZE, "store records do not fit STORE_SIZE");
+
+/* Indexed by storeRecord_t */
+static const partition_t partitions[STORE_RECORDS] = {
+    {(uint8_t *)&settings_, sizeof(settings_t), SETTINGS_BASE,
+     STORE_SETTINGS_SLOTS},
+    {(uint8_t *)&schedule_, sizeof(gainSchedule_t), SCHEDULE_BASE,
+     STORE_SCHEDULE_SLOTS},
+    {(uint8_t *)&profiles_, sizeof(userProfiles_t), PROFILES_BASE,
+     STORE_PROFILES_SLOTS},
+    {(uint8_t *)&model_, sizeof(plantModel_t), MODEL_BASE, STORE_MODEL_SLOTS},
+};
+
+static uint8_t newest[STORE_RECORDS];    // Slot of the copy in force
+static uint16_t sequence[STORE_RECORDS]; // Its sequence number
+static bool stored[STORE_RECORDS];       // There is a copy in force
+static uint8_t changed;                  // Bit per record
+
+static uint16_t slotAddress(const partition_t &p, uint8_t slot) {
+  return p.base + slot * (p.size + SLOT_OVERHEAD);
+}
+
+/* Sequence number of a valid slot, or false */
+static bool readSlot(const partition_t &p, uint8_t slot, uint16_t *seq) {
+  uint16_t address = slotAddress(p, slot);
+  uint16_t crc = CRC16_INIT;
+  for (uint16_t i = 0; i < SLOT_HEADER + p.size; i++)
+    crc = crc16Update(crc, hal::eepromRead(address + i));
+  uint16_t stored = hal::eepromRead(address + SLOT_HEADER + p.size) |
+                    hal::eepromRead(address + SLOT_HEADER + p.size + 1) << 8;
+  if (crc != stored || hal::eepromRead(address + 2) != STORE_VERSION)
+    return false;
+  *seq = hal::eepromRead(address) | hal::eepromRead(address + 1) << 8;
+  return true;
+}
+
+static void update(uint16_t address, uint8_t value) {
+  if (hal::eepromRead(address) != value)
+    hal::eepromWrite(address, value);
+}
+
+/* The RAM record matches the copy in force */
+static bool unchanged(uint8_t r) {
+  const partition_t &p = partitions[r];
+  if (!stored[r])
+    return false;
+  uint16_t address = slotAddress(p, newest[r]) + SLOT_HEADER;
+  for (uint16_t i = 0; i < p.size; i++)
+    if (hal::eepromRead(address + i) != p.record[i])
+      return false;
+  return true;
+}
+
+static void write(uint8_t r) {
+  const partition_t &p = partitions[r];
+  uint8_t slot = stored[r] ? (newest[r] + 1) % p.slots : 0;
+  uint16_t seq = stored[r] ? sequence[r] + 1 : 0;
+  uint16_t address = slotAddress(p, slot);
+  uint8_t header[SLOT_HEADER] = {(uint8_t)seq, (uint8_t)(seq >> 8),
+                                 STORE_VERSION};
+
+  uint16_t crc = CRC16_INIT;
+  for (uint8_t i = 0; i < SLOT_HEADER; i++) {
+    crc = crc16Update(crc, header[i]);
+    update(address + i, header[i]);
+  }
+  for (uint16_t i = 0; i < p.size; i++) {
+    crc = crc16Update(crc, p.record[i]);
+    update(address + SLOT_HEADER + i, p.record[i]);
+  }
+  update(address + SLOT_HEADER + p.size, crc);
+  update(address + SLOT_HEADER + p.size + 1, crc >> 8);
+
+  newest[r] = slot;
+  sequence[r] = seq;
+  stored[r] = true;
+}
+
+static void defaults(uint8_t r) {
+  memset(partitions[r].record, 0, partitions[r].size);
+  if (r == STORE_SETTINGS)
+    settings_.sensorGain = FIX16_ONE;
+}
+
+/*
+ * Profile byte of the old firmware, which wrote nothing else: a profile
+ * number with the rest of the slot header after it erased. A slot of an
+ * earlier STORE_VERSION has its sequence and version there instead.
+ */
+static bool legacyProfile(uint8_t *profile) {
+  uint8_t value = hal::eepromRead(STORE_LEGACY_PROFILE_ADDRESS);
+  if (value >= STORE_LEGACY_PROFILES)
+    return false;
+  for (uint8_t i = 1; i < SLOT_HEADER; i++)
+    if (hal::eepromRead(STORE_LEGACY_PROFILE_ADDRESS + i) != 0xff)
+      return false;
+  *profile = value;
+  return true;
+}
+
+namespace store {
+
+void begin() {
+  // Defaults, then the copies in force over them
+  for (uint8_t r = 0; r < STORE_RECORDS; r++)
+    defaults(r);
+
+  for (uint8_t r = 0; r < STORE_RECORDS; r++) {
+    const partition_t &p = partitions[r];
+    stored[r] = false;
+    for (uint8_t slot = 0; slot < p.slots; slot++) {
+      uint16_t seq;
+      if (!readSlot(p, slot, &seq))
+        continue;
+      // Newer by serial number arithmetic, survives the 16-bit wrap
+      if (!stored[r] || (int16_t)(seq - sequence[r]) > 0) {
+        newest[r] = slot;
+        sequence[r] = seq;
+        stored[r] = true;
+      }
+    }
+    if (stored[r]) {
+      uint16_t address = slotAddress(p, newest[r]) + SLOT_HEADER;
+      for (uint16_t i = 0; i < p.size; i++)
+        p.record[i] = hal::eepromRead(address + i);
+    }
+  }
+  if (!stored[STORE_SETTINGS])
+    legacyProfile(&settings_.profile);
+  changed = 0;
+}
+
+settings_t &settings() { return settings_; }
+gainSchedule_t &schedule() { return schedule_; }
+userProfiles_t &profiles() { return profiles_; }
+plantModel_t &model() { return model_; }
+
+void change(storeRecord_t record) { changed |= 1 << record; }
+
+bool pending() { return changed != 0; }
+
+void commit() {
+  for (uint8_t r = 0; r < STORE_RECORDS; r++) {
+    if (!(changed & (1 << r)))
+      continue;
+    if (!unchanged(r))
+      write(r);
+  }
+  changed = 0;
+}
+
+fix16_t calibrate(fix16_t reading) {
+  return (fix16_t)((int64_t)reading * settings_.sensorGain >> 16) +
+         settings_.sensorOffset;
+}
+
+} // namespace store
@@ -0,0 +1,246 @@
+/*
+ * Binary telemetry
+ */
+#include "telemetry.h"
+#include "cobs.h"
+#include "crc16.h"
+#include "profile.h"
+#include "runlog.h"
+#include "timing.h"
+
+#define FRAME_MAX (TELEMETRY_HEADER + TELEMETRY_MAX_PAYLOAD + 2)
+
+static uint8_t frame[FRAME_MAX];
+static uint8_t length;
+static uint16_t sequence;
+static uint16_t droppedFrames;
+static uint8_t ticks;
+
+// Log download in progress
+static bool downloading;
+static uint8_t nextSummary;
+static bool traceValid;
+static runTrace_t trace;
+static uint16_t traceOffset;
+
+// Upload being received, encoded
+static bool uploading;
+static uint8_t upload[COBS_ENCODED_LENGTH(TELEMETRY_UPLOAD_MAX)];
+static uint8_t received; // Past sizeof(upload) once it overflowed
+
+#ifdef LOOP_TIMING
+static uint8_t nextSection = TIMING_SECTIONS; // None to send
+#endif
+
+static void put(uint8_t data) { frame[length++] = data; }
+
+static void put16(uint16_t data) {
+  put(data);
+  put(data >> 8);
+}
+
+static uint32_t get32(const uint8_t *p) {
+  return p[0] | (uint16_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static void open(telemetryFrame_t type, unsigned long now) {
+  length = 0;
+  put(type);
+  put16(sequence++);
+  put16(now);
+  put16(now >> 16);
+}
+
+/* Temperature in 1/TELEMETRY_SCALE C, saturated to 16 bits */
+static void putTemperature(fix16_t t) {
+  t >>= 16 - TELEMETRY_SCALE_BITS;
+  put16(t > 32767 ? 32767 : t < -32767 ? -32767 : t);
+}
+
+/* Room for the longest frame, so a download never drops one */
+static bool room() {
+  return hal::serialRoom() >= COBS_ENCODED_LENGTH(FRAME_MAX) + 1;
+}
+
+static void send() {
+  uint16_t crc = CRC16_INIT;
+  for (uint8_t i = 0; i < length; i++)
+    crc = crc16Update(crc, frame[i]);
+  put16(crc);
+
+  uint8_t encoded[COBS_ENCODED_LENGTH(FRAME_MAX) + 1];
+  uint8_t n = cobs::encode(frame, length, encoded);
+  encoded[n++] = COBS_DELIMITER;
+  if (hal::serialRoom() < n) {
+    droppedFrames++;
+    return;
+  }
+  hal::serialWrite(encoded, n);
+}
+
+/* A decoded upload into the store, false if it is not taken */
+static bool take(const uint8_t *f, int n) {
+  uint16_t crc = CRC16_INIT;
+  for (int i = 0; i < n - 2; i++)
+    crc = crc16Update(crc, f[i]);
+  if (n < 3 || crc != (f[n - 2] | (uint16_t)f[n - 1] << 8) ||
+      runlog::active())
+    return false;
+
+  if (f[0] == TELEMETRY_CALIBRATION && n == 1 + 8 + 2) {
+    fix16_t gain = get32(f + 5);
+    if (gain <= 0)
+      return false;
+    store::settings().sensorOffset = get32(f + 1);
+    store::settings().sensorGain = gain;
+    store::change(STORE_SETTINGS);
+    return true;
+  }
+  if (f[0] == TELEMETRY_PROFILE && n == 2 + (int)sizeof(userProfile_t) + 2) {
+    // The record has the same byte layout on the line and in the store
+    userProfile_t user;
+    memcpy(&user, f + 2, sizeof(user));
+    if (f[1] >= STORE_USER_PROFILES || !profile::valid(user))
+      return false;
+    store::profiles().profile[f[1]] = user;
+    store::change(STORE_PROFILES);
+    return true;
+  }
+  return false;
+}
+
+/* End of an upload frame, answered with TELEMETRY_ACK */
+static void uploaded(unsigned long now) {
+  // Decoded in place, COBS only ever writes behind where it reads
+  int n = received <= sizeof(upload) ? cobs::decode(upload, received, upload)
+                                     : -1;
+  bool taken = n > 0 && take(upload, n);
+  open(TELEMETRY_ACK, now);
+  put(n > 0 ? upload[0] : 0);
+  put(taken);
+  send();
+}
+
+namespace telemetry {
+
+void begin() {
+  hal::serialBegin(TELEMETRY_BAUD);
+  // Ends whatever a receiver caught of the line before
+  const uint8_t delimiter = COBS_DELIMITER;
+  hal::serialWrite(&delimiter, 1);
+}
+
+void start(unsigned long now, uint8_t profile, uint16_t window) {
+  open(TELEMETRY_START, now);
+  put(profile);
+  put16(window);
+  send();
+  ticks = TELEMETRY_DIVIDER - 1; // First sample on the first tick
+}
+
+void sample(unsigned long now, fix16_t setpoint, fix16_t reading,
+            fix16_t output, uint8_t state, fix16_t estimate, fix16_t rate) {
+  if (++ticks < TELEMETRY_DIVIDER)
+    return;
+  ticks = 0;
+  open(TELEMETRY_SAMPLE, now);
+  putTemperature(setpoint);
+  putTemperature(reading);
+  put16(fix16ToInt(output));
+  put(state);
+  putTemperature(estimate);
+  putTemperature(rate);
+  send();
+}
+
+void poll(unsigned long now) {
+  int command;
+  while ((command = hal::serialRead()) >= 0) {
+    if (uploading) {
+      if (command == COBS_DELIMITER) {
+        uploading = false;
+        uploaded(now);
+      } else if (received <= sizeof(upload)) {
+        if (received < sizeof(upload))
+          upload[received] = command;
+        received++;
+      }
+      continue;
+    }
+    if (command == TELEMETRY_COMMAND_UPLOAD) {
+      uploading = true;
+      received = 0;
+    }
+    // Not during a run, the log is still being written
+    if (command == TELEMETRY_COMMAND_LOG && !downloading &&
+        !runlog::active()) {
+      downloading = true;
+      nextSummary = 0;
+      traceValid = runlog::trace(&trace);
+      traceOffset = 0;
+    }
+#ifdef LOOP_TIMING
+    if (command == TELEMETRY_COMMAND_TIMING)
+      nextSection = 0;
+#endif
+  }
+#ifdef LOOP_TIMING
+  if (nextSection < TIMING_SECTIONS && room()) {
+    // Taken and cleared as it goes, each section starts over once sent
+    timingSection_t section = (timingSection_t)nextSection++;
+    const timingStats_t &t = timing::stats(section);
+    open(TELEMETRY_TIMING, now);
+    put(section);
+    put16(t.count);
+    put16(t.min);
+    put16(t.max);
+    put16(t.count ? t.sum / t.count : 0);
+    for (uint8_t i = 0; i < TIMING_BUCKETS; i++)
+      put16(t.bucket[i]);
+    send();
+    timing::clear(section);
+    return;
+  }
+#endif
+  if (!downloading || !room())
+    return;
+
+  runSummary_t s;
+  if (runlog::summary(nextSummary, &s)) {
+    nextSummary++;
+    open(TELEMETRY_SUMMARY, now);
+    put16(s.run);
+    put(s.profile);
+    put(s.fault);
+    put16(s.peak);
+    put16(s.aboveLiquidus);
+    put16(s.maxRamp);
+    for (uint8_t i = 0; i < RUNLOG_STAGES; i++)
+      put16(s.stage[i]);
+    put16(s.duration);
+    send();
+    return;
+  }
+  if (!traceValid) {
+    downloading = false;
+    return;
+  }
+  open(TELEMETRY_TRACE, now);
+  put16(trace.run);
+  put(trace.interval);
+  put(trace.truncated);
+  put16(trace.first);
+  put16(trace.length);
+  put16(traceOffset);
+  for (uint8_t i = 0;
+       i < TELEMETRY_TRACE_CHUNK && traceOffset < trace.length; i++)
+    put(runlog::traceByte(traceOffset++));
+  send();
+  if (traceOffset >= trace.length)
+    downloading = false;
+}
+
+uint16_t dropped() { return droppedFrames; }
+
+} // namespace telemetry
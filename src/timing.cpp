@@ -0,0 +1,46 @@
+/*
+ * loop() section timing
+ */
+#include "timing.h"
+
+#ifdef LOOP_TIMING
+
+static timingStats_t sections[TIMING_SECTIONS];
+
+namespace timing {
+
+void record(timingSection_t section, unsigned long us) {
+  timingStats_t &s = sections[section];
+  uint16_t t = us > 0xffff ? 0xffff : us;
+  if (s.count == 0xffff) {
+    // Halve the old passes rather than stop: the mean and the shape of the
+    // histogram hold, min and max are kept, and a rare slow pass rounds up
+    // so it stays in its bucket
+    s.count >>= 1;
+    s.sum >>= 1;
+    for (uint8_t i = 0; i < TIMING_BUCKETS; i++)
+      s.bucket[i] = (s.bucket[i] + 1) >> 1;
+  }
+  if (!s.count || t < s.min)
+    s.min = t;
+  if (t > s.max)
+    s.max = t;
+  s.count++;
+  s.sum += t;
+  uint8_t b = 0;
+  while (t >>= 1)
+    b++;
+  s.bucket[b < TIMING_BUCKETS ? b : TIMING_BUCKETS - 1]++;
+}
+
+const timingStats_t &stats(timingSection_t section) {
+  return sections[section];
+}
+
+void clear(timingSection_t section) {
+  memset(&sections[section], 0, sizeof(sections[section]));
+}
+
+} // namespace timing
+
+#endif